@@ -1,6 +1,6 @@
 /**
  * @file AppGlobals.cpp
- * @brief Global application instances and command queue implementation
+ * @brief Global application instances and status queue implementation
  */
 
 #include "AppGlobals.h"
@@ -17,11 +17,56 @@ Scheduler gScheduler;
 BlynkInterface gBlynk;
 Terminal gTerminal;
 BlynkTimer gTimer;
-QueueHandle_t gCommandQueue = nullptr;
+QueueHandle_t gStatusQueue = nullptr;
 
 void initGlobals() {
-    gCommandQueue = xQueueCreate(COMMAND_QUEUE_LEN, sizeof(Command));
-    if (!gCommandQueue) {
-        logInfo("[ERROR] Cola comandos no creada");
+    if (!gCommandBus.begin()) {
+        logInfo("[ERROR] Bus de comandos no creado");
     }
+    // During a power adjustment a new level steers it and a shutdown cuts it short.
+    gCommandBus.setInFlightHook([](const Command& c, Command::Type executing) {
+        if (executing != Command::SET_POWER) return false;
+        if (c.type == Command::SET_POWER) return gController.retargetPower(c.power);
+        if (c.type == Command::SHUTDOWN) gController.cancelPowerAdjust();
+        return false;
+    });
+    // Inside SAFETY_MIN_ON_TIME_MS requestShutdown() refuses, so nothing may be cancelled for it.
+    gCommandBus.setShutdownGate([] { return gController.getStatusSnapshot().canShutdown; });
+    gStatusQueue = xQueueCreate(1, sizeof(StoveStatus));
+    if (!gStatusQueue) {
+        logInfo("[ERROR] Cola estado no creada");
+    }
+}
+
+static TaskHandle_t sStatusListener = nullptr;
+
+/** @brief Whether two snapshots differ in anything the UI shows or gates on */
+static bool statusDiffers(const StoveStatus& a, const StoveStatus& b) {
+    // A re-armed timer moves the deadline, which otherwise stays put while counting down.
+    int32_t deadlineShift = (int32_t)((a.takenMs + a.autoShutdownRemainingMs) - (b.takenMs + b.autoShutdownRemainingMs));
+    return a.state != b.state || a.powerLevel != b.powerLevel ||
+           !(a.ambientTemp == b.ambientTemp) || a.isOn != b.isOn ||
+           a.canShutdown != b.canShutdown || a.powerAdjustInProgress != b.powerAdjustInProgress ||
+           a.shutdownRefusals != b.shutdownRefusals ||
+           (a.autoShutdownRemainingMs != 0) != (b.autoShutdownRemainingMs != 0) ||
+           (a.autoShutdownRemainingMs && (deadlineShift > 1000 || deadlineShift < -1000));
+}
+
+void setStatusListener(TaskHandle_t task) {
+    sStatusListener = task;
+}
+
+void publishStatus(bool notify) {
+    if (!gStatusQueue) return;
+    StoveStatus prev;
+    bool hadPrev = xQueuePeek(gStatusQueue, &prev, 0) == pdTRUE;
+    StoveStatus s = gController.getStatusSnapshot();
+    xQueueOverwrite(gStatusQueue, &s);
+    if (sStatusListener && (notify || !hadPrev || statusDiffers(prev, s))) {
+        xTaskNotifyGive(sStatusListener);
+    }
+}
+
+bool latestStatus(StoveStatus& out) {
+    return gStatusQueue && xQueuePeek(gStatusQueue, &out, 0) == pdTRUE;
 }
@@ -1,11 +1,10 @@
 /**
  * @file AppGlobals.h
- * @brief Global application instances and command queue
+ * @brief Global application instances and status queue
  * 
  * This module provides centralized access to all major application components
  * including stove communication, controller, scheduler, Blynk interface, and
- * terminal. It also defines the command structure used for inter-task communication
- * via FreeRTOS queues.
+ * terminal. Commands travel to the control task over gCommandBus (CommandBus.h).
  */
 
 #pragma once
@@ -13,6 +12,7 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/task.h>
 #include "Config.h"
 #include "IStoveComm.h"
 
@@ -26,27 +26,7 @@
 #include "Scheduler.h"
 #include "BlynkInterface.h"
 #include "Terminal.h"
-
-/**
- * @struct Command
- * @brief Command structure for task communication via FreeRTOS queue
- * 
- * Commands are sent between tasks to perform stove operations such as
- * starting, stopping, power adjustment, timer setting, and schedule updates.
- */
-struct Command {
-  /** @brief Command type enumeration */
-  enum Type { START, SHUTDOWN, SET_POWER, SET_TIMER, SCHED_APPLY } type;
-  
-  uint8_t power;        ///< Power level (1-5) for SET_POWER command
-  uint32_t minutes;     ///< Timer duration in minutes for SET_TIMER command
-  size_t schedIndex;    ///< Schedule entry index for SCHED_APPLY command
-  bool schedActive;     ///< Schedule active flag for SCHED_APPLY command
-  uint8_t schedDay;     ///< Day of week (1-7) for SCHED_APPLY command
-  uint8_t schedHour;    ///< Hour (0-23) for SCHED_APPLY command
-  uint8_t schedMinute;  ///< Minute (0-59) for SCHED_APPLY command
-  uint8_t schedPower;   ///< Target power level for SCHED_APPLY command
-};
+#include "CommandBus.h"
 
 // ============================================================================
 // GLOBAL INSTANCES
@@ -77,13 +57,41 @@ extern Terminal gTerminal;
 /** @brief Blynk timer for periodic status updates */
 extern BlynkTimer gTimer;
 
-/** @brief FreeRTOS queue handle for inter-task command passing */
-extern QueueHandle_t gCommandQueue;
+/**
+ * @brief Single-slot queue holding the latest StoveStatus
+ *
+ * Written (overwritten) by the control tasks, peeked by the network task, so
+ * the network side never touches the controller or waits on its mutex.
+ */
+extern QueueHandle_t gStatusQueue;
+
+/**
+ * @brief Take a controller snapshot and make it the latest status
+ * @param notify Wake the status listener even if nothing differs (a command
+ *        finished: UI gates wait on that, not only on status fields)
+ *
+ * Called by the control tasks after anything that may change the status.
+ * The status listener is notified only when a published field differs.
+ */
+void publishStatus(bool notify = false);
+
+/**
+ * @brief Register the task notified (xTaskNotifyGive) on status changes
+ * @param task Listening task (the network task)
+ */
+void setStatusListener(TaskHandle_t task);
+
+/**
+ * @brief Copy the latest published status
+ * @param out Receives the status
+ * @return false if nothing has been published yet
+ */
+bool latestStatus(StoveStatus& out);
 
 /**
- * @brief Initialize global instances and command queue
+ * @brief Initialize global instances and queues
  * 
- * Creates the FreeRTOS command queue and initializes any global state.
+ * Creates the command bus and the FreeRTOS status queue and initializes any global state.
  * Must be called during application setup before using global instances.
  */
 void initGlobals();
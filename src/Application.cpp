@@ -8,9 +8,14 @@
 #include "WiFiManager.h"
 #include "UIGating.h"
 #include "StatusPublisher.h"
+#include "ThermalModel.h"
 #include "TaskManager.h"
 #include "BlynkHandlers.h"
 #include "BlynkGlobal.h"
+#include "NetworkLink.h"
+#include "MqttLink.h"
+#include "LocalApi.h"
+#include "BackendSinks.h"
 #include "Config.h"
 #include "Logging.h"
 #include <WiFi.h>
@@ -35,12 +40,13 @@ void Application::initialize() {
 }
 
 void Application::initializeHardware() {
+    Serial.setRxBufferSize(TERMINAL_RX_BUFFER);
     Serial.begin(115200);
 }
 
 void Application::initializeWiFi() {
+    // Credentials only; the network task associates in the background.
     gWiFiMgr.begin();
-    mWiFiConnected = gWiFiMgr.connect();
     configTime(0, 0, "pool.ntp.org", "time.nist.gov");
 }
 
@@ -51,44 +57,47 @@ void Application::initializeComponents() {
     gComm.begin(HW_RX_PIN_DEFAULT, HW_TX_PIN_DEFAULT, HW_EN_RX_PIN_DEFAULT);
     gController.begin(&gComm);
     gController.poll();
+    publishStatus();
+    gThermal.begin();
     gScheduler.begin();
+    gScheduler.setThermalModel(&gThermal);
     gBlynk.begin(&gController, &gScheduler);
     
     setupBlynkCallbacks();
 }
 
 void Application::initializeBlynk() {
-    if (mWiFiConnected) {
-        BlynkWrapper::begin(BLYNK_AUTH_TOKEN, gWiFiMgr.getSsid().c_str(), gWiFiMgr.getPassword().c_str());
-        
-        if (BlynkWrapper::connected()) {
-            gBlynk.attachBlynkHooks(
-                [](uint8_t pin, int val) { BlynkWrapper::virtualWrite(pin, val); },
-                [](uint8_t pin, const char* prop, const char* value) { BlynkWrapper::setProperty(pin, prop, value); },
-                [](uint8_t pin, const String& txt) { BlynkWrapper::virtualWrite(pin, txt); }
-            );
-            
-            gBlynk.enableOnOff(gController.isOn());
-            gBlynk.enablePowerSlider(gController.getPowerLevel());
-            gBlynk.enableSchedulerApply();
-            gBlynk.pushSchedulerSummary(gScheduler.buildSummary());
-        } else {
-            logInfo("Blynk no conectado.");
+    gBlynk.attachBlynkHooks(
+        [](uint8_t pin, int val) { BlynkWrapper::virtualWrite(pin, val); },
+        [](uint8_t pin, const char* prop, const char* value) { BlynkWrapper::setProperty(pin, prop, value); },
+        [](uint8_t pin, const char* txt) { BlynkWrapper::virtualWrite(pin, txt); }
+    );
+    
+    // Widgets are (re)initialized from the latest status on every login.
+    gNetLink.setOnlineHook([]() {
+        StoveStatus s;
+        if (latestStatus(s)) {
+            gBlynk.enableOnOff(s.isOn);
+            gBlynk.enablePowerSlider(s.powerLevel);
         }
-    } else {
-        logInfo("Sin WiFi: Blynk omitido.");
-    }
+        gBlynk.enableSchedulerApply();
+        gBlynk.pushSchedulerSummary();
+        gBlynk.pushSchedulerTable();
+    });
+    gNetLink.begin(BLYNK_AUTH_TOKEN);
+    gMqtt.begin();
+    gLocalApi.begin();
 }
 
 void Application::initializeTasks() {
     gTerminal.begin(&Serial, &gComm, &gController, &gScheduler);
+    // Set up before the network task starts; only that task runs gTimer.
+    registerBackendSinks();
+    gStatusPublisher.begin();
     createAllTasks();
-    gTimer.setInterval(2000L, []() { gStatusPublisher.timerPush(); });
 }
 
 void Application::run() {
-    if (WiFi.status() == WL_CONNECTED) {
-        BlynkWrapper::run();
-    }
-    gTimer.run();
+    // Networking lives in taskNetwork; the Arduino loop has nothing left to do.
+    vTaskDelay(portMAX_DELAY);
 }
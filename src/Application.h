@@ -26,18 +26,20 @@ public:
      * 
      * Performs complete system initialization in the correct order:
      * 1. Hardware (Serial)
-     * 2. WiFi connection
+     * 2. WiFi credentials and NTP
      * 3. Application components (stove, scheduler, etc.)
-     * 4. Blynk IoT platform
-     * 5. FreeRTOS tasks
+     * 4. Blynk hooks and the network link
+     * 5. FreeRTOS tasks (including the network task, which connects)
+     * 
+     * Does not wait for the network.
      */
     void initialize();
     
     /**
      * @brief Execute main application loop
      * 
-     * Processes Blynk events and timer callbacks. Called repeatedly
-     * from Arduino loop() function.
+     * Idles: Blynk events and timer callbacks run in the network task.
+     * Called repeatedly from Arduino loop() function.
      */
     void run();
 
@@ -48,12 +50,12 @@ private:
     void initializeHardware();
     
     /**
-     * @brief Connect to WiFi network and configure NTP time
+     * @brief Load WiFi credentials and configure NTP time
      */
     void initializeWiFi();
     
     /**
-     * @brief Initialize Blynk IoT connection and attach hooks
+     * @brief Attach Blynk hooks and configure the network link (no connect)
      */
     void initializeBlynk();
     
@@ -66,8 +68,6 @@ private:
      * @brief Create and start all FreeRTOS tasks
      */
     void initializeTasks();
-    
-    bool mWiFiConnected;  ///< WiFi connection status flag
 };
 
 /** @brief Global application instance */
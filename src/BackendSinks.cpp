@@ -0,0 +1,81 @@
+/**
+ * @file BackendSinks.cpp
+ * @brief StatusSink implementations for the built-in backends
+ */
+
+#include "BackendSinks.h"
+#include "StatusPublisher.h"
+#include "BlynkGlobal.h"
+#include "MqttLink.h"
+#include "LocalApi.h"
+#include "UdpStatus.h"
+#include "BufferPrint.h"
+#include "AppGlobals.h"
+#include "Logging.h"
+
+BlynkStatusSink gBlynkSink;
+MqttStatusSink gMqttSink;
+StreamStatusSink gStreamSink;
+LogStatusSink gLogSink;
+
+void registerBackendSinks() {
+    gStatusPublisher.addSink(gBlynkSink);
+    gStatusPublisher.addSink(gMqttSink);
+    gStatusPublisher.addSink(gUdpStatus);
+    gStatusPublisher.addSink(gStreamSink);
+    gStatusPublisher.addSink(gLogSink);
+}
+
+void BlynkStatusSink::deliver(const StatusFrame& f, uint8_t mask) {
+    if (mask & SF_STATE) {
+        BlynkWrapper::virtualWrite(VPIN_STOVE_STATE_NUM, (int)f.state);
+        BlynkWrapper::virtualWrite(VPIN_STOVE_STATE_STRING, f.stateName);
+    }
+    if (mask & SF_POWER) BlynkWrapper::virtualWrite(VPIN_POWER_LEVEL_READ, f.power);
+    if (mask & SF_TEMP) BlynkWrapper::virtualWrite(VPIN_AMBIENT_TEMP, f.temp);
+    if (mask & SF_TIMER) BlynkWrapper::virtualWrite(VPIN_AUTO_SHUTDOWN_REMAIN, f.timerMin);
+    // SF_ON: the Blynk switch follows the UI gating in StatusPublisher::pushStatus().
+}
+
+bool MqttStatusSink::ready() const {
+    return gMqtt.connected();
+}
+
+void MqttStatusSink::deliver(const StatusFrame& f, uint8_t mask) {
+    if (mask & SF_STATE) {
+        gMqtt.publish("state_num", f.text[StatusFrame::index(SF_STATE)]);
+        gMqtt.publish("state", f.stateName);
+    }
+    if (mask & SF_ON) gMqtt.publish("onoff", f.text[StatusFrame::index(SF_ON)]);
+    if (mask & SF_POWER) gMqtt.publish("power", f.text[StatusFrame::index(SF_POWER)]);
+    if (mask & SF_TEMP) gMqtt.publish("temp", f.text[StatusFrame::index(SF_TEMP)]);
+    if (mask & SF_TIMER) gMqtt.publish("timer_remain", f.text[StatusFrame::index(SF_TIMER)]);
+}
+
+void StreamStatusSink::deliver(const StatusFrame& f, uint8_t mask) {
+    if (!gLocalApi.hasStreamClients()) return;  // New clients get the full status on connect.
+    char msg[LOCAL_API_WS_FRAME_MAX];
+    BufferPrint out(msg, sizeof(msg));
+    f.writeJson(mask, out);
+    if (!out.overflowed()) gLocalApi.broadcast(out.c_str(), out.length());
+}
+
+bool LogStatusSink::ready() const {
+    // Lines would land in the middle of the one being edited (and 'quiet on' mutes them).
+    return !gTerminal.isUserTyping();
+}
+
+void LogStatusSink::deliver(const StatusFrame& f, uint8_t mask) {
+    static const char* const NAMES[SF_COUNT] = {"state", "on", "power", "temp", "timer"};
+    char line[96];
+    BufferPrint out(line, sizeof(line));
+    out.print("[STATUS]");
+    for (uint8_t i = 0; i < SF_COUNT; i++) {
+        if (!(mask & (1 << i))) continue;
+        out.write(' ');
+        out.print(NAMES[i]);
+        out.write('=');
+        out.print((1 << i) == SF_STATE ? f.stateName : f.text[i]);
+    }
+    logInfo(line);
+}
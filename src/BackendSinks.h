@@ -0,0 +1,58 @@
+/**
+ * @file BackendSinks.h
+ * @brief StatusSink implementations for the built-in backends
+ *
+ * | Sink      | Output                          | Interval | Coalesce | Priority |
+ * |-----------|---------------------------------|----------|----------|----------|
+ * | blynk     | Virtual pins                    | -        | yes      | 0        |
+ * | mqtt      | Retained topics under base/     | -        | yes      | 1        |
+ * | udp       | LAN beacon frames (UdpStatus.h) | -        | yes      | 1        |
+ * | stream    | WebSocket JSON deltas (/ws)     | 250 ms   | yes      | 2        |
+ * | log       | One line on Serial              | 5 s      | yes      | 3        |
+ *
+ * Per-channel deadbands and rate limits stay in StatusPublisher (one decision
+ * for everybody); the intervals here only thin out what a given sink sees.
+ */
+
+#pragma once
+
+#include "StatusSink.h"
+#include "Config.h"
+
+/** @brief Blynk virtual pins (inside the publisher's Blynk batch) */
+class BlynkStatusSink : public StatusSink {
+public:
+    BlynkStatusSink() : StatusSink("blynk", {0, true, 0}) {}
+    void deliver(const StatusFrame& f, uint8_t mask) override;
+};
+
+/** @brief Retained MQTT topics; waits while the broker session is down */
+class MqttStatusSink : public StatusSink {
+public:
+    MqttStatusSink() : StatusSink("mqtt", {0, true, 1}) {}
+    void deliver(const StatusFrame& f, uint8_t mask) override;
+    bool ready() const override;
+};
+
+/** @brief WebSocket stream of JSON deltas (nothing is built without clients) */
+class StreamStatusSink : public StatusSink {
+public:
+    StreamStatusSink() : StatusSink("stream", {STREAM_SINK_MIN_INTERVAL_MS, true, 2}) {}
+    void deliver(const StatusFrame& f, uint8_t mask) override;
+};
+
+/** @brief Compact status line on Serial; holds its fields while someone types at the terminal */
+class LogStatusSink : public StatusSink {
+public:
+    LogStatusSink() : StatusSink("log", {LOG_SINK_MIN_INTERVAL_MS, true, 3}) {}
+    void deliver(const StatusFrame& f, uint8_t mask) override;
+    bool ready() const override;
+};
+
+extern BlynkStatusSink gBlynkSink;
+extern MqttStatusSink gMqttSink;
+extern StreamStatusSink gStreamSink;
+extern LogStatusSink gLogSink;
+
+/** @brief Register the built-in sinks with gStatusPublisher (before the network task starts) */
+void registerBackendSinks();
@@ -7,11 +7,28 @@
 #include "AppGlobals.h"
 #include "UIGating.h"
 #include "Config.h"
+#include "StatusPublisher.h"
+#include "TelemetryBuffer.h"
+#include "BackendSinks.h"
+#include "Logging.h"
 #include <BlynkSimpleEsp32.h>
 
+// The summary and table pins carry up to SCHED_SUMMARY_MAX_LEN characters in
+// one message; with the library defaults (128/256) Blynk drops them silently.
+#if BLYNK_MAX_SENDBYTES < SCHED_SUMMARY_MAX_LEN + 16 || BLYNK_MAX_READBYTES < SCHED_SUMMARY_MAX_LEN + 16
+#error "Set BLYNK_MAX_SENDBYTES/BLYNK_MAX_READBYTES to at least SCHED_SUMMARY_MAX_LEN + 16 (see platformio.ini)"
+#endif
+
 // =================== Blynk Event Handlers ===================
 BLYNK_CONNECTED() {
     Serial.println("[BLYNK] Connected, synchronizing.");
+    // The server may have lost or changed widget state while offline.
+    BlynkWrapper::invalidateShadow();
+    gStatusPublisher.resync(gBlynkSink);
+    if (gTelemetry.pending()) {
+        logf("[BLYNK] %u muestras pendientes de reenvío (%lu descartadas).",
+             (unsigned)gTelemetry.pending(), (unsigned long)gTelemetry.takeDropped());
+    }
     Blynk.syncVirtual(VPIN_STOVE_POWER_SWITCH,
                       VPIN_POWER_LEVEL_WRITE,
                       VPIN_SET_TIMER_MIN,
@@ -20,85 +37,387 @@ BLYNK_CONNECTED() {
 }
 
 BLYNK_WRITE(VPIN_STOVE_POWER_SWITCH) {
+    BlynkWrapper::invalidatePin(request.pin);
     gBlynk.handleOnOff(param.asInt());
 }
 
 BLYNK_WRITE(VPIN_POWER_LEVEL_WRITE) {
+    BlynkWrapper::invalidatePin(request.pin);
     gBlynk.handleSetPower((uint8_t)param.asInt());
 }
 
 BLYNK_WRITE(VPIN_SET_TIMER_MIN) {
+    BlynkWrapper::invalidatePin(request.pin);
     gBlynk.handleSetTimer((uint32_t)param.asInt());
 }
 
 BLYNK_WRITE(VPIN_SCHED_GLOBAL_ENABLE) {
+    BlynkWrapper::invalidatePin(request.pin);
     gBlynk.handleSchedulerEnable(param.asInt());
 }
 
 BLYNK_WRITE(VPIN_SCHED_INDEX) {
+    BlynkWrapper::invalidatePin(request.pin);
     size_t idx = (size_t)param.asInt();
     gBlynk.updateSchedIndex(idx);
     ScheduleEntry e = gScheduler.getEntry(idx >= MAX_SCHEDULE_ENTRIES ? MAX_SCHEDULE_ENTRIES - 1 : idx);
-    gBlynk.updateSchedActive(e.active);
-    gBlynk.updateSchedDay((uint8_t)e.day);
-    gBlynk.updateSchedHour(e.hour);
-    gBlynk.updateSchedMinute(e.minute);
-    gBlynk.updateSchedPower(e.targetPower);
+    if (e.isEmpty()) e = ScheduleEntry::make(false, DM_MON, 0, 0, 1, SCHED_ACTION_START, SCHED_DEFAULT_GRACE_MIN);
+    gBlynk.updateSchedActive(e.active());
+    gBlynk.updateSchedDays(e.dayMask());
+    gBlynk.updateSchedHour(e.hour());
+    gBlynk.updateSchedMinute(e.minute());
+    gBlynk.updateSchedPower(e.targetPower());
+    gBlynk.updateSchedAction((uint8_t)e.action());
+    gBlynk.updateSchedGrace(e.graceMinutes());
     gBlynk.reflectPendingSchedulerFields();
 }
 
 BLYNK_WRITE(VPIN_SCHED_ACTIVE) {
+    BlynkWrapper::invalidatePin(request.pin);
     gBlynk.updateSchedActive(param.asInt() == 1);
 }
 
 BLYNK_WRITE(VPIN_SCHED_DAY) {
-    gBlynk.updateSchedDay((uint8_t)param.asInt());
+    BlynkWrapper::invalidatePin(request.pin);
+    gBlynk.updateSchedDays((uint8_t)param.asInt());
 }
 
 BLYNK_WRITE(VPIN_SCHED_HOUR) {
+    BlynkWrapper::invalidatePin(request.pin);
     gBlynk.updateSchedHour((uint8_t)param.asInt());
 }
 
 BLYNK_WRITE(VPIN_SCHED_MINUTE) {
+    BlynkWrapper::invalidatePin(request.pin);
     gBlynk.updateSchedMinute((uint8_t)param.asInt());
 }
 
 BLYNK_WRITE(VPIN_SCHED_POWER) {
+    BlynkWrapper::invalidatePin(request.pin);
     gBlynk.updateSchedPower((uint8_t)param.asInt());
 }
 
+BLYNK_WRITE(VPIN_SCHED_ACTION) {
+    BlynkWrapper::invalidatePin(request.pin);
+    gBlynk.updateSchedAction((uint8_t)param.asInt());
+}
+
 BLYNK_WRITE(VPIN_SCHED_APPLY) {
+    BlynkWrapper::invalidatePin(request.pin);
     if (param.asInt() == 1) {
         gBlynk.handleSchedulerApply();
     }
 }
 
+BLYNK_WRITE(VPIN_SCHED_CRON) {
+    BlynkWrapper::invalidatePin(request.pin);
+    gBlynk.handleSchedulerCron(param.asStr());
+}
+
+BLYNK_WRITE(VPIN_SCHED_TABLE) {
+    BlynkWrapper::invalidatePin(request.pin);
+    gBlynk.handleSchedulerTable(param.asStr());
+}
+
 BLYNK_WRITE(VPIN_SCHED_REFRESH) {
+    BlynkWrapper::invalidatePin(request.pin);
     if (param.asInt() == 1) {
-        gBlynk.pushSchedulerSummary(gScheduler.buildSummary());
+        // An explicit refresh always resends, even an unchanged summary.
+        BlynkWrapper::invalidatePin(VPIN_SCHED_SUMMARY);
+        BlynkWrapper::invalidatePin(VPIN_SCHED_TABLE);
+        gBlynk.pushSchedulerSummary();
+        gBlynk.pushSchedulerTable();
+    }
+}
+
+// =================== Shadow Cache ===================
+namespace {
+    enum ShadowKind : uint8_t { SHADOW_NONE = 0, SHADOW_INT = 1, SHADOW_TEXT = 2 };
+
+    /** @brief Last value and properties sent on one virtual pin */
+    struct PinShadow {
+        uint32_t value;                                   ///< Int value or hash of the text
+        ShadowKind kind;                                  ///< What value holds
+        uint8_t nextProp;                                 ///< Round-robin slot to replace
+        uint32_t propKey[BLYNK_SHADOW_PROPS_PER_PIN];     ///< Hash of the property name (0 = free)
+        uint32_t propValue[BLYNK_SHADOW_PROPS_PER_PIN];   ///< Hash of the property value
+    };
+
+    PinShadow sShadow[BLYNK_SHADOW_PINS];
+
+    uint32_t fnv1a(const char* s) {
+        uint32_t h = 2166136261UL;
+        while (*s) {
+            h ^= (uint8_t)*s++;
+            h *= 16777619UL;
+        }
+        return h ? h : 1;
+    }
+
+    /** @brief Record a value; returns false if it equals the last one sent */
+    bool shadowValue(uint8_t pin, ShadowKind kind, uint32_t value) {
+        if (pin >= BLYNK_SHADOW_PINS) return true;
+        PinShadow& p = sShadow[pin];
+        if (p.kind == kind && p.value == value) return false;
+        p.kind = kind;
+        p.value = value;
+        return true;
+    }
+
+    /** @brief Record a property; returns false if it equals the last one sent */
+    bool shadowProperty(uint8_t pin, const char* property, const char* value) {
+        if (pin >= BLYNK_SHADOW_PINS) return true;
+        PinShadow& p = sShadow[pin];
+        const uint32_t key = fnv1a(property);
+        const uint32_t val = fnv1a(value);
+        for (uint8_t i = 0; i < BLYNK_SHADOW_PROPS_PER_PIN; i++) {
+            if (p.propKey[i] != key) continue;
+            if (p.propValue[i] == val) return false;
+            p.propValue[i] = val;
+            return true;
+        }
+        uint8_t slot = p.nextProp;
+        p.nextProp = (uint8_t)((slot + 1) % BLYNK_SHADOW_PROPS_PER_PIN);
+        p.propKey[slot] = key;
+        p.propValue[slot] = val;
+        return true;
+    }
+}
+
+// =================== Per-tick Batch ===================
+namespace {
+    enum BatchKind : uint8_t { BATCH_INT = 0, BATCH_TEXT = 1, BATCH_PROP = 2 };
+
+    /** @brief One queued pin update */
+    struct BatchItem {
+        uint8_t pin;        ///< Virtual pin
+        uint8_t priority;   ///< Send class (lower goes first)
+        BatchKind kind;     ///< Value, text or property
+        uint8_t seq;        ///< Queue order, keeps the sort stable
+        int32_t value;      ///< Int value
+        uint16_t text;      ///< Pool offset of the text, or of "name\0value\0"
+    };
+
+    BatchItem sBatch[BLYNK_BATCH_MAX_ITEMS];
+    char sPool[BLYNK_BATCH_TEXT_POOL];
+    uint16_t sPoolUsed = 0;
+    uint8_t sBatchCount = 0;
+    uint8_t sBatchSeq = 0;
+    uint8_t sBatchDepth = 0;
+
+    const uint16_t POOL_FULL = 0xFFFF;
+
+    /** @brief Send class of a pin: state, control, telemetry, then the rest */
+    uint8_t pinPriority(uint8_t pin) {
+        switch (pin) {
+            case VPIN_STOVE_STATE_NUM:
+            case VPIN_STOVE_STATE_STRING:
+            case VPIN_STOVE_POWER_SWITCH:   return 0;
+            case VPIN_POWER_LEVEL_READ:
+            case VPIN_POWER_LEVEL_WRITE:    return 1;
+            case VPIN_AMBIENT_TEMP:
+            case VPIN_AUTO_SHUTDOWN_REMAIN:
+            case VPIN_TIME_TO_SAFE_OFF:
+            case VPIN_SAFETY_MIN_TIME:      return 2;
+            default:                        return 3;
+        }
+    }
+
+    /** @brief Copy one or two strings into the pool, POOL_FULL if they do not fit */
+    uint16_t poolAdd(const char* a, const char* b = nullptr) {
+        size_t la = strlen(a) + 1;
+        size_t lb = b ? strlen(b) + 1 : 0;
+        if (sPoolUsed + la + lb > sizeof(sPool)) return POOL_FULL;
+        uint16_t off = sPoolUsed;
+        memcpy(sPool + sPoolUsed, a, la);
+        if (b) memcpy(sPool + sPoolUsed + la, b, lb);
+        sPoolUsed = (uint16_t)(sPoolUsed + la + lb);
+        return off;
+    }
+
+    void sendInt(uint8_t pin, int value) {
+        if (shadowValue(pin, SHADOW_INT, (uint32_t)value)) Blynk.virtualWrite(pin, value);
+    }
+
+    void sendText(uint8_t pin, const char* value) {
+        if (shadowValue(pin, SHADOW_TEXT, fnv1a(value))) Blynk.virtualWrite(pin, value);
+    }
+
+    void sendProperty(uint8_t pin, const char* property, const char* value) {
+        if (shadowProperty(pin, property, value)) Blynk.setProperty(pin, property, value);
+    }
+
+    /**
+     * @brief Send everything queued: values in priority order (grouped when
+     *        there are enough of them), then properties (they cannot be grouped)
+     */
+    void flushBatch() {
+        for (uint8_t i = 1; i < sBatchCount; i++) {
+            BatchItem item = sBatch[i];
+            uint8_t j = i;
+            while (j > 0 && (sBatch[j - 1].priority > item.priority ||
+                             (sBatch[j - 1].priority == item.priority && sBatch[j - 1].seq > item.seq))) {
+                sBatch[j] = sBatch[j - 1];
+                j--;
+            }
+            sBatch[j] = item;
+        }
+        // A group costs two extra messages and saves none, so it is only
+        // worth it when enough values change together.
+        bool changed[BLYNK_BATCH_MAX_ITEMS];
+        uint8_t changedCount = 0;
+        for (uint8_t i = 0; i < sBatchCount; i++) {
+            const BatchItem& it = sBatch[i];
+            changed[i] = false;
+            if (it.kind == BATCH_PROP) continue;
+            changed[i] = (it.kind == BATCH_INT) ? shadowValue(it.pin, SHADOW_INT, (uint32_t)it.value)
+                                                : shadowValue(it.pin, SHADOW_TEXT, fnv1a(sPool + it.text));
+            if (changed[i]) changedCount++;
+        }
+        bool grouped = changedCount >= BLYNK_BATCH_GROUP_MIN;
+        if (grouped) Blynk.beginGroup();
+        for (uint8_t i = 0; i < sBatchCount; i++) {
+            if (!changed[i]) continue;
+            const BatchItem& it = sBatch[i];
+            if (it.kind == BATCH_INT) Blynk.virtualWrite(it.pin, (int)it.value);
+            else Blynk.virtualWrite(it.pin, (const char*)(sPool + it.text));
+        }
+        if (grouped) Blynk.endGroup();
+        for (uint8_t i = 0; i < sBatchCount; i++) {
+            const BatchItem& it = sBatch[i];
+            if (it.kind != BATCH_PROP) continue;
+            const char* name = sPool + it.text;
+            sendProperty(it.pin, name, name + strlen(name) + 1);
+        }
+        sBatchCount = 0;
+        sBatchSeq = 0;
+        sPoolUsed = 0;
+    }
+
+    /**
+     * @brief Queue an update, replacing an earlier one for the same pin
+     *        (and property)
+     * @return false if it cannot be queued and must be sent directly
+     */
+    bool queue(uint8_t pin, BatchKind kind, int32_t value, const char* a, const char* b) {
+        for (uint8_t i = 0; i < sBatchCount; i++) {
+            BatchItem& it = sBatch[i];
+            if (it.pin != pin || it.kind != kind) continue;
+            if (kind == BATCH_PROP && strcmp(sPool + it.text, a) != 0) continue;
+            if (kind == BATCH_INT) { it.value = value; return true; }
+            uint16_t off = poolAdd(a, b);
+            if (off == POOL_FULL) return false;
+            it.text = off;
+            return true;
+        }
+        if (sBatchCount == BLYNK_BATCH_MAX_ITEMS) flushBatch();
+        uint16_t off = 0;
+        if (kind != BATCH_INT) {
+            off = poolAdd(a, b);
+            if (off == POOL_FULL) {
+                flushBatch();
+                off = poolAdd(a, b);
+                if (off == POOL_FULL) return false;
+            }
+        }
+        BatchItem& it = sBatch[sBatchCount++];
+        it.pin = pin;
+        it.priority = pinPriority(pin);
+        it.kind = kind;
+        it.seq = sBatchSeq++;
+        it.value = value;
+        it.text = off;
+        return true;
+    }
+
+    /**
+     * @brief Replay a few buffered trend samples with their original time
+     *
+     * Rate-limited to TELEMETRY_REPLAY_BATCH records per
+     * TELEMETRY_REPLAY_INTERVAL_MS so a long outage does not end in a burst.
+     */
+    void replayTelemetry() {
+        static uint32_t lastReplayMs = 0;
+        if (!gTelemetry.pending()) return;
+        uint32_t nowMs = millis();
+        if (nowMs - lastReplayMs < TELEMETRY_REPLAY_INTERVAL_MS) return;
+        lastReplayMs = nowMs;
+        time_t now = time(nullptr);
+        if (now < SCHED_TIME_VALID_EPOCH) return;  // Records are stamped from the wall clock.
+        const uint64_t nowEpochMs = (uint64_t)now * 1000ULL;
+        TelemetryBuffer::Record r;
+        for (uint8_t i = 0; i < TELEMETRY_REPLAY_BATCH && gTelemetry.peek(r); i++) {
+            Blynk.beginGroup(nowEpochMs - (uint32_t)(nowMs - r.ms));
+            Blynk.virtualWrite(r.pin, (int)r.value);
+            Blynk.endGroup();
+            gTelemetry.pop();
+            BlynkWrapper::invalidatePin(r.pin);
+        }
+        // History is in; make sure the live values are the last word.
+        if (!gTelemetry.pending()) gStatusPublisher.resync(gBlynkSink);
     }
 }
 
 // =================== Wrapper Functions ===================
 namespace BlynkWrapper {
     void virtualWrite(uint8_t pin, int value) {
-        Blynk.virtualWrite(pin, value);
+        if (!Blynk.connected()) {
+            if (TelemetryBuffer::isTrendPin(pin)) gTelemetry.record(pin, value, millis());
+            return;
+        }
+        if (sBatchDepth && queue(pin, BATCH_INT, value, nullptr, nullptr)) return;
+        sendInt(pin, value);
     }
     
     void virtualWrite(uint8_t pin, const String& value) {
-        Blynk.virtualWrite(pin, value);
+        virtualWrite(pin, value.c_str());
+    }
+    
+    void virtualWrite(uint8_t pin, const char* value) {
+        if (!Blynk.connected()) return;  // UI text: the reconnect resync sends the latest.
+        if (sBatchDepth && queue(pin, BATCH_TEXT, 0, value, nullptr)) return;
+        if (sBatchDepth) flushBatch();  // Oversized text: keep the queued updates first.
+        sendText(pin, value);
     }
     
     void setProperty(uint8_t pin, const char* property, const char* value) {
-        Blynk.setProperty(pin, property, value);
+        if (!Blynk.connected()) return;
+        if (sBatchDepth && queue(pin, BATCH_PROP, 0, property, value)) return;
+        if (sBatchDepth) flushBatch();
+        sendProperty(pin, property, value);
+    }
+    
+    void beginBatch() {
+        sBatchDepth++;
+    }
+    
+    void endBatch() {
+        if (!sBatchDepth) return;
+        if (--sBatchDepth == 0) flushBatch();
+    }
+    
+    void invalidatePin(uint8_t pin) {
+        if (pin < BLYNK_SHADOW_PINS) sShadow[pin].kind = SHADOW_NONE;
+    }
+    
+    void invalidateShadow() {
+        memset(sShadow, 0, sizeof(sShadow));
     }
     
     void syncVirtual(uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4, uint8_t pin5) {
         Blynk.syncVirtual(pin1, pin2, pin3, pin4, pin5);
     }
     
-    void begin(const char* auth, const char* ssid, const char* pass) {
-        Blynk.begin(auth, ssid, pass);
+    void config(const char* auth) {
+        Blynk.config(auth);
+    }
+    
+    bool connect(uint32_t timeoutMs) {
+        return Blynk.connect(timeoutMs);
+    }
+    
+    void disconnect() {
+        Blynk.disconnect();
     }
     
     bool connected() {
@@ -107,5 +426,6 @@ namespace BlynkWrapper {
     
     void run() {
         Blynk.run();
+        if (Blynk.connected()) replayTelemetry();
     }
 }
@@ -9,6 +9,16 @@
  * 
  * Other modules should use BlynkWrapper:: functions instead of directly
  * accessing the Blynk object to maintain proper encapsulation.
+ *
+ * The wrapper keeps a shadow of the last value and widget properties sent on
+ * each virtual pin and drops writes that would not change anything, so
+ * periodic UI refreshes cost no cloud traffic. The shadow is cleared on
+ * (re)connect and per pin whenever the app writes that pin. Like the Blynk
+ * library itself, the wrapper must only be used from the network task.
+ *
+ * While the link is down, writes to trend pins go to gTelemetry and are
+ * replayed with their original timestamps by run() after reconnect; other
+ * writes are dropped and resent by the reconnect resync.
  */
 
 #pragma once
@@ -37,6 +47,13 @@ namespace BlynkWrapper {
      */
     void virtualWrite(uint8_t pin, const String& value);
     
+    /**
+     * @brief Write a C string to a virtual pin (no String copy)
+     * @param pin Virtual pin number
+     * @param value NUL-terminated text to write
+     */
+    void virtualWrite(uint8_t pin, const char* value);
+    
     /**
      * @brief Set a property of a virtual pin widget
      * @param pin Virtual pin number
@@ -45,6 +62,41 @@ namespace BlynkWrapper {
      */
     void setProperty(uint8_t pin, const char* property, const char* value);
     
+    /**
+     * @brief Start collecting pin updates instead of sending them
+     *
+     * Until the matching endBatch(), writes and properties are queued (a
+     * later update of the same pin replaces the earlier one). Calls nest.
+     */
+    void beginBatch();
+    
+    /**
+     * @brief Send the collected updates
+     *
+     * Values that changed go out ordered by pin class (state, control,
+     * telemetry, rest) and then by queue order; properties follow in the
+     * same order. Every value is its own message; from BLYNK_BATCH_GROUP_MIN
+     * changed values on they are wrapped in a Blynk group so the dashboard
+     * applies them together.
+     */
+    void endBatch();
+    
+    /**
+     * @brief Forget the last value sent on a pin
+     * @param pin Virtual pin number
+     *
+     * Called when the app writes the pin, so the widget no longer shows what
+     * the device last sent and the next write must go out even if equal.
+     */
+    void invalidatePin(uint8_t pin);
+    
+    /**
+     * @brief Forget every cached value and property (forces a full resync)
+     *
+     * Called on (re)connect.
+     */
+    void invalidateShadow();
+    
     /**
      * @brief Synchronize multiple virtual pins with the server
      * @param pin1 First virtual pin to sync
@@ -56,12 +108,22 @@ namespace BlynkWrapper {
     void syncVirtual(uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4, uint8_t pin5);
     
     /**
-     * @brief Initialize Blynk connection
+     * @brief Set the Blynk credentials without connecting (WiFi is managed separately)
      * @param auth Blynk authentication token
-     * @param ssid WiFi SSID
-     * @param pass WiFi password
      */
-    void begin(const char* auth, const char* ssid, const char* pass);
+    void config(const char* auth);
+    
+    /**
+     * @brief Try to log in to the Blynk server
+     * @param timeoutMs Longest time to block waiting for the login
+     * @return true if connected
+     */
+    bool connect(uint32_t timeoutMs);
+    
+    /**
+     * @brief Close the Blynk connection
+     */
+    void disconnect();
     
     /**
      * @brief Check if Blynk is connected to the server
@@ -70,7 +132,7 @@ namespace BlynkWrapper {
     bool connected();
     
     /**
-     * @brief Process Blynk events (must be called in loop)
+     * @brief Process Blynk events and replay buffered telemetry (network task, while connected)
      */
     void run();
 }
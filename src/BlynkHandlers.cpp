@@ -9,60 +9,90 @@
 #include "BlynkHandlers.h"
 #include "AppGlobals.h"
 #include "UIGating.h"
+#include "StatusPublisher.h"
 #include "Config.h"
+#include "Logging.h"
+
+/**
+ * @brief Post a UI command; on rejection log it
+ * @return The post result, handed back to the front end that sent the command
+ *
+ * The caller only locks its widget for accepted commands; a rejected one
+ * snaps the widget back to the stove's actual value instead.
+ */
+static CommandBus::Result postFromUi(const Command& c) {
+    CommandBus::Result r = gCommandBus.post(c);
+    if (r == CommandBus::REJECTED) logf("[CMD] Cola llena: %s rechazado.", CommandBus::typeName(c.type));
+    return r;
+}
 
 void setupBlynkCallbacks() {
     gBlynk.setOnOffCallback([](bool turnOn) {
-        uiGate.onOffLocked = true;
-        uiGate.onOffLockStart = millis();
-        uiGate.reqOnOffDisable = true;
-        if (gCommandQueue) {
-            Command c{turnOn ? Command::START : Command::SHUTDOWN, 0, 0, 0, false, 0, 0, 0, 0};
-            xQueueSend(gCommandQueue, &c, portMAX_DELAY);
+        Command c{turnOn ? Command::START : Command::SHUTDOWN, 0, 0, 0, {0}};
+        StoveStatus s;
+        CommandBus::Result r = postFromUi(c);
+        if (r == CommandBus::REJECTED) {
+            if (latestStatus(s)) gBlynk.enableOnOff(s.isOn);
+            return r;
         }
+        uiGate.lock(GATE_ONOFF, millis(), turnOn ? 1 : 0);
+        gStatusPublisher.requestPush();
+        return r;
     });
 
     gBlynk.setPowerCallback([](uint8_t p) {
-        uiGate.powerLocked = true;
-        uiGate.powerLockStart = millis();
-        uiGate.reqPowerDisable = true;
-        if (gCommandQueue) {
-            Command c{Command::SET_POWER, p, 0, 0, false, 0, 0, 0, 0};
-            xQueueSend(gCommandQueue, &c, portMAX_DELAY);
+        Command c{Command::SET_POWER, p, 0, 0, {0}};
+        StoveStatus s;
+        CommandBus::Result r = postFromUi(c);
+        if (r == CommandBus::REJECTED) {
+            if (latestStatus(s)) gBlynk.enablePowerSlider(s.powerLevel);
+            return r;
         }
+        uiGate.lock(GATE_POWER, millis());
+        gStatusPublisher.requestPush();
+        return r;
     });
 
     gBlynk.setTimerCallback([](uint32_t m) {
-        uiGate.timerLocked = true;
-        uiGate.timerLockStart = millis();
-        uiGate.reqTimerDisable = true;
-        if (gCommandQueue) {
-            Command c{Command::SET_TIMER, 0, m, 0, false, 0, 0, 0, 0};
-            xQueueSend(gCommandQueue, &c, portMAX_DELAY);
+        Command c{Command::SET_TIMER, 0, m, 0, {0}};
+        StoveStatus s;
+        CommandBus::Result r = postFromUi(c);
+        if (r == CommandBus::REJECTED) {
+            if (latestStatus(s)) gBlynk.enableTimerInput((s.autoShutdownRemainingMs + 59999UL) / 60000UL);
+            return r;
         }
+        uiGate.lock(GATE_TIMER, millis());
+        gStatusPublisher.requestPush();
+        return r;
     });
 
     gBlynk.setSchedulerEnableCallback([](bool en) {
         gScheduler.setGlobalEnabled(en);
     });
 
-    gBlynk.setSchedulerApplyCallback([](size_t idx, bool active, uint8_t day, uint8_t hour, uint8_t minute, uint8_t power) {
-        uiGate.schedLocked = true;
-        uiGate.schedLockStart = millis();
-        uiGate.reqSchedDisable = true;
-        if (gCommandQueue) {
-            Command c;
-            c.type = Command::SCHED_APPLY;
-            c.schedIndex = idx;
-            c.schedActive = active;
-            c.schedDay = day;
-            c.schedHour = hour;
-            c.schedMinute = minute;
-            c.schedPower = power;
-            c.power = 0;
-            c.minutes = 0;
-            xQueueSend(gCommandQueue, &c, portMAX_DELAY);
+    gBlynk.setSchedulerApplyCallback([](size_t idx, const ScheduleEntry& entry) {
+        Command c;
+        c.type = Command::SCHED_APPLY;
+        c.schedIndex = idx;
+        c.schedEntry = entry;
+        c.power = 0;
+        c.minutes = 0;
+        if (postFromUi(c) == CommandBus::REJECTED) {
+            gBlynk.enableSchedulerApply();
+            return;
         }
+        uiGate.lock(GATE_SCHED, millis());
+        gStatusPublisher.requestPush();
+    });
+
+    gBlynk.setSchedulerCronCallback([](size_t idx, const char* text) {
+        return gScheduler.setCronRule((int)idx, text);
+    });
+
+    gBlynk.setSchedulerTableCallback([](const char* text, ScheduleImportResult& res) {
+        if (gScheduler.importTable(text, res)) return true;
+        logf("[SCHED] Tabla rechazada (registro %u: %s), sin cambios.", (unsigned)res.record, res.error);
+        return false;
     });
 }
 
@@ -1,4 +1,5 @@
 #include "BlynkInterface.h"
+#include "BufferPrint.h"
 
 void BlynkInterface::begin(StoveController* controller, Scheduler* scheduler){
   _controller=controller;
@@ -8,7 +9,7 @@ void BlynkInterface::begin(StoveController* controller, Scheduler* scheduler){
 void BlynkInterface::attachBlynkHooks(
   void(*writeFn)(uint8_t pin,int val),
   void(*propFn)(uint8_t pin,const char* prop,const char* value),
-  void(*textFn)(uint8_t pin,const String& txt)
+  void(*textFn)(uint8_t pin,const char* txt)
 ){
   _writeFn=writeFn;
   _propFn=propFn;
@@ -42,43 +43,59 @@ void BlynkInterface::enableSchedulerApply(){
 void BlynkInterface::disableSchedulerApply(){
   if (_propFn) _propFn(VPIN_SCHED_APPLY,"isDisabled","true");
 }
-void BlynkInterface::pushSchedulerSummary(const String& sum){
-  if (_textFn) _textFn(VPIN_SCHED_SUMMARY, sum);
+void BlynkInterface::pushSchedulerSummary(){
+  if (!_textFn || !_scheduler) return;
+  _scheduler->writeSummary(_summaryBuf,sizeof(_summaryBuf));
+  _textFn(VPIN_SCHED_SUMMARY, _summaryBuf);
+}
+void BlynkInterface::pushSchedulerTable(){
+  if (!_textFn || !_scheduler) return;
+  BufferPrint out(_summaryBuf,sizeof(_summaryBuf));
+  if (!_scheduler->exportTable(out,';')){
+    _textFn(VPIN_SCHED_TABLE, "ERR: regla cron no exportable");
+    return;
+  }
+  _textFn(VPIN_SCHED_TABLE, out.overflowed() ? "ERR: tabla demasiado grande, usar 'sched export'" : _summaryBuf);
 }
 
-void BlynkInterface::setOnOffCallback(void(*cb)(bool)){ _onOffCb=cb; }
-void BlynkInterface::setPowerCallback(void(*cb)(uint8_t)){ _powerCb=cb; }
-void BlynkInterface::setTimerCallback(void(*cb)(uint32_t)){ _timerCb=cb; }
+void BlynkInterface::setOnOffCallback(CommandBus::Result(*cb)(bool)){ _onOffCb=cb; }
+void BlynkInterface::setPowerCallback(CommandBus::Result(*cb)(uint8_t)){ _powerCb=cb; }
+void BlynkInterface::setTimerCallback(CommandBus::Result(*cb)(uint32_t)){ _timerCb=cb; }
 void BlynkInterface::setSchedulerEnableCallback(void(*cb)(bool)){ _schedEnableCb=cb; }
-void BlynkInterface::setSchedulerApplyCallback(void(*cb)(size_t,bool,uint8_t,uint8_t,uint8_t,uint8_t)){ _schedApplyCb=cb; }
+void BlynkInterface::setSchedulerApplyCallback(void(*cb)(size_t,const ScheduleEntry&)){ _schedApplyCb=cb; }
+void BlynkInterface::setSchedulerCronCallback(bool(*cb)(size_t,const char*)){ _schedCronCb=cb; }
+void BlynkInterface::setSchedulerTableCallback(bool(*cb)(const char*,ScheduleImportResult&)){ _schedTableCb=cb; }
 
 void BlynkInterface::updateSchedIndex(size_t idx){ _pendingIdx=idx; }
 void BlynkInterface::updateSchedActive(bool active){ _pendingActive=active; }
-void BlynkInterface::updateSchedDay(uint8_t day){ _pendingDay=day; }
+void BlynkInterface::updateSchedDays(uint8_t dayMask){ _pendingDays=dayMask; }
 void BlynkInterface::updateSchedHour(uint8_t hour){ _pendingHour=hour; }
 void BlynkInterface::updateSchedMinute(uint8_t minute){ _pendingMinute=minute; }
 void BlynkInterface::updateSchedPower(uint8_t power){ _pendingPower=power; }
+void BlynkInterface::updateSchedAction(uint8_t action){ _pendingAction=action; }
+void BlynkInterface::updateSchedGrace(uint8_t minutes){ _pendingGrace=minutes; }
 
 void BlynkInterface::reflectPendingSchedulerFields(){
   if (_writeFn){
     _writeFn(VPIN_SCHED_ACTIVE, _pendingActive?1:0);
-    _writeFn(VPIN_SCHED_DAY, _pendingDay);
+    _writeFn(VPIN_SCHED_DAY, _pendingDays);
     _writeFn(VPIN_SCHED_HOUR, _pendingHour);
     _writeFn(VPIN_SCHED_MINUTE, _pendingMinute);
     _writeFn(VPIN_SCHED_POWER, _pendingPower);
+    _writeFn(VPIN_SCHED_ACTION, _pendingAction);
   }
 }
 
-void BlynkInterface::handleOnOff(int val){
-  if (_onOffCb) _onOffCb(val==1);
+CommandBus::Result BlynkInterface::handleOnOff(int val){
+  return _onOffCb ? _onOffCb(val==1) : CommandBus::REJECTED;
 }
 
-void BlynkInterface::handleSetPower(uint8_t p){
-  if (_powerCb) _powerCb(p);
+CommandBus::Result BlynkInterface::handleSetPower(uint8_t p){
+  return _powerCb ? _powerCb(p) : CommandBus::REJECTED;
 }
 
-void BlynkInterface::handleSetTimer(uint32_t minutes){
-  if (_timerCb) _timerCb(minutes);
+CommandBus::Result BlynkInterface::handleSetTimer(uint32_t minutes){
+  return _timerCb ? _timerCb(minutes) : CommandBus::REJECTED;
 }
 
 void BlynkInterface::handleSchedulerEnable(int val){
@@ -86,5 +103,88 @@ void BlynkInterface::handleSchedulerEnable(int val){
 }
 
 void BlynkInterface::handleSchedulerApply(){
-  if (_schedApplyCb) _schedApplyCb(_pendingIdx,_pendingActive,_pendingDay,_pendingHour,_pendingMinute,_pendingPower);
-}
\ No newline at end of file
+  if (!_schedApplyCb) return;
+  if (_pendingDays==0 || _pendingDays>DM_ALL || _pendingHour>23 || _pendingMinute>59 ||
+      _pendingAction>SCHED_ACTION_SHUTDOWN){
+    logInfo("[SCHED] Entrada pendiente fuera de rango, no aplicada.");
+    return;
+  }
+  ScheduleEntry e=ScheduleEntry::make(_pendingActive,_pendingDays,_pendingHour,_pendingMinute,
+                                      _pendingPower,(ScheduleAction)_pendingAction,_pendingGrace);
+  _schedApplyCb(_pendingIdx,e);
+}
+bool BlynkInterface::handleSchedulerCron(const char* text, const char** error){
+  if (!_schedCronCb || !text){ if (error) *error="scheduler not ready"; return false; }
+  char* rest=nullptr;
+  long idx=strtol(text,&rest,10);
+  if (rest==text || idx<0 || idx>=(long)MAX_CRON_RULES){
+    if (_textFn) _textFn(VPIN_SCHED_CRON, "idx?");
+    if (error) *error="bad rule index";
+    return false;
+  }
+  bool ok=_schedCronCb((size_t)idx,rest);
+  if (_textFn) _textFn(VPIN_SCHED_CRON, ok ? "OK" : "ERR");
+  if (!ok){ if (error) *error="invalid cron rule"; return false; }
+  pushSchedulerSummary();
+  return true;
+}
+bool BlynkInterface::handleSchedulerTable(const char* text, const char** error){
+  if (!_schedTableCb || !text){ if (error) *error="scheduler not ready"; return false; }
+  ScheduleImportResult res;
+  if (!_schedTableCb(text,res)){
+    char msg[56];
+    snprintf(msg,sizeof(msg),"ERR %u: %s",(unsigned)res.record,res.error ? res.error : "?");
+    if (_textFn) _textFn(VPIN_SCHED_TABLE, msg);
+    snprintf(_cmdError,sizeof(_cmdError),"record %u: %s",(unsigned)res.record,res.error ? res.error : "?");
+    if (error) *error=_cmdError;
+    return false;
+  }
+  pushSchedulerTable();
+  pushSchedulerSummary();
+  return true;
+}
+
+/** @brief Parse 1/0/on/off/true/false; -1 if none of them */
+static int parseSwitch(const char* v){
+  if (!strcmp(v,"1") || !strcasecmp(v,"on") || !strcasecmp(v,"true")) return 1;
+  if (!strcmp(v,"0") || !strcasecmp(v,"off") || !strcasecmp(v,"false")) return 0;
+  return -1;
+}
+
+/** @brief Map a post result to a command outcome */
+static BlynkInterface::CommandOutcome posted(CommandBus::Result r, const char** error){
+  if (r!=CommandBus::REJECTED) return BlynkInterface::CMD_OK;
+  if (error) *error="queue full";
+  return BlynkInterface::CMD_QUEUE_FULL;
+}
+
+BlynkInterface::CommandOutcome BlynkInterface::handleCommand(const char* name, const char* value, const char** error){
+  if (error) *error="bad value";
+  if (!name || !value) return CMD_INVALID;
+  char* end=nullptr;
+  if (!strcmp(name,"onoff")){
+    int on=parseSwitch(value);
+    if (on<0) return CMD_INVALID;
+    return posted(handleOnOff(on),error);
+  }
+  if (!strcmp(name,"power")){
+    long p=strtol(value,&end,10);
+    if (end==value || p<1 || p>5) return CMD_INVALID;
+    return posted(handleSetPower((uint8_t)p),error);
+  }
+  if (!strcmp(name,"timer")){
+    long m=strtol(value,&end,10);
+    if (end==value || m<0) return CMD_INVALID;
+    return posted(handleSetTimer((uint32_t)m),error);
+  }
+  if (!strcmp(name,"sched")){
+    int en=parseSwitch(value);
+    if (en<0) return CMD_INVALID;
+    handleSchedulerEnable(en);
+    return CMD_OK;
+  }
+  if (!strcmp(name,"cron")) return handleSchedulerCron(value,error) ? CMD_OK : CMD_INVALID;
+  if (!strcmp(name,"table")) return handleSchedulerTable(value,error) ? CMD_OK : CMD_INVALID;
+  if (error) *error="unknown command";
+  return CMD_INVALID;
+}
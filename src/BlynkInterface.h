@@ -14,6 +14,7 @@
 #include "Logging.h"
 #include "StoveController.h"
 #include "Scheduler.h"
+#include "CommandBus.h"
 
 /**
  * @class BlynkInterface
@@ -25,6 +26,13 @@
  */
 class BlynkInterface {
 public:
+  /** @brief Outcome of handleCommand() */
+  enum CommandOutcome {
+    CMD_OK,          ///< Queued or applied
+    CMD_INVALID,     ///< Unknown name or bad value; error says which
+    CMD_QUEUE_FULL   ///< Valid, but the command bus rejected it (nothing queued)
+  };
+
   // ========================================================================
   // Initialization
   // ========================================================================
@@ -45,7 +53,7 @@ public:
   void attachBlynkHooks(
     void(*writeFn)(uint8_t pin, int val),
     void(*propFn)(uint8_t pin, const char* prop, const char* value),
-    void(*textFn)(uint8_t pin, const String& txt)
+    void(*textFn)(uint8_t pin, const char* txt)
   );
 
   // ========================================================================
@@ -96,10 +104,21 @@ public:
   void disableSchedulerApply();
   
   /**
-   * @brief Push scheduler summary text to the Blynk UI
-   * @param sum Summary string to display
+   * @brief Push the scheduler summary text to the Blynk UI
+   *
+   * Formatted into a static buffer of SCHED_SUMMARY_MAX_LEN bytes; no heap
+   * allocation. Call from the Blynk context only.
+   */
+  void pushSchedulerSummary();
+
+  /**
+   * @brief Push the whole schedule as one line of import records to VPIN_SCHED_TABLE
+   *
+   * Shares the summary buffer. A table that does not fit is not sent in
+   * part (its leading "clear" would wipe the rest on re-import); an error
+   * pointing to the terminal's 'sched export' is shown instead.
    */
-  void pushSchedulerSummary(const String& sum);
+  void pushSchedulerTable();
 
   // ========================================================================
   // User Interaction Callbacks
@@ -107,21 +126,24 @@ public:
   
   /**
    * @brief Set callback for on/off button press
-   * @param cb Callback function receiving desired state (true = turn on)
+   * @param cb Callback function receiving desired state (true = turn on);
+   *        returns what CommandBus::post() did with it
    */
-  void setOnOffCallback(void(*cb)(bool));
+  void setOnOffCallback(CommandBus::Result(*cb)(bool));
   
   /**
    * @brief Set callback for power level change
-   * @param cb Callback function receiving desired power level (1-5)
+   * @param cb Callback function receiving desired power level (1-5);
+   *        returns what CommandBus::post() did with it
    */
-  void setPowerCallback(void(*cb)(uint8_t));
+  void setPowerCallback(CommandBus::Result(*cb)(uint8_t));
   
   /**
    * @brief Set callback for timer configuration
-   * @param cb Callback function receiving timer duration in minutes
+   * @param cb Callback function receiving timer duration in minutes;
+   *        returns what CommandBus::post() did with it
    */
-  void setTimerCallback(void(*cb)(uint32_t));
+  void setTimerCallback(CommandBus::Result(*cb)(uint32_t));
   
   /**
    * @brief Set callback for global scheduler enable/disable
@@ -131,9 +153,22 @@ public:
   
   /**
    * @brief Set callback for applying scheduler entry changes
-   * @param cb Callback function receiving (index, active, day, hour, minute, power)
+   * @param cb Callback function receiving (index, packed entry)
+   */
+  void setSchedulerApplyCallback(void(*cb)(size_t, const ScheduleEntry&));
+
+  /**
+   * @brief Set callback for cron rule text edits
+   * @param cb Callback function receiving (index, rule text or "clear");
+   *        returns true if the rule was accepted
    */
-  void setSchedulerApplyCallback(void(*cb)(size_t, bool, uint8_t, uint8_t, uint8_t, uint8_t));
+  void setSchedulerCronCallback(bool(*cb)(size_t, const char*));
+
+  /**
+   * @brief Set callback for applying a batch of schedule records
+   * @param cb Function receiving the records and filling the result; returns true if applied
+   */
+  void setSchedulerTableCallback(bool(*cb)(const char*, ScheduleImportResult&));
 
   // ========================================================================
   // Scheduler Temporary Field Updates
@@ -152,10 +187,10 @@ public:
   void updateSchedActive(bool active);
   
   /**
-   * @brief Update pending entry day of week
-   * @param day Day value (1=Monday, 7=Sunday)
+   * @brief Update pending entry day mask
+   * @param dayMask Days the entry fires on (bit 0 = Monday ... bit 6 = Sunday)
    */
-  void updateSchedDay(uint8_t day);
+  void updateSchedDays(uint8_t dayMask);
   
   /**
    * @brief Update pending entry hour
@@ -175,32 +210,49 @@ public:
    */
   void updateSchedPower(uint8_t power);
   
+  /**
+   * @brief Update pending entry action
+   * @param action ScheduleAction value (0 = start, 1 = power, 2 = off)
+   */
+  void updateSchedAction(uint8_t action);
+  
+  /**
+   * @brief Update pending entry late-fire grace window
+   * @param minutes Grace window in minutes (0 = skip missed occurrences)
+   *
+   * Not exposed as a widget; carried over from the selected entry.
+   */
+  void updateSchedGrace(uint8_t minutes);
+  
   /**
    * @brief Reflect current pending scheduler fields to Blynk widgets
    */
   void reflectPendingSchedulerFields();
 
   // ========================================================================
-  // Input Handlers (called from Blynk event handlers)
+  // Input Handlers (called from Blynk event handlers and MqttLink)
   // ========================================================================
   
   /**
    * @brief Handle on/off button change
    * @param val Button state (1 = turn on, 0 = turn off)
+   * @return Post result (REJECTED if the queue was full or no callback is set)
    */
-  void handleOnOff(int val);
+  CommandBus::Result handleOnOff(int val);
   
   /**
    * @brief Handle power slider change
    * @param p New power level (1-5)
+   * @return Post result (REJECTED if the queue was full or no callback is set)
    */
-  void handleSetPower(uint8_t p);
+  CommandBus::Result handleSetPower(uint8_t p);
   
   /**
    * @brief Handle timer input change
    * @param minutes Timer duration in minutes
+   * @return Post result (REJECTED if the queue was full or no callback is set)
    */
-  void handleSetTimer(uint32_t minutes);
+  CommandBus::Result handleSetTimer(uint32_t minutes);
   
   /**
    * @brief Handle scheduler global enable switch
@@ -213,6 +265,40 @@ public:
    */
   void handleSchedulerApply();
 
+  /**
+   * @brief Handle a cron rule typed into the cron text widget
+   * @param text "<idx> <min> <hour> <dom> <mon> <dow> <action> [power]"
+   *        or "<idx> clear"
+   * @param error Receives the reason on failure (optional)
+   * @return true if the rule was stored
+   */
+  bool handleSchedulerCron(const char* text, const char** error = nullptr);
+
+  /**
+   * @brief Handle a batch of schedule records typed into the table widget
+   * @param text Records separated by ';' (see Scheduler::exportTable())
+   *
+   * Applied as one transaction; the widget then shows the resulting table,
+   * or "ERR <record>: <reason>" with the table left unchanged.
+   * @param error Receives "record <n>: <reason>" on failure (optional)
+   * @return true if the batch was applied
+   */
+  bool handleSchedulerTable(const char* text, const char** error = nullptr);
+
+  /**
+   * @brief Handle a named command from a text front end (MQTT, local API)
+   * @param name onoff | power | timer | sched | cron | table
+   * @param value 1/0/on/off, power 1-5, minutes, cron text or schedule records
+   * @param error Receives the reason on failure (optional; valid until the
+   *        next command)
+   * @return CMD_INVALID if the name is unknown, the value invalid, or the
+   *         scheduler rejected the rule or table; CMD_QUEUE_FULL if the
+   *         command bus had no room for it
+   *
+   * Routes to the handle*() method the matching widget uses.
+   */
+  CommandOutcome handleCommand(const char* name, const char* value, const char** error = nullptr);
+
 private:
   // ========================================================================
   // Internal State
@@ -224,20 +310,26 @@ private:
   // Blynk output function pointers
   void(*_writeFn)(uint8_t, int) = nullptr;                       ///< Write value to virtual pin
   void(*_propFn)(uint8_t, const char*, const char*) = nullptr;   ///< Set widget property
-  void(*_textFn)(uint8_t, const String&) = nullptr;              ///< Send text to virtual pin
+  void(*_textFn)(uint8_t, const char*) = nullptr;                ///< Send text to virtual pin
+  char _summaryBuf[SCHED_SUMMARY_MAX_LEN];                       ///< Scheduler summary scratch buffer
+  char _cmdError[48];                                            ///< Reason of the last rejected table
 
   // User action callback pointers
-  void(*_onOffCb)(bool) = nullptr;                                              ///< On/off callback
-  void(*_powerCb)(uint8_t) = nullptr;                                           ///< Power change callback
-  void(*_timerCb)(uint32_t) = nullptr;                                          ///< Timer callback
+  CommandBus::Result(*_onOffCb)(bool) = nullptr;                                ///< On/off callback
+  CommandBus::Result(*_powerCb)(uint8_t) = nullptr;                             ///< Power change callback
+  CommandBus::Result(*_timerCb)(uint32_t) = nullptr;                            ///< Timer callback
   void(*_schedEnableCb)(bool) = nullptr;                                        ///< Scheduler enable callback
-  void(*_schedApplyCb)(size_t, bool, uint8_t, uint8_t, uint8_t, uint8_t) = nullptr;  ///< Scheduler apply callback
+  void(*_schedApplyCb)(size_t, const ScheduleEntry&) = nullptr;                ///< Scheduler apply callback
+  bool(*_schedCronCb)(size_t, const char*) = nullptr;                           ///< Cron rule callback
+  bool(*_schedTableCb)(const char*, ScheduleImportResult&) = nullptr;           ///< Schedule batch callback
 
   // Pending scheduler entry fields (temporary storage before applying)
   size_t  _pendingIdx = 0;        ///< Pending entry index
   bool    _pendingActive = false; ///< Pending entry active state
-  uint8_t _pendingDay = 1;        ///< Pending entry day (1-7)
+  uint8_t _pendingDays = DM_MON;  ///< Pending entry day mask (1-127)
   uint8_t _pendingHour = 0;       ///< Pending entry hour (0-23)
   uint8_t _pendingMinute = 0;     ///< Pending entry minute (0-59)
   uint8_t _pendingPower = 1;      ///< Pending entry power level (1-5)
+  uint8_t _pendingAction = SCHED_ACTION_START;  ///< Pending entry action
+  uint8_t _pendingGrace = SCHED_DEFAULT_GRACE_MIN;  ///< Pending entry grace window (minutes)
 };
\ No newline at end of file
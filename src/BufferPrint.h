@@ -0,0 +1,65 @@
+/**
+ * @file BufferPrint.h
+ * @brief Print sink writing into a caller-supplied fixed buffer
+ *
+ * Lets formatters that stream into a Print (Serial, a socket, ...) also fill
+ * a static char array without touching the heap. Output that does not fit is
+ * dropped and flagged; the buffer always stays NUL-terminated.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @class BufferPrint
+ * @brief Bounded, allocation-free Print implementation over a char buffer
+ */
+class BufferPrint : public Print {
+public:
+    /**
+     * @brief Wrap a buffer
+     * @param buf Destination buffer
+     * @param cap Capacity of buf in bytes, including the terminating NUL
+     */
+    BufferPrint(char* buf, size_t cap) : mBuf(buf), mCap(cap) { clear(); }
+
+    size_t write(uint8_t c) override {
+        if (mLen + 1 >= mCap) { mOverflow = true; return 0; }
+        mBuf[mLen++] = (char)c;
+        mBuf[mLen] = '\0';
+        return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        if (!mCap) { mOverflow = mOverflow || len; return 0; }
+        size_t room = mCap - 1 - mLen;
+        if (len > room) { len = room; mOverflow = true; }
+        memcpy(mBuf + mLen, data, len);
+        mLen += len;
+        mBuf[mLen] = '\0';
+        return len;
+    }
+
+    /** @brief Discard the contents and the overflow flag */
+    void clear() {
+        mLen = 0;
+        mOverflow = false;
+        if (mCap) mBuf[0] = '\0';
+    }
+
+    /** @brief NUL-terminated contents */
+    const char* c_str() const { return mBuf; }
+
+    /** @brief Number of characters stored */
+    size_t length() const { return mLen; }
+
+    /** @brief true if some output was dropped for lack of space */
+    bool overflowed() const { return mOverflow; }
+
+private:
+    char* mBuf;             ///< Destination buffer
+    size_t mCap;            ///< Capacity including NUL
+    size_t mLen = 0;        ///< Characters stored
+    bool mOverflow = false; ///< Output was truncated
+};
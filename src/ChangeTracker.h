@@ -0,0 +1,108 @@
+/**
+ * @file ChangeTracker.h
+ * @brief Per-channel publish decision: deadband, rate limit and staleness
+ *
+ * Each published telemetry channel owns one tracker holding the value last
+ * published and when. update() answers "publish this now?" in O(1):
+ * - the first value is always published;
+ * - a change of at least the deadband is published once minIntervalMs has
+ *   passed since the previous publish (a change held back by the interval
+ *   is published by the first update() after it, not lost);
+ * - whatever the value, it is published again once maxStaleMs has passed
+ *   since the previous publish (0 = never), so consumers that missed a
+ *   publish or joined late are refreshed. Sinks that must not repeat
+ *   themselves filter duplicates on their side (Blynk's shadow cache).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+
+namespace ChangeTrackerDetail {
+    template <typename T>
+    inline bool same(const T& a, const T& b) { return a == b; }
+
+    inline bool same(float a, float b) { return (isnan(a) && isnan(b)) || a == b; }
+
+    template <typename T>
+    inline bool beyond(const T& a, const T& b, const T& deadband) {
+        return (a > b ? a - b : b - a) >= deadband;
+    }
+
+    inline bool beyond(float a, float b, float deadband) {
+        if (isnan(a) || isnan(b)) return true;
+        return fabsf(a - b) >= deadband;
+    }
+}
+
+/**
+ * @class ChangeTracker
+ * @brief Decides when a value on one channel is worth publishing
+ * @tparam T Arithmetic value type (int, float, ...)
+ */
+template <typename T>
+class ChangeTracker {
+public:
+    /**
+     * @param deadband Smallest change published at the normal rate (0 = any change)
+     * @param minIntervalMs Minimum time between two publishes
+     * @param maxStaleMs Longest time without a publish, changed or not (0 = no limit)
+     */
+    ChangeTracker(T deadband, uint32_t minIntervalMs, uint32_t maxStaleMs)
+        : mDeadband(deadband), mMinIntervalMs(minIntervalMs), mMaxStaleMs(maxStaleMs) {}
+
+    /**
+     * @brief Offer a new value
+     * @param value Current value of the channel
+     * @param nowMs Current millis()
+     * @return true if the caller should publish value now (it is recorded as published)
+     */
+    bool update(const T& value, uint32_t nowMs) {
+        if (mHasValue) {
+            uint32_t elapsed = nowMs - mLastMs;
+            bool stale = mMaxStaleMs && elapsed >= mMaxStaleMs;
+            bool big = !ChangeTrackerDetail::same(value, mLast) &&
+                       ChangeTrackerDetail::beyond(value, mLast, mDeadband);
+            if (!stale && !(big && elapsed >= mMinIntervalMs)) return false;
+        }
+        mLast = value;
+        mLastMs = nowMs;
+        mHasValue = true;
+        return true;
+    }
+
+    /**
+     * @brief Time until update(value) would publish, without recording anything
+     * @param value Current value of the channel
+     * @param nowMs Current millis()
+     * @return 0 if due now, UINT32_MAX if value will never be published
+     *         (no change beyond the deadband and no staleness limit)
+     */
+    uint32_t dueInMs(const T& value, uint32_t nowMs) const {
+        if (!mHasValue) return 0;
+        uint32_t elapsed = nowMs - mLastMs;
+        uint32_t due = UINT32_MAX;
+        if (mMaxStaleMs) due = elapsed >= mMaxStaleMs ? 0 : mMaxStaleMs - elapsed;
+        if (!ChangeTrackerDetail::same(value, mLast) &&
+            ChangeTrackerDetail::beyond(value, mLast, mDeadband)) {
+            uint32_t wait = elapsed >= mMinIntervalMs ? 0 : mMinIntervalMs - elapsed;
+            if (wait < due) due = wait;
+        }
+        return due;
+    }
+
+    /** @brief Forget the published value; the next update() publishes */
+    void reset() { mHasValue = false; }
+
+    /** @brief Value last published (meaningless before the first publish) */
+    const T& last() const { return mLast; }
+
+private:
+    T mDeadband;               ///< Change published at the normal rate
+    uint32_t mMinIntervalMs;   ///< Rate limit between publishes
+    uint32_t mMaxStaleMs;      ///< Forced refresh period (0 = off)
+    T mLast{};                 ///< Last published value
+    uint32_t mLastMs = 0;      ///< millis() of the last publish
+    bool mHasValue = false;    ///< Something has been published
+};
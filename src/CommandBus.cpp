@@ -0,0 +1,196 @@
+/**
+ * @file CommandBus.cpp
+ * @brief Non-blocking command intake implementation
+ */
+
+#include "CommandBus.h"
+
+CommandBus gCommandBus;
+
+bool CommandBus::begin() {
+    mMutex = xSemaphoreCreateMutex();
+    mReady = xSemaphoreCreateBinary();
+    return mMutex && mReady;
+}
+
+uint32_t CommandBus::keyOf(const Command& c) {
+    switch (c.type) {
+        case Command::START:
+        case Command::SHUTDOWN:    return 0;
+        case Command::SET_POWER:   return 1;
+        case Command::SET_TIMER:   return 2;
+        case Command::SCHED_APPLY: return 3 + (uint32_t)c.schedIndex;
+    }
+    return UINT32_MAX;
+}
+
+CommandBus::Result CommandBus::post(const Command& c) {
+    if (!mMutex) return REJECTED;
+    Result r = ACCEPTED;
+    const uint32_t key = keyOf(c);
+
+    xSemaphoreTake(mMutex, portMAX_DELAY);  // Held for a few copies, never across execution.
+    mStats.posted++;
+    // A shutdown the safety rules refuse leaves the stove on: its adjustments still stand.
+    const bool stopping = c.type == Command::SHUTDOWN && (!mShutdownGate || mShutdownGate());
+    if (mStats.busy && mInFlight && (c.type != Command::SHUTDOWN || stopping) &&
+        mInFlight(c, mStats.busyType)) r = RETARGETED;
+    for (uint8_t i = 0; i < mCount; i++) {
+        if (keyOf(mItems[i]) != key) continue;
+        if (r != RETARGETED) r = mItems[i].type == c.type ? COALESCED : REPLACED;
+        // The newer command goes to the back: it must not overtake what was queued after the old one.
+        removeAt(i);
+        break;
+    }
+    if (stopping) {
+        // Power and timer changes queued for a stove that is going off are stale.
+        for (uint8_t i = mCount; i-- > 0;) {
+            if (mItems[i].type != Command::SET_POWER && mItems[i].type != Command::SET_TIMER) continue;
+            removeAt(i);
+            mStats.cancelled++;
+        }
+    }
+    if (r == RETARGETED) {
+        // Already executing; a stale pending one (dropped above) must not undo it.
+        mStats.retargeted++;
+    } else if (mCount == COMMAND_QUEUE_LEN) {
+        r = REJECTED;
+        mStats.rejected++;
+    } else {
+        mItems[mCount++] = c;
+        if (mCount > mStats.highWater) mStats.highWater = mCount;
+        if (r == COALESCED) mStats.coalesced++;
+        if (r == REPLACED) mStats.replaced++;
+    }
+    xSemaphoreGive(mMutex);
+
+    if (r != REJECTED) xSemaphoreGive(mReady);
+    return r;
+}
+
+void CommandBus::removeAt(uint8_t i) {
+    memmove(&mItems[i], &mItems[i + 1], (mCount - i - 1) * sizeof(Command));
+    mCount--;
+}
+
+bool CommandBus::take(Command& out, TickType_t wait) {
+    if (!mMutex) return false;
+    while (true) {
+        xSemaphoreTake(mMutex, portMAX_DELAY);
+        if (mCount) {
+            uint8_t next = 0;
+            for (uint8_t i = 0; i < mCount; i++) {
+                if (isPriority(mItems[i].type)) { next = i; break; }
+            }
+            out = mItems[next];
+            removeAt(next);
+            mStats.busy = true;
+            mStats.busyType = out.type;
+            mBusySinceMs = millis();
+            xSemaphoreGive(mMutex);
+            return true;
+        }
+        xSemaphoreGive(mMutex);
+        // Posts that coalesced leave extra gives behind; an empty pass just waits again.
+        if (xSemaphoreTake(mReady, wait) != pdTRUE) return false;
+    }
+}
+
+void CommandBus::done() {
+    if (!mMutex) return;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    mStats.busy = false;
+    mStats.executed++;
+    xSemaphoreGive(mMutex);
+}
+
+bool CommandBus::isActive(Command::Type type) {
+    if (!mMutex) return false;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    bool active = mStats.busy && mStats.busyType == type;
+    for (uint8_t i = 0; i < mCount && !active; i++) active = mItems[i].type == type;
+    xSemaphoreGive(mMutex);
+    return active;
+}
+
+CommandBus::Stats CommandBus::stats() {
+    Stats s = {};
+    if (!mMutex) return s;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    s = mStats;
+    s.depth = mCount;
+    s.busyForMs = s.busy ? millis() - mBusySinceMs : 0;
+    xSemaphoreGive(mMutex);
+    return s;
+}
+
+const char* CommandBus::typeName(Command::Type type) {
+    switch (type) {
+        case Command::START: return "START";
+        case Command::SHUTDOWN: return "SHUTDOWN";
+        case Command::SET_POWER: return "SET_POWER";
+        case Command::SET_TIMER: return "SET_TIMER";
+        case Command::SCHED_APPLY: return "SCHED_APPLY";
+    }
+    return "?";
+}
+
+const char* CommandBus::resultName(Result r) {
+    switch (r) {
+        case ACCEPTED: return "aceptado";
+        case COALESCED: return "agrupado";
+        case REPLACED: return "reemplazado";
+        case RETARGETED: return "redirigido";
+        case REJECTED: return "rechazado";
+    }
+    return "?";
+}
+
+void CommandBus::printStatus(Print& out) {
+    if (!mMutex) {
+        out.print("\r\n[CMD] Bus no creado.");
+        return;
+    }
+    char line[128];
+    Stats s = stats();
+    snprintf(line, sizeof(line), "\r\n[CMD] Cola: %u/%u (máx %u)  en curso: %s",
+             (unsigned)s.depth, (unsigned)COMMAND_QUEUE_LEN, (unsigned)s.highWater,
+             s.busy ? typeName(s.busyType) : "-");
+    out.print(line);
+    if (s.busy) {
+        snprintf(line, sizeof(line), " (%lu ms)", (unsigned long)s.busyForMs);
+        out.print(line);
+    }
+    snprintf(line, sizeof(line), "\r\n[CMD] Recibidos %lu  agrupados %lu  reemplazados %lu  redirigidos %lu",
+             (unsigned long)s.posted, (unsigned long)s.coalesced, (unsigned long)s.replaced,
+             (unsigned long)s.retargeted);
+    out.print(line);
+    snprintf(line, sizeof(line), "\r\n[CMD] Cancelados por apagado %lu  rechazados %lu  ejecutados %lu",
+             (unsigned long)s.cancelled, (unsigned long)s.rejected, (unsigned long)s.executed);
+    out.print(line);
+
+    // Copy under the lock, print outside it: the terminal may be slow.
+    Command pending[COMMAND_QUEUE_LEN];
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    uint8_t n = mCount;
+    memcpy(pending, mItems, n * sizeof(Command));
+    xSemaphoreGive(mMutex);
+    for (uint8_t i = 0; i < n; i++) {
+        const Command& c = pending[i];
+        switch (c.type) {
+            case Command::SET_POWER:
+                snprintf(line, sizeof(line), "\r\n  %u. %s %u", (unsigned)i + 1, typeName(c.type), (unsigned)c.power);
+                break;
+            case Command::SET_TIMER:
+                snprintf(line, sizeof(line), "\r\n  %u. %s %lu min", (unsigned)i + 1, typeName(c.type), (unsigned long)c.minutes);
+                break;
+            case Command::SCHED_APPLY:
+                snprintf(line, sizeof(line), "\r\n  %u. %s #%u", (unsigned)i + 1, typeName(c.type), (unsigned)c.schedIndex);
+                break;
+            default:
+                snprintf(line, sizeof(line), "\r\n  %u. %s (prioritario)", (unsigned)i + 1, typeName(c.type));
+                break;
+        }
+        out.print(line);
+    }
+}
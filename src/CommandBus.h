@@ -0,0 +1,169 @@
+/**
+ * @file CommandBus.h
+ * @brief Non-blocking command intake for the control task
+ *
+ * Replaces the FreeRTOS command queue. post() never waits for the control
+ * task: the bus lock is held only while a few Command structs are copied,
+ * never while a command executes, so the network task (Blynk, MQTT, HTTP)
+ * and the scheduler return immediately even while taskComm spends seconds
+ * in a power ramp or a shutdown.
+ *
+ * Backpressure is explicit and per command type. Each command has a
+ * coalescing key; a new command whose key is already pending takes the
+ * pending one's place at the back of the queue:
+ * | Type         | Key          | On a pending match                      |
+ * |--------------|--------------|-----------------------------------------|
+ * | START        | on/off       | coalesced (START) / replaced (SHUTDOWN) |
+ * | SHUTDOWN     | on/off       | coalesced (SHUTDOWN) / replaced (START) |
+ * | SET_POWER    | power        | coalesced: latest level wins            |
+ * | SET_TIMER    | timer        | coalesced: latest minutes win           |
+ * | SCHED_APPLY  | entry index  | coalesced: latest edit of that entry    |
+ * Only a command with no pending match can find the queue full; it is
+ * rejected and the caller gives feedback (the Blynk widget snaps back).
+ *
+ * Two lanes share the buffer: START and SHUTDOWN (safety lane) are taken
+ * before any queued adjustment, oldest first within each lane. A SHUTDOWN
+ * the controller will carry out (see setShutdownGate()) also cancels the
+ * pending SET_POWER and SET_TIMER commands, which would be stale once the
+ * stove goes off. A shutdown therefore waits at most for the command
+ * already executing, never for the queue depth. One the safety rules will
+ * refuse (minimum on-time) cancels nothing: the stove stays on and the
+ * adjustments still apply.
+ *
+ * A command posted while another executes is first offered to the in-flight
+ * hook (setInFlightHook()): a SET_POWER arriving during a power adjustment
+ * redirects it, and a SHUTDOWN that passes the gate cuts it short.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "Scheduler.h"
+#include "Config.h"
+
+/**
+ * @struct Command
+ * @brief Command structure for task communication via the command bus
+ * 
+ * Commands are sent between tasks to perform stove operations such as
+ * starting, stopping, power adjustment, timer setting, and schedule updates.
+ */
+struct Command {
+  /** @brief Command type enumeration */
+  enum Type { START, SHUTDOWN, SET_POWER, SET_TIMER, SCHED_APPLY } type;
+  
+  uint8_t power;              ///< Power level (1-5) for SET_POWER command
+  uint32_t minutes;           ///< Timer duration in minutes for SET_TIMER command
+  size_t schedIndex;          ///< Schedule entry index for SCHED_APPLY command
+  ScheduleEntry schedEntry;   ///< Packed schedule entry for SCHED_APPLY command
+};
+
+/**
+ * @class CommandBus
+ * @brief Bounded, coalescing command queue with a non-blocking producer side
+ */
+class CommandBus {
+public:
+    /** @brief Outcome of post() */
+    enum Result {
+        ACCEPTED,   ///< Appended
+        COALESCED,  ///< Superseded a pending command of the same type
+        REPLACED,   ///< Superseded a pending command of another type (START <-> SHUTDOWN)
+        RETARGETED, ///< Taken over by the executing command (see setInFlightHook())
+        REJECTED    ///< Queue full (or bus not created); nothing queued
+    };
+
+    /** @brief Counters since boot and the current depth */
+    struct Stats {
+        uint8_t depth;          ///< Commands pending
+        uint8_t highWater;      ///< Deepest the queue has been
+        uint32_t posted;        ///< post() calls
+        uint32_t coalesced;     ///< Results COALESCED
+        uint32_t replaced;      ///< Results REPLACED
+        uint32_t retargeted;    ///< Results RETARGETED
+        uint32_t cancelled;     ///< Adjustments dropped by an accepted SHUTDOWN
+        uint32_t rejected;      ///< Results REJECTED
+        uint32_t executed;      ///< Commands finished by the consumer
+        bool busy;              ///< A command is executing
+        Command::Type busyType; ///< Type of the executing command
+        uint32_t busyForMs;     ///< How long it has been executing
+    };
+
+    /**
+     * @brief Create the lock and the wake-up semaphore
+     * @return false if FreeRTOS could not allocate them
+     */
+    bool begin();
+
+    /**
+     * @brief Install the hook that lets the executing command react to a new one
+     * @param hook Called (under the bus lock) with the posted command and the
+     *        type of the executing one; returns true if the running execution
+     *        took the command over (it is then not queued). Must not block or post.
+     */
+    void setInFlightHook(bool (*hook)(const Command& c, Command::Type executing)) { mInFlight = hook; }
+
+    /**
+     * @brief Install the check that a SHUTDOWN posted now will be accepted
+     * @param gate Called (under the bus lock) when a SHUTDOWN is posted; only
+     *        if it returns true are pending adjustments cancelled and the
+     *        in-flight hook offered the shutdown. Must not block or post.
+     *        Without a gate every SHUTDOWN counts as accepted.
+     */
+    void setShutdownGate(bool (*gate)()) { mShutdownGate = gate; }
+
+    /**
+     * @brief Queue a command without waiting for the consumer
+     * @param c Command to queue
+     * @return What happened to it; REJECTED means the caller must give feedback
+     */
+    Result post(const Command& c);
+
+    /** @brief Whether a command type travels in the safety lane */
+    static bool isPriority(Command::Type type) { return type == Command::START || type == Command::SHUTDOWN; }
+
+    /**
+     * @brief Take the next command: the oldest START/SHUTDOWN, else the oldest one (consumer task)
+     * @param out Receives the command
+     * @param wait Ticks to wait for one
+     * @return false on timeout
+     *
+     * Call done() once the command has been executed.
+     */
+    bool take(Command& out, TickType_t wait);
+
+    /** @brief Mark the command returned by take() as executed */
+    void done();
+
+    /** @brief Whether a command of this type is pending or executing */
+    bool isActive(Command::Type type);
+
+    /** @brief Snapshot of the counters */
+    Stats stats();
+
+    /** @brief Depth, counters, the executing command and the pending ones */
+    void printStatus(Print& out);
+
+    static const char* typeName(Command::Type type);
+    static const char* resultName(Result r);
+
+private:
+    /** @brief Coalescing key: commands with equal keys supersede each other */
+    static uint32_t keyOf(const Command& c);
+
+    /** @brief Drop mItems[i] (lock held) */
+    void removeAt(uint8_t i);
+
+    Command mItems[COMMAND_QUEUE_LEN];      ///< Pending commands, oldest first
+    uint8_t mCount = 0;                     ///< Entries used in mItems
+    SemaphoreHandle_t mMutex = nullptr;     ///< Guards everything below
+    SemaphoreHandle_t mReady = nullptr;     ///< Given on every post() that queued something
+    Stats mStats = {};                      ///< Counters (depth filled in by stats())
+    uint32_t mBusySinceMs = 0;              ///< millis() the executing command was taken
+    bool (*mInFlight)(const Command&, Command::Type) = nullptr; ///< See setInFlightHook()
+    bool (*mShutdownGate)() = nullptr;      ///< See setShutdownGate()
+};
+
+extern CommandBus gCommandBus;
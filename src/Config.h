@@ -39,6 +39,97 @@ static const char* WIFI_SSID = "YourNetworkSSID";
 /** @brief WiFi network password */
 static const char* WIFI_PASS = "YourNetworkPassword";
 
+// ============================================================================
+// MQTT (LAN) BACKEND
+// ============================================================================
+
+/** @brief Default broker host; empty keeps MQTT off until set with 'mqtt set' */
+static const char* MQTT_HOST_DEFAULT = "";
+
+/** @brief Default broker port */
+#define MQTT_PORT_DEFAULT       1883
+
+/** @brief Prefix of every topic (state on <base>/x, commands on <base>/set/x) */
+#define MQTT_BASE_TOPIC         "micronova"
+
+/** @brief MQTT client identifier (must be unique on the broker) */
+#define MQTT_CLIENT_ID          "micronova-stove"
+
+/** @brief MQTT keep-alive interval (seconds) */
+#define MQTT_KEEPALIVE_S        30
+
+/** @brief Longest wait for a broker reply during login (seconds) */
+#define MQTT_SOCKET_TIMEOUT_S   2
+
+/** @brief Longest wait for the broker's TCP handshake (seconds) */
+#define MQTT_CONNECT_TIMEOUT_S  2
+
+// ============================================================================
+// LOCAL HTTP/JSON + WEBSOCKET API
+// ============================================================================
+
+/** @brief TCP port of the local API (HTTP and WebSocket on /ws) */
+#define LOCAL_API_PORT            80
+
+/** @brief Simultaneous WebSocket stream clients */
+#define LOCAL_API_WS_CLIENTS      2
+
+/** @brief Largest accepted request head (request line + headers), bytes */
+#define LOCAL_API_REQ_MAX         768
+
+/** @brief Time a client has to send its request head (milliseconds) */
+#define LOCAL_API_REQ_TIMEOUT_MS  2000
+
+/** @brief Socket write chunk for streamed responses (bytes, on the stack) */
+#define LOCAL_API_TX_CHUNK        256
+
+/** @brief Largest WebSocket message sent (full status or delta), bytes */
+#define LOCAL_API_WS_FRAME_MAX    320
+
+/** @brief Longest API token (characters); set from the terminal with 'api token' */
+#define LOCAL_API_TOKEN_MAX       48
+
+/** @brief Largest request body (a whole exported table for POST /api/table), bytes */
+#define LOCAL_API_BODY_MAX        SCHED_SUMMARY_MAX_LEN
+
+// ============================================================================
+// STATUS SINKS (fan-out of status deltas, see StatusSink.h)
+// ============================================================================
+
+/** @brief Minimum time between two WebSocket stream deltas (milliseconds) */
+#define STREAM_SINK_MIN_INTERVAL_MS   250
+
+/** @brief Minimum time between two serial status log lines (milliseconds) */
+#define LOG_SINK_MIN_INTERVAL_MS      5000
+
+/** @brief A deliver() taking longer than this marks the sink as slow (milliseconds) */
+#define STATUS_SINK_SLOW_MS           50
+
+/** @brief A slow sink is held back for this many times its last delivery time */
+#define STATUS_SINK_HOLD_FACTOR       4
+
+/** @brief Longest hold of a slow sink (milliseconds) */
+#define STATUS_SINK_HOLD_MAX_MS       5000
+
+/** @brief Time one push may spend in sinks; later sinks wait for the next pass (milliseconds) */
+#define STATUS_SINK_PASS_BUDGET_MS    100
+
+/** @brief Maximum number of registered sinks */
+#define STATUS_SINKS_MAX              6
+
+// ============================================================================
+// LAN STATUS BEACON (UDP, see UdpStatus.h and MnvFrame.h)
+// ============================================================================
+
+/** @brief UDP port the status frames are sent to */
+#define UDP_STATUS_PORT               47800
+
+/** @brief Multicast group (e.g. "239.255.77.78"); empty sends to the subnet broadcast address */
+static const char* UDP_STATUS_GROUP = "";
+
+/** @brief Heartbeat frame interval when nothing changes (milliseconds) */
+#define UDP_STATUS_HEARTBEAT_MS       10000UL
+
 // ============================================================================
 // BLYNK VIRTUAL PIN ASSIGNMENTS
 // ============================================================================
@@ -61,13 +152,51 @@ static const char* WIFI_PASS = "YourNetworkPassword";
 #define VPIN_SCHED_GLOBAL_ENABLE   V10  ///< Global scheduler enable/disable switch
 #define VPIN_SCHED_INDEX           V11  ///< Scheduler entry index selector
 #define VPIN_SCHED_ACTIVE          V12  ///< Current entry active checkbox
-#define VPIN_SCHED_DAY             V13  ///< Day of week selector (1-7)
+#define VPIN_SCHED_DAY             V13  ///< Day mask selector (bit 0 = Monday ... bit 6 = Sunday, 1-127)
 #define VPIN_SCHED_HOUR            V14  ///< Hour selector (0-23)
 #define VPIN_SCHED_MINUTE          V15  ///< Minute selector (0-59)
 #define VPIN_SCHED_POWER           V16  ///< Target power level (1-5)
+#define VPIN_SCHED_ACTION          V21  ///< Entry action (0 = start, 1 = power, 2 = off)
+#define VPIN_SCHED_CRON            V22  ///< Cron rule text input ("<idx> <min> <hour> <dom> <mon> <dow> <action> [power]")
 #define VPIN_SCHED_APPLY           V17  ///< Apply button for scheduler changes
 #define VPIN_SCHED_REFRESH         V19  ///< Refresh scheduler display
 #define VPIN_SCHED_SUMMARY         V18  ///< Scheduler summary text display
+#define VPIN_SCHED_TABLE           V23  ///< Whole schedule as import records (text in/out, see Scheduler::exportTable())
+
+/**
+ * @brief Virtual pins V0..N-1 covered by the BlynkWrapper shadow cache
+ *
+ * A write or property identical to the last one sent on the pin is dropped.
+ * Writes to higher pins are always sent.
+ */
+#define BLYNK_SHADOW_PINS          32
+
+/** @brief Widget properties remembered per pin by the shadow cache */
+#define BLYNK_SHADOW_PROPS_PER_PIN 2
+
+/** @brief Pin updates held by one publish batch before it is flushed early */
+#define BLYNK_BATCH_MAX_ITEMS      24
+
+/** @brief Bytes for text values and properties held by one publish batch */
+#define BLYNK_BATCH_TEXT_POOL      256
+
+/**
+ * @brief Changed values a batch needs before they are wrapped in a Blynk group
+ *
+ * Each value is still its own message: a group only makes the widgets update
+ * together, at the cost of a begin and an end message. Smaller batches are
+ * sent as plain writes.
+ */
+#define BLYNK_BATCH_GROUP_MIN      4
+
+/** @brief Trend samples buffered while the cloud link is down (8 bytes each) */
+#define TELEMETRY_BUFFER_RECORDS   256
+
+/** @brief Buffered samples replayed per replay step after reconnect */
+#define TELEMETRY_REPLAY_BATCH     4
+
+/** @brief Time between replay steps after reconnect (milliseconds) */
+#define TELEMETRY_REPLAY_INTERVAL_MS 250
 
 // ============================================================================
 // HARDWARE UART CONFIGURATION
@@ -88,6 +217,9 @@ static const char* WIFI_PASS = "YourNetworkPassword";
 /** @brief Serial configuration: 8 data bits, no parity, 2 stop bits */
 #define STOVE_SERIAL_CONFIG  SERIAL_8N2
 
+/** @brief Console RX buffer (bytes): a pasted 'sched export' arrives between two terminal polls */
+#define TERMINAL_RX_BUFFER   1024
+
 // ============================================================================
 // MICRONOVA PROTOCOL - MEMORY ACCESS OFFSETS
 // ============================================================================
@@ -239,6 +371,23 @@ static const char* WIFI_PASS = "YourNetworkPassword";
 /** @brief Timeout for power adjustment completion (milliseconds) */
 #define POWER_ADJUST_TIMEOUT_MS 8000
 
+/** @brief Spacing of the key presses of one adjustment (milliseconds) */
+#define POWER_KEY_INTERVAL_MS   600
+
+/**
+ * @brief Key presses further apart than this start over with a wake press
+ *
+ * The first press of a sequence only brings up the power menu; later presses
+ * inside this window each move one level (milliseconds).
+ */
+#define POWER_KEY_WAKE_MS       2000
+
+/** @brief Wait after the last press before reading the power back (milliseconds) */
+#define POWER_SETTLE_MS         4000
+
+/** @brief Granularity at which a settling adjustment checks for a new target (milliseconds) */
+#define POWER_SETTLE_SLICE_MS   200
+
 // ============================================================================
 // SHUTDOWN PROCEDURE PARAMETERS
 // ============================================================================
@@ -253,8 +402,117 @@ static const char* WIFI_PASS = "YourNetworkPassword";
 // SCHEDULER CONFIGURATION
 // ============================================================================
 
-/** @brief Maximum number of schedule entries */
-#define MAX_SCHEDULE_ENTRIES 8
+/**
+ * @brief Maximum number of schedule entries
+ *
+ * Entries are packed into 4 bytes each (see ScheduleEntry), so the table
+ * costs MAX_SCHEDULE_ENTRIES * 4 bytes of RAM.
+ */
+#define MAX_SCHEDULE_ENTRIES 128
+
+/**
+ * @brief Maximum number of on/off schedule windows
+ *
+ * Windows (e.g. Mon-Fri 06:00-08:30 at power 3) are flattened into a sorted
+ * interval index of at most MAX_SCHEDULE_WINDOWS * 14 + 1 segments.
+ */
+#define MAX_SCHEDULE_WINDOWS 16
+
+/**
+ * @brief Maximum number of cron-style schedule rules
+ *
+ * Each rule is compiled once into per-field bitsets (24 bytes), so matching
+ * costs a few AND operations per rule.
+ */
+#define MAX_CRON_RULES 8
+
+/** @brief Longest time the scheduler task sleeps between evaluations (milliseconds) */
+#define SCHED_MAX_SLEEP_MS   60000
+
+/** @brief Scheduler task poll period while the clock is not synced yet (milliseconds) */
+#define SCHED_CLOCK_POLL_MS  2000
+
+/**
+ * @brief Default late-fire grace window for new schedule entries (minutes)
+ *
+ * An occurrence missed because of a reboot or late clock sync still fires
+ * if found within this window. Rounded up to 10-minute steps, max 150.
+ */
+#define SCHED_DEFAULT_GRACE_MIN 30
+
+/**
+ * @brief Wall-clock times before this epoch are treated as "not synced yet"
+ *
+ * 2023-11-14 22:13:20 UTC. The scheduler does not evaluate until time()
+ * has passed this value.
+ */
+#define SCHED_TIME_VALID_EPOCH  1700000000L
+
+/** @brief NVS namespace holding the persisted schedule */
+#define SCHED_STORE_NAMESPACE "sched"
+
+/** @brief Maximum persisted schedule payload size (bytes) */
+#define SCHED_STORE_MAX_PAYLOAD 1024
+
+/** @brief Quiet time after the last edit before the schedule is saved (milliseconds) */
+#define SCHED_PERSIST_DEBOUNCE_MS  5000
+
+/** @brief Maximum time an edited schedule may stay unsaved (milliseconds) */
+#define SCHED_PERSIST_MAX_DELAY_MS 60000
+
+/**
+ * @brief Size of the static buffer the scheduler summary is formatted into
+ *        for the Blynk summary widget (bytes, including NUL)
+ *
+ * Longer summaries are cut and end with "...".
+ */
+#define SCHED_SUMMARY_MAX_LEN 1024
+
+/** @brief Longest dry run accepted by "sched sim" (days) */
+#define SCHED_SIM_MAX_DAYS 31
+
+/** @brief Most events listed by "sched next" */
+#define SCHED_NEXT_MAX_EVENTS 32
+
+// ============================================================================
+// THERMAL MODEL / PRE-HEAT
+// ============================================================================
+
+/** @brief Maximum number of "warm by HH:MM" pre-heat rules */
+#define MAX_PREHEAT_RULES           4
+
+/** @brief NVS namespace holding the learned thermal model */
+#define THERMAL_STORE_NAMESPACE     "thermal"
+
+/** @brief Length of one rate-estimation window (milliseconds) */
+#define THERMAL_SAMPLE_WINDOW_MS    (10UL * 60UL * 1000UL)
+
+/** @brief Minimum interval between saves of the learned model (milliseconds) */
+#define THERMAL_SAVE_INTERVAL_MS    (30UL * 60UL * 1000UL)
+
+/** @brief RLS forgetting factor (closer to 1 = longer memory) */
+#define THERMAL_RLS_LAMBDA          0.98f
+
+/** @brief Heat-up rate assumed at power 1 before anything is learned (°C/h) */
+#define THERMAL_DEFAULT_HEAT_RATE   0.8f
+
+/** @brief Extra heat-up rate assumed per power step before learning (°C/h) */
+#define THERMAL_DEFAULT_HEAT_STEP   0.4f
+
+/** @brief Ignition time assumed before anything is learned (minutes) */
+#define THERMAL_DEFAULT_IGNITION_MIN 15.0f
+
+/** @brief Rates beyond this magnitude are treated as sensor glitches (°C/h) */
+#define THERMAL_MAX_RATE            10.0f
+
+/** @brief Pre-heat starts are never planned earlier than this before the target (minutes) */
+#define PREHEAT_MAX_LEAD_MIN        240
+
+/** @brief Lead used when no temperature reading is available (minutes) */
+#define PREHEAT_FALLBACK_LEAD_MIN   60
+
+/** @brief Safety margin added to the computed latest start (minutes) */
+#define PREHEAT_MARGIN_MIN          5
 
 // ============================================================================
 // FREERTOS TASK CONFIGURATION
@@ -268,12 +526,36 @@ static const char* WIFI_PASS = "YourNetworkPassword";
 #define TASK_STACK_POLL     4096  ///< Polling task stack size
 #define TASK_STACK_SCHED    4096  ///< Scheduler task stack size
 #define TASK_STACK_CTRL     4096  ///< Controller task stack size
+#define TASK_STACK_NET      8192  ///< Network (WiFi/Blynk) task stack size
 
 // Task Priorities (higher number = higher priority)
 #define TASK_PRIO_COMM      3  ///< Communication task priority
 #define TASK_PRIO_POLL      2  ///< Polling task priority
 #define TASK_PRIO_SCHED     2  ///< Scheduler task priority
 #define TASK_PRIO_CTRL      1  ///< Controller task priority
+#define TASK_PRIO_NET       1  ///< Network task priority
+
+/** @brief Core the network task is pinned to (control tasks use core 1) */
+#define NET_TASK_CORE       0
+
+/** @brief Network task loop period (milliseconds) */
+#define NET_TASK_PERIOD_MS  10
+
+// ============================================================================
+// NETWORK LINK (WiFi + Blynk reconnect state machine)
+// ============================================================================
+
+/** @brief Time allowed for one WiFi association attempt (milliseconds) */
+#define WIFI_CONNECT_TIMEOUT_MS   20000
+
+/** @brief Longest a single Blynk connect attempt may block the network task (milliseconds) */
+#define BLYNK_CONNECT_TIMEOUT_MS  3000
+
+/** @brief First retry delay after a failed attempt (milliseconds) */
+#define NET_BACKOFF_MIN_MS        1000
+
+/** @brief Retry delay ceiling; the delay doubles per failure up to this (milliseconds) */
+#define NET_BACKOFF_MAX_MS        60000
 
 // ============================================================================
 // STATE TRANSITION TIMEOUTS
@@ -288,6 +570,12 @@ static const char* WIFI_PASS = "YourNetworkPassword";
 /** @brief Failsafe timeout for re-enabling UI after state change (milliseconds) */
 #define UI_REENABLE_FAILSAFE_MS           30000
 
+/** @brief Longest the timer input stays locked waiting for its command (milliseconds) */
+#define TIMER_LOCK_RELEASE_MS             1500UL
+
+/** @brief Longest the scheduler apply button stays locked waiting for its command (milliseconds) */
+#define SCHED_LOCK_RELEASE_MS             1000UL
+
 // ============================================================================
 // SIMULATION MODE
 // ============================================================================
@@ -0,0 +1,149 @@
+/**
+ * @file JsonWriter.h
+ * @brief Streaming, allocation-free JSON serializer over a Print
+ *
+ * Writes tokens straight into the destination (a socket buffer, a
+ * BufferPrint, Serial) as they are produced: no document tree, no String.
+ * Commas and nesting are tracked in a fixed bit stack, so the writer itself
+ * is a few bytes on the caller's stack.
+ *
+ * @code
+ * JsonWriter j(out);
+ * j.beginObject();
+ * j.key("power"); j.value(3);
+ * j.key("temp");  j.value(21.5f);
+ * j.endObject();
+ * @endcode
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+
+/**
+ * @class JsonWriter
+ * @brief Emits one JSON value (usually an object) to a Print
+ */
+class JsonWriter {
+public:
+    /** @brief Deepest nesting supported */
+    static const uint8_t MAX_DEPTH = 16;
+
+    explicit JsonWriter(Print& out) : mOut(out) {}
+
+    void beginObject() { open('{'); }
+    void endObject() { close('}'); }
+    void beginArray() { open('['); }
+    void endArray() { close(']'); }
+
+    /**
+     * @brief Write an object key; the next value() belongs to it
+     */
+    void key(const char* name) {
+        separate();
+        writeString(name);
+        mOut.write(':');
+        mAfterKey = true;
+    }
+
+    void value(const char* s) {
+        separate();
+        if (s) writeString(s);
+        else mOut.print("null");
+    }
+
+    void value(bool b) {
+        separate();
+        mOut.print(b ? "true" : "false");
+    }
+
+    void value(long v) {
+        char buf[21];
+        separate();
+        mOut.write((const uint8_t*)buf, (size_t)snprintf(buf, sizeof(buf), "%ld", v));
+    }
+
+    void value(unsigned long v) {
+        char buf[21];
+        separate();
+        mOut.write((const uint8_t*)buf, (size_t)snprintf(buf, sizeof(buf), "%lu", v));
+    }
+
+    // int32_t is int or long depending on the toolchain: cover both.
+    void value(int v) { value((long)v); }
+    void value(unsigned v) { value((unsigned long)v); }
+
+    /**
+     * @brief Write a number with a fixed number of decimals (NaN/inf as null)
+     */
+    void value(float v, uint8_t decimals = 1) {
+        separate();
+        if (isnan(v) || isinf(v)) { mOut.print("null"); return; }
+        char buf[24];
+        int n = snprintf(buf, sizeof(buf), "%.*f", (int)decimals, (double)v);
+        mOut.write((const uint8_t*)buf, n > 0 ? (size_t)n : 0);
+    }
+
+    /** @brief Write raw, already-encoded JSON as the next value */
+    void raw(const char* json) {
+        separate();
+        mOut.print(json);
+    }
+
+private:
+    void open(char c) {
+        separate();
+        mOut.write((uint8_t)c);
+        if (mDepth < MAX_DEPTH) mDepth++;
+        mHasItem &= ~(1u << mDepth);
+    }
+
+    void close(char c) {
+        if (mDepth) mDepth--;
+        mOut.write((uint8_t)c);
+        mHasItem |= (1u << mDepth);
+        mAfterKey = false;
+    }
+
+    /** @brief Emit the comma owed before the next item at this level */
+    void separate() {
+        if (mAfterKey) { mAfterKey = false; return; }
+        if (mHasItem & (1u << mDepth)) mOut.write(',');
+        mHasItem |= (1u << mDepth);
+    }
+
+    void writeString(const char* s) {
+        static const char HEX_DIGITS[] = "0123456789abcdef";
+        mOut.write('"');
+        const char* run = s;
+        for (; *s; s++) {
+            uint8_t c = (uint8_t)*s;
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            mOut.write((const uint8_t*)run, (size_t)(s - run));
+            run = s + 1;
+            char esc[6] = {'\\', 0, 0, 0, 0, 0};
+            size_t len = 2;
+            switch (c) {
+                case '"':  esc[1] = '"'; break;
+                case '\\': esc[1] = '\\'; break;
+                case '\n': esc[1] = 'n'; break;
+                case '\r': esc[1] = 'r'; break;
+                case '\t': esc[1] = 't'; break;
+                default:
+                    esc[1] = 'u'; esc[2] = '0'; esc[3] = '0';
+                    esc[4] = HEX_DIGITS[c >> 4]; esc[5] = HEX_DIGITS[c & 0xF];
+                    len = 6;
+                    break;
+            }
+            mOut.write((const uint8_t*)esc, len);
+        }
+        mOut.write((const uint8_t*)run, (size_t)(s - run));
+        mOut.write('"');
+    }
+
+    Print& mOut;             ///< Destination
+    uint32_t mHasItem = 0;   ///< Bit d set: level d already holds an item
+    uint8_t mDepth = 0;      ///< Current nesting level
+    bool mAfterKey = false;  ///< The next value follows a key (no comma)
+};
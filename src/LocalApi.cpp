@@ -0,0 +1,642 @@
+/**
+ * @file LocalApi.cpp
+ * @brief On-device HTTP/JSON API and WebSocket status stream implementation
+ */
+
+#include "LocalApi.h"
+#include "AppGlobals.h"
+#include "StatusPublisher.h"
+#include "BufferPrint.h"
+#include "Logging.h"
+#include <mbedtls/sha1.h>
+#include <mbedtls/base64.h>
+#include <Preferences.h>
+
+LocalApi gLocalApi;
+
+static const char WS_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/**
+ * @brief Print that batches writes into a stack chunk before the socket
+ *
+ * Keeps JsonWriter's many small writes from becoming many TCP segments.
+ */
+class SocketPrint : public Print {
+public:
+    explicit SocketPrint(WiFiClient& sock) : mSock(sock) {}
+    ~SocketPrint() { send(); }
+
+    size_t write(uint8_t c) override {
+        if (mLen == sizeof(mBuf)) send();
+        mBuf[mLen++] = c;
+        return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        size_t done = 0;
+        while (done < len) {
+            if (mLen == sizeof(mBuf)) send();
+            size_t n = sizeof(mBuf) - mLen;
+            if (n > len - done) n = len - done;
+            memcpy(mBuf + mLen, data + done, n);
+            mLen += n;
+            done += n;
+        }
+        return len;
+    }
+
+    /** @brief Hand the buffered bytes to the socket */
+    void send() {
+        if (mLen) mSock.write(mBuf, mLen);
+        mLen = 0;
+    }
+
+private:
+    WiFiClient& mSock;
+    uint8_t mBuf[LOCAL_API_TX_CHUNK];
+    size_t mLen = 0;
+};
+
+// ============================================================================
+// TOKEN
+// ============================================================================
+
+void LocalApi::begin() {
+    loadToken();
+}
+
+void LocalApi::loadToken() {
+    Preferences prefs;
+    mToken[0] = '\0';
+    if (prefs.begin("api", true)) {
+        String token = prefs.getString("token", "");
+        prefs.end();
+        strlcpy(mToken, token.c_str(), sizeof(mToken));
+    }
+}
+
+void LocalApi::saveToken(const char* token) {
+    Preferences prefs;
+    if (!prefs.begin("api", false)) {
+        logInfo("[API] NVS no disponible.");
+        return;
+    }
+    prefs.putString("token", token ? token : "");
+    prefs.end();
+    mReloadRequested = true;
+    logInfo("[API] Token guardado en NVS.");
+}
+
+void LocalApi::printStatus(Print& out) {
+    char line[96];
+    snprintf(line, sizeof(line), "\r\n[API] Puerto %u  token: %s  clientes WebSocket: %u",
+             (unsigned)LOCAL_API_PORT, mToken[0] ? "configurado" : "(sin token, comandos rechazados)",
+             (unsigned)mStreamClients);
+    out.print(line);
+}
+
+bool LocalApi::tokenMatches(const char* presented) const {
+    const size_t len = strlen(mToken);
+    if (!len || strlen(presented) != len) return false;
+    // Same time whatever the first mismatching byte is.
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) diff |= (uint8_t)(mToken[i] ^ presented[i]);
+    return diff == 0;
+}
+
+bool LocalApi::originAllowed() const {
+    char origin[96], host[64];
+    if (!header("Origin", origin, sizeof(origin))) return true;  // not a browser cross-site request
+    if (!header("Host", host, sizeof(host))) return false;
+    return !strncmp(origin, "http://", 7) && !strcmp(origin + 7, host);
+}
+
+// ============================================================================
+// JSON
+// ============================================================================
+
+void LocalApi::writeStatus(JsonWriter& j, const StoveStatus& s, uint32_t nowMs) {
+    uint32_t age = nowMs - s.takenMs;
+    uint32_t remainMs = s.autoShutdownRemainingMs > age ? s.autoShutdownRemainingMs - age : 0;
+    uint32_t safeOffMs = s.msRemainingToAllowShutdown > age ? s.msRemainingToAllowShutdown - age : 0;
+    j.beginObject();
+    j.key("state"); j.value((int)s.state);
+    j.key("stateName"); j.value(StatusPublisher::stateName(s.state));
+    j.key("on"); j.value(s.isOn);
+    j.key("power"); j.value((unsigned)s.powerLevel);
+    j.key("temp"); j.value(s.ambientTemp);
+    j.key("timerMin"); j.value((unsigned)(remainMs ? (remainMs + 59999UL) / 60000UL : 0));
+    j.key("canShutdown"); j.value(s.canShutdown || (s.isOn && !safeOffMs));
+    j.key("safeOffInMs"); j.value((unsigned long)safeOffMs);
+    j.key("msSinceOn"); j.value((unsigned long)(s.isOn ? s.msSinceOn + age : 0));
+    j.key("powerAdjusting"); j.value(s.powerAdjustInProgress);
+    j.key("shutdownRefusals"); j.value((unsigned long)s.shutdownRefusals);
+    j.endObject();
+}
+
+static void writeClock(JsonWriter& j, const char* name, uint16_t minuteOfDay) {
+    char hhmm[6];
+    snprintf(hhmm, sizeof(hhmm), "%02u:%02u", (unsigned)(minuteOfDay / 60), (unsigned)(minuteOfDay % 60));
+    j.key(name); j.value(hhmm);
+}
+
+static void writeSchedule(JsonWriter& j) {
+    // One copy of the tables so the JSON never mixes two versions of the schedule
+    ScheduleRules rules;
+    gScheduler.copyRules(rules);
+    char text[SCHED_CRON_TEXT_MAX];
+    j.beginObject();
+    j.key("enabled"); j.value(rules.enabled);
+
+    j.key("entries"); j.beginArray();
+    for (size_t i = 0; i < MAX_SCHEDULE_ENTRIES; i++) {
+        const ScheduleEntry& e = rules.entries[i];
+        if (e.isEmpty()) continue;
+        j.beginObject();
+        j.key("i"); j.value((unsigned)i);
+        j.key("active"); j.value(e.active());
+        j.key("days"); j.value((unsigned)e.dayMask());
+        writeClock(j, "time", e.minuteOfDay());
+        j.key("action"); j.value(Scheduler::actionName(e.action()));
+        j.key("power"); j.value((unsigned)e.targetPower());
+        j.key("grace"); j.value((unsigned)e.graceMinutes());
+        j.endObject();
+    }
+    j.endArray();
+
+    j.key("windows"); j.beginArray();
+    for (size_t i = 0; i < MAX_SCHEDULE_WINDOWS; i++) {
+        const ScheduleWindow& w = rules.windows[i];
+        if (w.isEmpty()) continue;
+        j.beginObject();
+        j.key("i"); j.value((unsigned)i);
+        j.key("days"); j.value((unsigned)w.dayMask());
+        writeClock(j, "start", w.startMinute());
+        writeClock(j, "end", w.endMinute());
+        j.key("power"); j.value((unsigned)w.power());
+        j.endObject();
+    }
+    j.endArray();
+
+    j.key("cron"); j.beginArray();
+    for (size_t i = 0; i < MAX_CRON_RULES; i++) {
+        const CronRule& r = rules.cron[i];
+        if (r.isEmpty()) continue;
+        Scheduler::formatCron(r, text, sizeof(text));
+        j.beginObject();
+        j.key("i"); j.value((unsigned)i);
+        j.key("rule"); j.value(text);
+        j.endObject();
+    }
+    j.endArray();
+
+    j.key("preheat"); j.beginArray();
+    for (size_t i = 0; i < MAX_PREHEAT_RULES; i++) {
+        const PreheatRule& p = rules.preheat[i];
+        if (p.isEmpty()) continue;
+        j.beginObject();
+        j.key("i"); j.value((unsigned)i);
+        j.key("days"); j.value((unsigned)p.dayMask());
+        writeClock(j, "time", p.minuteOfDay());
+        j.key("temp"); j.value(p.targetTemp());
+        j.key("power"); j.value((unsigned)p.power());
+        j.endObject();
+    }
+    j.endArray();
+    j.endObject();
+}
+
+// ============================================================================
+// HTTP
+// ============================================================================
+
+void LocalApi::loop(uint32_t nowMs) {
+    if (WiFi.status() != WL_CONNECTED) return;
+    if (!mListening) {
+        mServer.begin();
+        mServer.setNoDelay(true);
+        mListening = true;
+        logf("[API] Escuchando en el puerto %u.", (unsigned)LOCAL_API_PORT);
+    }
+
+    if (mReloadRequested) {
+        mReloadRequested = false;
+        loadToken();
+    }
+
+    if (!mHttp) {
+        mHttp = mServer.available();
+        if (mHttp) {
+            mReqLen = 0;
+            mHeadDone = false;
+            mBodyLen = 0;
+            mBodyWant = 0;
+            mReqStartMs = nowMs;
+        }
+    }
+    if (mHttp) serviceHttp(nowMs);
+
+    for (size_t i = 0; i < LOCAL_API_WS_CLIENTS; i++) {
+        if (mWs[i].open) serviceWs(mWs[i]);
+    }
+}
+
+void LocalApi::serviceHttp(uint32_t nowMs) {
+    int avail = mHttp.available();
+    if (avail > 0 && mHeadDone) {
+        size_t room = mBodyWant - mBodyLen;
+        if ((size_t)avail > room) avail = (int)room;
+        int n = mHttp.read((uint8_t*)mBody + mBodyLen, (size_t)avail);
+        if (n > 0) mBodyLen += (size_t)n;
+        if (mBodyLen == mBodyWant) {
+            mBody[mBodyLen] = '\0';
+            handleRequest();
+            return;
+        }
+    } else if (avail > 0) {
+        size_t room = sizeof(mReq) - 1 - mReqLen;
+        if (room == 0) {
+            sendResult(431, "Request Header Fields Too Large", false, "request too large");
+            return;
+        }
+        if ((size_t)avail > room) avail = (int)room;
+        int n = mHttp.read((uint8_t*)mReq + mReqLen, (size_t)avail);
+        if (n > 0) mReqLen += (size_t)n;
+        mReq[mReqLen] = '\0';
+        const char* end = strstr(mReq, "\r\n\r\n");
+        if (end) {
+            if (!startBody((size_t)(end + 4 - mReq))) return;
+            if (mBodyLen == mBodyWant) {
+                mBody[mBodyLen] = '\0';
+                handleRequest();
+                return;
+            }
+        }
+    }
+    if (!mHttp.connected() || nowMs - mReqStartMs > LOCAL_API_REQ_TIMEOUT_MS) {
+        mHttp.stop();
+    }
+}
+
+bool LocalApi::startBody(size_t headLen) {
+    mHeadDone = true;
+    mBodyLen = 0;
+    mBodyWant = 0;
+    char length[12];
+    if (header("Content-Length", length, sizeof(length))) {
+        char* endp = nullptr;
+        unsigned long want = strtoul(length, &endp, 10);
+        if (endp == length || *endp) {
+            sendResult(400, "Bad Request", false, "bad content-length");
+            return false;
+        }
+        if (want >= sizeof(mBody)) {
+            sendResult(413, "Payload Too Large", false, "body too large");
+            return false;
+        }
+        mBodyWant = (size_t)want;
+    }
+    // Body bytes that arrived with the head move to mBody.
+    size_t extra = mReqLen - headLen;
+    if (extra > mBodyWant) extra = mBodyWant;
+    memcpy(mBody, mReq + headLen, extra);
+    mBodyLen = extra;
+    mReq[headLen] = '\0';
+    mReqLen = headLen;
+    return true;
+}
+
+bool LocalApi::header(const char* name, char* out, size_t cap) const {
+    const size_t nameLen = strlen(name);
+    const char* line = strstr(mReq, "\r\n");
+    while (line) {
+        line += 2;
+        if (line[0] == '\r') break;  // blank line: end of head
+        const char* next = strstr(line, "\r\n");
+        if (!next) break;
+        if (!strncasecmp(line, name, nameLen) && line[nameLen] == ':') {
+            const char* v = line + nameLen + 1;
+            while (*v == ' ' || *v == '\t') v++;
+            size_t len = (size_t)(next - v);
+            if (len >= cap) return false;
+            memcpy(out, v, len);
+            out[len] = '\0';
+            return true;
+        }
+        line = next;
+    }
+    return false;
+}
+
+void LocalApi::sendHead(int code, const char* reason, const char* type) {
+    char head[192];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nCache-Control: no-store\r\n"
+                     "Connection: close\r\n\r\n",
+                     code, reason, type);
+    if (n > 0) mHttp.write((const uint8_t*)head, (size_t)n);
+}
+
+void LocalApi::sendResult(int code, const char* reason, bool ok, const char* error) {
+    sendHead(code, reason, "application/json");
+    {
+        SocketPrint out(mHttp);
+        JsonWriter j(out);
+        j.beginObject();
+        j.key("ok"); j.value(ok);
+        if (error) { j.key("error"); j.value(error); }
+        j.endObject();
+    }
+    mHttp.stop();
+}
+
+void LocalApi::sendStatus() {
+    StoveStatus s;
+    if (!latestStatus(s)) {
+        sendResult(503, "Service Unavailable", false, "no status yet");
+        return;
+    }
+    sendHead(200, "OK", "application/json");
+    {
+        SocketPrint out(mHttp);
+        JsonWriter j(out);
+        writeStatus(j, s, millis());
+    }
+    mHttp.stop();
+}
+
+void LocalApi::sendSchedule() {
+    sendHead(200, "OK", "application/json");
+    {
+        SocketPrint out(mHttp);
+        JsonWriter j(out);
+        writeSchedule(j);
+    }
+    mHttp.stop();
+}
+
+/** @brief Decode %XX and '+' in place */
+static void urlDecode(char* s) {
+    char* w = s;
+    for (; *s; s++) {
+        if (*s == '+') { *w++ = ' '; continue; }
+        if (*s == '%' && isxdigit((unsigned char)s[1]) && isxdigit((unsigned char)s[2])) {
+            char hex[3] = {s[1], s[2], 0};
+            *w++ = (char)strtol(hex, nullptr, 16);
+            s += 2;
+            continue;
+        }
+        *w++ = *s;
+    }
+    *w = '\0';
+}
+
+/** @brief Find "name=" in a query string and copy its decoded value */
+static bool queryParam(const char* query, const char* name, char* out, size_t cap) {
+    const size_t nameLen = strlen(name);
+    for (const char* p = query; p && *p; ) {
+        const char* amp = strchr(p, '&');
+        size_t len = amp ? (size_t)(amp - p) : strlen(p);
+        if (len > nameLen && !strncmp(p, name, nameLen) && p[nameLen] == '=') {
+            size_t vlen = len - nameLen - 1;
+            if (vlen >= cap) return false;
+            memcpy(out, p + nameLen + 1, vlen);
+            out[vlen] = '\0';
+            urlDecode(out);
+            return true;
+        }
+        p = amp ? amp + 1 : nullptr;
+    }
+    return false;
+}
+
+void LocalApi::handleRequest() {
+    char method[8], target[200];
+    if (sscanf(mReq, "%7s %199s", method, target) != 2) {
+        sendResult(400, "Bad Request", false, "bad request line");
+        return;
+    }
+    char* query = strchr(target, '?');
+    if (query) *query++ = '\0';
+    const char* path = target;
+
+    if (!strcmp(method, "GET")) {
+        if (!strcmp(path, "/api/status")) { sendStatus(); return; }
+        if (!strcmp(path, "/api/schedule")) { sendSchedule(); return; }
+        if (!strcmp(path, "/ws")) {
+            char token[LOCAL_API_TOKEN_MAX + 1];
+            if (!originAllowed()) {
+                sendResult(403, "Forbidden", false, "cross-origin request refused");
+            } else if (!mToken[0]) {
+                sendResult(403, "Forbidden", false, "api token not set");
+            } else if (!queryParam(query, "token", token, sizeof(token)) || !tokenMatches(token)) {
+                sendResult(401, "Unauthorized", false, "bad or missing token");
+            } else {
+                upgrade();
+            }
+            return;
+        }
+        if (!strcmp(path, "/")) {
+            sendHead(200, "OK", "text/plain");
+            mHttp.print("GET /api/status\nGET /api/schedule\n"
+                        "POST /api/{onoff,power,timer,sched,cron,table}?value=... (or value as body)\n"
+                        "  Authorization: Bearer <token>\n"
+                        "GET /ws?token=<token> (WebSocket)\n");
+            mHttp.stop();
+            return;
+        }
+        sendResult(404, "Not Found", false, "no such resource");
+        return;
+    }
+    if (!strcmp(method, "POST") && !strncmp(path, "/api/", 5)) {
+        char auth[16 + LOCAL_API_TOKEN_MAX];
+        if (!originAllowed()) {
+            sendResult(403, "Forbidden", false, "cross-origin request refused");
+            return;
+        }
+        if (!mToken[0]) {
+            sendResult(403, "Forbidden", false, "api token not set");
+            return;
+        }
+        if (!header("Authorization", auth, sizeof(auth)) || strncmp(auth, "Bearer ", 7) ||
+            !tokenMatches(auth + 7)) {
+            sendResult(401, "Unauthorized", false, "bad or missing token");
+            return;
+        }
+        // A body (a whole table does not fit a URL) takes precedence over ?value=.
+        char queryValue[96];
+        const char* value = mBody;
+        if (mBodyLen) {
+            while (mBodyLen && (mBody[mBodyLen - 1] == '\n' || mBody[mBodyLen - 1] == '\r')) {
+                mBody[--mBodyLen] = '\0';
+            }
+        } else if (queryParam(query, "value", queryValue, sizeof(queryValue))) {
+            value = queryValue;
+        } else {
+            sendResult(400, "Bad Request", false, "missing value");
+            return;
+        }
+        const char* error = nullptr;
+        switch (gBlynk.handleCommand(path + 5, value, &error)) {
+            case BlynkInterface::CMD_OK:
+                break;
+            case BlynkInterface::CMD_QUEUE_FULL:
+                sendResult(503, "Service Unavailable", false, "queue full");
+                return;
+            case BlynkInterface::CMD_INVALID:
+                sendResult(400, "Bad Request", false, error ? error : "unknown command or bad value");
+                return;
+        }
+        // Queued for the control tasks; the outcome shows up in the status.
+        sendResult(202, "Accepted", true, nullptr);
+        return;
+    }
+    sendResult(405, "Method Not Allowed", false, "method not allowed");
+}
+
+// ============================================================================
+// WEBSOCKET
+// ============================================================================
+
+void LocalApi::upgrade() {
+    char key[64], upgradeHdr[16];
+    if (!header("Upgrade", upgradeHdr, sizeof(upgradeHdr)) || strcasecmp(upgradeHdr, "websocket") ||
+        !header("Sec-WebSocket-Key", key, sizeof(key))) {
+        sendResult(400, "Bad Request", false, "websocket upgrade expected");
+        return;
+    }
+    WsClient* slot = nullptr;
+    for (size_t i = 0; i < LOCAL_API_WS_CLIENTS && !slot; i++) {
+        if (!mWs[i].open) slot = &mWs[i];
+    }
+    if (!slot) {
+        sendResult(503, "Service Unavailable", false, "too many stream clients");
+        return;
+    }
+
+    // Sec-WebSocket-Accept = base64(sha1(key + GUID))
+    char joined[64 + sizeof(WS_GUID)];
+    int joinedLen = snprintf(joined, sizeof(joined), "%s%s", key, WS_GUID);
+    unsigned char digest[20];
+    mbedtls_sha1((const unsigned char*)joined, (size_t)joinedLen, digest);
+    unsigned char accept[32];
+    size_t acceptLen = 0;
+    mbedtls_base64_encode(accept, sizeof(accept), &acceptLen, digest, sizeof(digest));
+    accept[acceptLen] = '\0';
+
+    char head[160];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                     "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", (const char*)accept);
+    mHttp.write((const uint8_t*)head, (size_t)n);
+
+    slot->sock = mHttp;
+    slot->rxLen = 0;
+    slot->open = true;
+    mStreamClients++;
+    mHttp = WiFiClient();
+    logInfo("[API] Cliente WebSocket conectado.");
+
+    // Full status first; deltas follow as StatusPublisher publishes them.
+    StoveStatus s;
+    if (latestStatus(s)) {
+        char msg[LOCAL_API_WS_FRAME_MAX];
+        BufferPrint out(msg, sizeof(msg));
+        JsonWriter j(out);
+        writeStatus(j, s, millis());
+        sendFrame(slot->sock, 0x1, (const uint8_t*)out.c_str(), out.length());
+    }
+}
+
+bool LocalApi::sendFrame(WiFiClient& sock, uint8_t opcode, const uint8_t* data, size_t len) {
+    uint8_t hdr[4];
+    size_t hlen = 2;
+    hdr[0] = 0x80 | opcode;  // FIN + opcode
+    if (len < 126) {
+        hdr[1] = (uint8_t)len;
+    } else {
+        hdr[1] = 126;
+        hdr[2] = (uint8_t)(len >> 8);
+        hdr[3] = (uint8_t)len;
+        hlen = 4;
+    }
+    if (sock.write(hdr, hlen) != hlen) return false;
+    return !len || sock.write(data, len) == len;
+}
+
+void LocalApi::closeWs(WsClient& c) {
+    c.sock.stop();
+    c.sock = WiFiClient();
+    c.open = false;
+    c.rxLen = 0;
+    if (mStreamClients) mStreamClients--;
+    logInfo("[API] Cliente WebSocket desconectado.");
+}
+
+void LocalApi::broadcast(const char* json, size_t len) {
+    for (size_t i = 0; i < LOCAL_API_WS_CLIENTS; i++) {
+        WsClient& c = mWs[i];
+        if (!c.open) continue;
+        if (!sendFrame(c.sock, 0x1, (const uint8_t*)json, len)) closeWs(c);
+    }
+}
+
+void LocalApi::serviceWs(WsClient& c) {
+    if (!c.sock.connected()) { closeWs(c); return; }
+    int avail = c.sock.available();
+    if (avail > 0) {
+        size_t room = sizeof(c.rx) - c.rxLen;
+        if ((size_t)avail > room) avail = (int)room;
+        int n = c.sock.read(c.rx + c.rxLen, (size_t)avail);
+        if (n > 0) c.rxLen += (uint8_t)n;
+    }
+
+    while (c.rxLen >= 2) {
+        const uint8_t opcode = c.rx[0] & 0x0F;
+        const bool masked = (c.rx[1] & 0x80) != 0;
+        const size_t len = c.rx[1] & 0x7F;
+        if (len > 125 || !masked) {
+            // Clients must mask; nothing we accept needs an extended length.
+            closeWs(c);
+            return;
+        }
+        const size_t total = 2 + 4 + len;
+        if (c.rxLen < total) return;
+
+        uint8_t* payload = c.rx + 6;
+        for (size_t i = 0; i < len; i++) payload[i] ^= c.rx[2 + (i & 3)];
+
+        switch (opcode) {
+            case 0x8:  // close
+                sendFrame(c.sock, 0x8, payload, len < 2 ? len : 2);
+                closeWs(c);
+                return;
+            case 0x9:  // ping
+                sendFrame(c.sock, 0xA, payload, len);
+                break;
+            case 0x1: {  // text: "<command> <value>"
+                char cmd[126];
+                memcpy(cmd, payload, len);
+                cmd[len] = '\0';
+                char* value = strchr(cmd, ' ');
+                if (value) *value++ = '\0';
+                const char* error = "expected \"<command> <value>\"";
+                if (!value || gBlynk.handleCommand(cmd, value, &error) != BlynkInterface::CMD_OK) {
+                    char msg[96];
+                    BufferPrint out(msg, sizeof(msg));
+                    JsonWriter j(out);
+                    j.beginObject();
+                    j.key("ok"); j.value(false);
+                    j.key("error"); j.value(error ? error : "unknown command or bad value");
+                    j.endObject();
+                    sendFrame(c.sock, 0x1, (const uint8_t*)out.c_str(), out.length());
+                }
+                break;
+            }
+            default:  // pong, binary, continuation: ignored
+                break;
+        }
+        memmove(c.rx, c.rx + total, c.rxLen - total);
+        c.rxLen -= (uint8_t)total;
+    }
+}
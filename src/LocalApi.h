@@ -0,0 +1,165 @@
+/**
+ * @file LocalApi.h
+ * @brief On-device HTTP/JSON API and WebSocket status stream
+ *
+ * A small HTTP/1.1 server on LOCAL_API_PORT for dashboards on the LAN:
+ * - GET  /api/status      latest StoveStatus as JSON
+ * - GET  /api/schedule    scheduler entries, windows, cron and pre-heat rules
+ * - POST /api/<command>?value=<v>   onoff, power, timer, sched, cron, table
+ *   (same names and values as the MQTT set/ topics); the value may instead
+ *   be sent as a text/plain body, which is how a whole table is posted
+ * - GET  /ws?token=<t>    WebSocket: one full status message on connect,
+ *   then a JSON object with just the changed fields for every status delta
+ *   StatusPublisher publishes. Text frames "<command> <value>" are accepted
+ *   as commands.
+ *
+ * Anything that can act on the stove needs the API token (kept in NVS, set
+ * with the terminal's 'api token'; until then commands are refused): POSTs
+ * carry it as "Authorization: Bearer <t>", the WebSocket upgrade as the
+ * token query parameter, since browsers cannot add headers there. No CORS
+ * headers are sent, and a request carrying an Origin other than this
+ * device's own is refused, so web pages on other sites cannot drive the
+ * stove through the user's browser.
+ *
+ * Runs in the network task and never allocates per request: the request
+ * head and body go into fixed buffers, responses are serialized by JsonWriter
+ * straight into a LOCAL_API_TX_CHUNK stack buffer that is flushed to the
+ * socket, and WebSocket messages are built in a LOCAL_API_WS_FRAME_MAX
+ * buffer. One HTTP request is served at a time (Connection: close).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "StoveController.h"
+#include "JsonWriter.h"
+#include "Config.h"
+
+/**
+ * @class LocalApi
+ * @brief Minimal HTTP + WebSocket server over WiFiServer
+ */
+class LocalApi {
+public:
+    /** @brief Load the API token from NVS */
+    void begin();
+
+    /**
+     * @brief Store the API token in NVS and make the network task reload it
+     * @param token New token ("" refuses every command)
+     *
+     * Safe to call from any task.
+     */
+    void saveToken(const char* token);
+
+    /**
+     * @brief Print whether a token is set and the stream client count
+     * @param out Destination
+     */
+    void printStatus(Print& out);
+
+    /**
+     * @brief Accept and serve connections (network task)
+     * @param nowMs Current millis()
+     *
+     * Starts listening the first time WiFi is up.
+     */
+    void loop(uint32_t nowMs);
+
+    /** @brief Whether any WebSocket client is subscribed to the stream */
+    bool hasStreamClients() const { return mStreamClients > 0; }
+
+    /**
+     * @brief Send one text message to every WebSocket client
+     * @param json Message (a JSON object)
+     * @param len Length of json in bytes
+     */
+    void broadcast(const char* json, size_t len);
+
+    /**
+     * @brief Serialize a status snapshot (field names match the stream deltas)
+     * @param j Destination writer
+     * @param s Snapshot
+     * @param nowMs Current millis(), used to age the snapshot's countdowns
+     */
+    static void writeStatus(JsonWriter& j, const StoveStatus& s, uint32_t nowMs);
+
+private:
+    /** @brief WebSocket receive buffer: header (2+4) + largest control/command frame (125) */
+    static const size_t WS_RX_MAX = 2 + 4 + 125;
+
+    /** @brief One WebSocket connection */
+    struct WsClient {
+        WiFiClient sock;          ///< Upgraded socket
+        uint8_t rx[WS_RX_MAX];    ///< Partial incoming frame
+        uint8_t rxLen = 0;        ///< Bytes in rx
+        bool open = false;        ///< Slot in use
+    };
+
+    /** @brief Read the pending request head and body; dispatch them once complete */
+    void serviceHttp(uint32_t nowMs);
+
+    /**
+     * @brief Split a complete head from the body bytes read with it
+     * @param headLen Bytes of mReq up to and including the blank line
+     * @return false if an error response was sent
+     */
+    bool startBody(size_t headLen);
+
+    /** @brief Read the token from NVS into mToken */
+    void loadToken();
+
+    /** @brief Whether presented matches the stored token (never if none is set) */
+    bool tokenMatches(const char* presented) const;
+
+    /** @brief false if the request carries an Origin that is not this device */
+    bool originAllowed() const;
+
+    /** @brief Route a complete request head */
+    void handleRequest();
+
+    /** @brief Answer an upgrade request on /ws */
+    void upgrade();
+
+    /** @brief Read and answer frames from one WebSocket client */
+    void serviceWs(WsClient& c);
+
+    /** @brief Free a WebSocket slot */
+    void closeWs(WsClient& c);
+
+    /** @brief Write the status line and headers of a response */
+    void sendHead(int code, const char* reason, const char* type);
+
+    /** @brief Send a small JSON error/ack body and close */
+    void sendResult(int code, const char* reason, bool ok, const char* error);
+
+    void sendStatus();
+    void sendSchedule();
+
+    /** @brief Send one unfragmented server frame (unmasked) */
+    static bool sendFrame(WiFiClient& sock, uint8_t opcode, const uint8_t* data, size_t len);
+
+    /**
+     * @brief Value of a request header (case-insensitive name)
+     * @return false if absent
+     */
+    bool header(const char* name, char* out, size_t cap) const;
+
+    WiFiServer mServer{LOCAL_API_PORT};     ///< Listening socket
+    bool mListening = false;                ///< mServer.begin() done
+    WiFiClient mHttp;                       ///< Request being read/served
+    char mReq[LOCAL_API_REQ_MAX];           ///< Request head
+    size_t mReqLen = 0;                     ///< Bytes in mReq
+    bool mHeadDone = false;                 ///< mReq holds the complete head
+    char mBody[LOCAL_API_BODY_MAX];         ///< Request body (NUL-terminated once complete)
+    size_t mBodyLen = 0;                    ///< Bytes in mBody
+    size_t mBodyWant = 0;                   ///< Content-Length of the request
+    char mToken[LOCAL_API_TOKEN_MAX + 1] = "";  ///< API token ("" = commands refused)
+    volatile bool mReloadRequested = false; ///< Set by saveToken()
+    uint32_t mReqStartMs = 0;               ///< millis() the request was accepted
+    WsClient mWs[LOCAL_API_WS_CLIENTS];     ///< Stream clients
+    uint8_t mStreamClients = 0;             ///< Open slots in mWs
+};
+
+extern LocalApi gLocalApi;
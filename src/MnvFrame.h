@@ -0,0 +1,148 @@
+/**
+ * @file MnvFrame.h
+ * @brief Binary status frame broadcast on the LAN (see UdpStatus.h)
+ *
+ * Plain C, header only, so the firmware and the host listener
+ * (tools/mnv_listen.c) share one encoder/decoder. Multi-byte fields are
+ * little-endian and written byte by byte: no struct packing, no host
+ * endianness assumptions.
+ *
+ * Version 1 layout (MNV_FRAME_V1_LEN bytes):
+ * | Off | Size | Field                                             |
+ * |-----|------|---------------------------------------------------|
+ * | 0   | 2    | Magic 'M' 'N'                                     |
+ * | 2   | 1    | Version (MNV_FRAME_VERSION)                       |
+ * | 3   | 1    | Total length including CRC                        |
+ * | 4   | 4    | Sequence number (+1 per frame sent)               |
+ * | 8   | 4    | Device uptime (ms)                                |
+ * | 12  | 1    | Run state (StoveRunState)                         |
+ * | 13  | 1    | Power level read back (1-5)                       |
+ * | 14  | 2    | Ambient temperature x10 (signed)                  |
+ * | 16  | 1    | Flags (MNV_FLAG_*)                                |
+ * | 17  | 1    | Reserved (0)                                      |
+ * | 18  | 4    | Time until shutdown is allowed (ms)               |
+ * | 22  | 4    | Auto-shutdown time remaining (ms, 0 = none)       |
+ * | 26  | 2    | Shutdowns refused since boot (saturates)          |
+ * | 28  | 2    | CRC-16/CCITT-FALSE over bytes [0, length - 2)     |
+ *
+ * Compatibility: a new version only appends fields before the CRC and
+ * bumps the version. Decoders read the fields they know, use the length
+ * byte to find the CRC, and reject only frames older than they can parse.
+ */
+
+#ifndef MNV_FRAME_H
+#define MNV_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MNV_MAGIC0          'M'
+#define MNV_MAGIC1          'N'
+#define MNV_FRAME_VERSION   1
+#define MNV_FRAME_V1_LEN    30
+#define MNV_FRAME_MAX       64
+
+#define MNV_FLAG_ON             0x01  /**< Stove on (isOn) */
+#define MNV_FLAG_CAN_SHUTDOWN   0x02  /**< Minimum run time elapsed */
+#define MNV_FLAG_POWER_ADJUST   0x04  /**< Power adjustment running */
+#define MNV_FLAG_AUTO_OFF       0x08  /**< Auto-shutdown timer armed */
+#define MNV_FLAG_HEARTBEAT      0x10  /**< Sent by the heartbeat, not by a change */
+
+/** @brief Decode results */
+enum {
+    MNV_OK = 0,
+    MNV_ERR_LEN = -1,      /**< Shorter than the header or than its length byte */
+    MNV_ERR_MAGIC = -2,    /**< Not a status frame */
+    MNV_ERR_VERSION = -3,  /**< Version 0 or length too small for v1 fields */
+    MNV_ERR_CRC = -4       /**< Corrupted */
+};
+
+/** @brief Decoded frame contents */
+typedef struct {
+    uint8_t version;
+    uint32_t seq;
+    uint32_t uptimeMs;
+    uint8_t state;
+    uint8_t power;
+    int16_t tempX10;
+    uint8_t flags;
+    uint32_t shutdownInMs;
+    uint32_t autoOffMs;
+    uint16_t refusals;
+} mnv_status_t;
+
+/** @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) */
+static inline uint16_t mnv_crc16(const uint8_t* p, size_t n) {
+    uint16_t crc = 0xFFFF;
+    while (n--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static inline void mnv_put16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void mnv_put32(uint8_t* p, uint32_t v) { mnv_put16(p, (uint16_t)v); mnv_put16(p + 2, (uint16_t)(v >> 16)); }
+static inline uint16_t mnv_get16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline uint32_t mnv_get32(const uint8_t* p) { return mnv_get16(p) | ((uint32_t)mnv_get16(p + 2) << 16); }
+
+/**
+ * @brief Encode a version 1 frame
+ * @param s Fields (version is ignored)
+ * @param out Buffer of at least MNV_FRAME_V1_LEN bytes
+ * @return Bytes written
+ */
+static inline size_t mnv_frame_encode(const mnv_status_t* s, uint8_t* out) {
+    out[0] = MNV_MAGIC0;
+    out[1] = MNV_MAGIC1;
+    out[2] = MNV_FRAME_VERSION;
+    out[3] = MNV_FRAME_V1_LEN;
+    mnv_put32(out + 4, s->seq);
+    mnv_put32(out + 8, s->uptimeMs);
+    out[12] = s->state;
+    out[13] = s->power;
+    mnv_put16(out + 14, (uint16_t)s->tempX10);
+    out[16] = s->flags;
+    out[17] = 0;
+    mnv_put32(out + 18, s->shutdownInMs);
+    mnv_put32(out + 22, s->autoOffMs);
+    mnv_put16(out + 26, s->refusals);
+    mnv_put16(out + 28, mnv_crc16(out, MNV_FRAME_V1_LEN - 2));
+    return MNV_FRAME_V1_LEN;
+}
+
+/**
+ * @brief Check and decode a frame of any version >= 1
+ * @param p Datagram
+ * @param n Datagram length
+ * @param s Filled on MNV_OK
+ * @return MNV_OK or an MNV_ERR_* code
+ */
+static inline int mnv_frame_decode(const uint8_t* p, size_t n, mnv_status_t* s) {
+    if (n < 4) return MNV_ERR_LEN;
+    if (p[0] != MNV_MAGIC0 || p[1] != MNV_MAGIC1) return MNV_ERR_MAGIC;
+    if (p[2] < 1 || p[3] < MNV_FRAME_V1_LEN) return MNV_ERR_VERSION;
+    if (n < p[3]) return MNV_ERR_LEN;
+    if (mnv_crc16(p, p[3] - 2) != mnv_get16(p + p[3] - 2)) return MNV_ERR_CRC;
+    s->version = p[2];
+    s->seq = mnv_get32(p + 4);
+    s->uptimeMs = mnv_get32(p + 8);
+    s->state = p[12];
+    s->power = p[13];
+    s->tempX10 = (int16_t)mnv_get16(p + 14);
+    s->flags = p[16];
+    s->shutdownInMs = mnv_get32(p + 18);
+    s->autoOffMs = mnv_get32(p + 22);
+    s->refusals = mnv_get16(p + 26);
+    return MNV_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MNV_FRAME_H
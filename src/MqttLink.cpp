@@ -0,0 +1,180 @@
+/**
+ * @file MqttLink.cpp
+ * @brief LAN MQTT backend implementation
+ */
+
+#include "MqttLink.h"
+#include "AppGlobals.h"
+#include "StatusPublisher.h"
+#include "BackendSinks.h"
+#include "Config.h"
+#include "Logging.h"
+#include <Preferences.h>
+
+MqttLink gMqtt;
+
+static const char* const SET_PREFIX = MQTT_BASE_TOPIC "/set/";
+
+void MqttLink::begin() {
+    loadConfig();
+    mClient.setKeepAlive(MQTT_KEEPALIVE_S);
+    mClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+    // connect() runs on the network task: bound the TCP handshake so an
+    // unreachable broker does not stall Blynk and the local API.
+    mNet.setTimeout(MQTT_CONNECT_TIMEOUT_S);
+    // The library drops packets larger than its buffer (256 bytes by
+    // default): make room for a full set/table export plus topic and header.
+    mClient.setBufferSize(SCHED_SUMMARY_MAX_LEN + 128);
+    mClient.setCallback(onMessage);
+    mBackoffMs = NET_BACKOFF_MIN_MS;
+}
+
+void MqttLink::loadConfig() {
+    Preferences prefs;
+    String host = MQTT_HOST_DEFAULT;
+    String user, pass;
+    mPort = MQTT_PORT_DEFAULT;
+    if (prefs.begin("mqttcfg", true)) {
+        if (prefs.isKey("host")) host = prefs.getString("host", "");
+        mPort = (uint16_t)prefs.getUInt("port", MQTT_PORT_DEFAULT);
+        user = prefs.getString("user", "");
+        pass = prefs.getString("pass", "");
+        prefs.end();
+    }
+    strlcpy(mHost, host.c_str(), sizeof(mHost));
+    strlcpy(mUser, user.c_str(), sizeof(mUser));
+    strlcpy(mPass, pass.c_str(), sizeof(mPass));
+    mBrokerResolved = false;
+}
+
+void MqttLink::saveConfig(const char* host, uint16_t port, const char* user, const char* pass) {
+    Preferences prefs;
+    if (!prefs.begin("mqttcfg", false)) {
+        logInfo("[MQTT] NVS no disponible.");
+        return;
+    }
+    prefs.putString("host", host ? host : "");
+    prefs.putUInt("port", port);
+    prefs.putString("user", user ? user : "");
+    prefs.putString("pass", pass ? pass : "");
+    prefs.end();
+    mReloadRequested = true;
+    logInfo("[MQTT] Configuración guardada en NVS.");
+}
+
+void MqttLink::printStatus(Print& out) {
+    char line[128];
+    snprintf(line, sizeof(line), "\r\n[MQTT] Broker: %s:%u  user: %s",
+             mHost[0] ? mHost : "(off)", (unsigned)mPort, mUser[0] ? mUser : "-");
+    out.print(line);
+    snprintf(line, sizeof(line), "\r\n[MQTT] Estado: %s (state=%d, conexiones=%lu)  base: %s",
+             mClient.connected() ? "CONECTADO" : "NO CONECTADO", mClient.state(),
+             (unsigned long)mConnects, MQTT_BASE_TOPIC);
+    out.print(line);
+}
+
+bool MqttLink::resolveBroker() {
+    if (mBrokerResolved) return true;
+    // A literal address needs no lookup; a name is resolved once per
+    // configuration or lost session instead of on every retry.
+    if (!mBrokerIp.fromString(mHost) && !WiFi.hostByName(mHost, mBrokerIp)) {
+        logf("[MQTT] No se pudo resolver %s.", mHost);
+        return false;
+    }
+    mBrokerResolved = true;
+    mClient.setServer(mBrokerIp, mPort);
+    return true;
+}
+
+bool MqttLink::connectOnce() {
+    if (!resolveBroker()) return false;
+    char will[48];
+    snprintf(will, sizeof(will), "%s/status", MQTT_BASE_TOPIC);
+    logf("[MQTT] Conectando a %s:%u ...", mHost, (unsigned)mPort);
+    bool ok = mClient.connect(MQTT_CLIENT_ID,
+                              mUser[0] ? mUser : nullptr, mUser[0] ? mPass : nullptr,
+                              will, 1, true, "offline");
+    if (!ok) {
+        logf("[MQTT] Fallo (state=%d).", mClient.state());
+        return false;
+    }
+    mConnects++;
+    mClient.publish(will, "online", true);
+    char sub[48];
+    snprintf(sub, sizeof(sub), "%s/set/#", MQTT_BASE_TOPIC);
+    mClient.subscribe(sub, 1);
+    logInfo("[MQTT] Conectado.");
+    // Retained topics must reflect the current state, not the last session's.
+    gStatusPublisher.resync(gMqttSink);
+    return true;
+}
+
+void MqttLink::loop(uint32_t nowMs) {
+    if (mReloadRequested) {
+        mReloadRequested = false;
+        if (mClient.connected()) mClient.disconnect();
+        loadConfig();
+        mBackoffMs = NET_BACKOFF_MIN_MS;
+        mRetryPending = false;
+    }
+    if (!mHost[0] || WiFi.status() != WL_CONNECTED) return;
+
+    if (mClient.connected()) {
+        mClient.loop();
+        return;
+    }
+    if (mWasConnected) {
+        mWasConnected = false;
+        mBrokerResolved = false;  // the broker may come back on another address
+        logInfo("[MQTT] Conexión perdida.");
+    }
+    if (mRetryPending && (int32_t)(nowMs - mRetryAtMs) < 0) return;
+
+    if (connectOnce()) {
+        mWasConnected = true;
+        mRetryPending = false;
+        mBackoffMs = NET_BACKOFF_MIN_MS;
+    } else {
+        mRetryAtMs = millis() + mBackoffMs;
+        mRetryPending = true;
+        mBackoffMs = (mBackoffMs >= NET_BACKOFF_MAX_MS / 2) ? NET_BACKOFF_MAX_MS : mBackoffMs * 2;
+    }
+}
+
+void MqttLink::publish(const char* leaf, const char* value) {
+    if (!mClient.connected()) return;
+    char topic[48];
+    snprintf(topic, sizeof(topic), "%s/%s", MQTT_BASE_TOPIC, leaf);
+    mClient.publish(topic, value, true);
+}
+
+void MqttLink::onMessage(char* topic, uint8_t* payload, unsigned int len) {
+    const size_t prefixLen = strlen(SET_PREFIX);
+    if (strncmp(topic, SET_PREFIX, prefixLen) != 0) return;
+    // Sized for a whole "sched export" on set/table; static because only the
+    // network task runs the MQTT client.
+    static char value[SCHED_SUMMARY_MAX_LEN];
+    if (len >= sizeof(value)) {
+        // A cut schedule record could still parse, with a different meaning.
+        logf("[MQTT] Mensaje demasiado largo en %s (%u bytes), ignorado.", topic, len);
+        return;
+    }
+    memcpy(value, payload, len);
+    value[len] = '\0';
+    gMqtt.handleCommand(topic + prefixLen, value);
+}
+
+void MqttLink::handleCommand(const char* leaf, const char* value) {
+    const char* error = nullptr;
+    switch (gBlynk.handleCommand(leaf, value, &error)) {
+        case BlynkInterface::CMD_OK:
+            break;
+        case BlynkInterface::CMD_QUEUE_FULL:
+            logf("[MQTT] Cola llena: set/%s descartado.", leaf);
+            break;
+        case BlynkInterface::CMD_INVALID:
+            // Values can be a whole schedule table: log the reason, not the payload
+            logf("[MQTT] Comando rechazado: set/%s (%s)", leaf, error ? error : "?");
+            break;
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file MqttLink.h
+ * @brief LAN MQTT backend: retained state topics and command topics
+ *
+ * A second front end next to Blynk, for control from the local network
+ * (Home Assistant, Node-RED, mosquitto_pub ...) that keeps working when the
+ * cloud is down. It reuses the existing surfaces instead of adding a new
+ * control path:
+ * - commands on <base>/set/<name> are handed to gBlynk's handle*() methods,
+ *   so they go through the same callbacks, UI gating and command queue as a
+ *   Blynk widget;
+ * - state is published by StatusPublisher alongside the Blynk writes, as
+ *   retained messages on <base>/<name>, so a new subscriber gets the current
+ *   value at once.
+ *
+ * Topics (base = MQTT_BASE_TOPIC):
+ * - <base>/status        "online" / "offline" (retained, last will)
+ * - <base>/onoff         1 / 0
+ * - <base>/state         state name, <base>/state_num raw state
+ * - <base>/power         power level read back from the stove
+ * - <base>/temp          ambient temperature (°C)
+ * - <base>/timer_remain  auto-shutdown minutes left (0 = none)
+ * - <base>/set/onoff     1|0|on|off       <base>/set/power  1-5
+ * - <base>/set/timer     minutes (0 = cancel)
+ * - <base>/set/sched     1|0 (scheduler global enable)
+ * - <base>/set/cron      "<idx> <min> <hour> <dom> <mon> <dow> <action> [power]"
+ * - <base>/set/table     schedule records "<rec>;<rec>;..." (see Scheduler::exportTable())
+ *
+ * Commands are subscribed with QoS 1; state is published QoS 0 retained
+ * (PubSubClient publishes QoS 0 only). Runs in the network task; the broker
+ * is configured from the terminal and stored in NVS ("mqttcfg").
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+
+/**
+ * @class MqttLink
+ * @brief Broker connection, reconnect backoff and topic mapping
+ */
+class MqttLink {
+public:
+    /**
+     * @brief Load the broker settings and set up the client (no connect)
+     */
+    void begin();
+
+    /**
+     * @brief Connect/reconnect with backoff and process incoming messages
+     * @param nowMs Current millis()
+     */
+    void loop(uint32_t nowMs);
+
+    /** @brief Whether the broker session is up */
+    bool connected() { return mClient.connected(); }
+
+    /**
+     * @brief Publish a retained state value on <base>/<leaf>
+     *
+     * Dropped while disconnected: the resync on reconnect republishes
+     * every topic.
+     */
+    void publish(const char* leaf, const char* value);
+
+    /**
+     * @brief Store broker settings in NVS and make the network task reload them
+     * @param host Broker host name or IP ("" disables MQTT)
+     * @param port Broker TCP port
+     * @param user User name ("" = anonymous)
+     * @param pass Password
+     *
+     * Safe to call from any task.
+     */
+    void saveConfig(const char* host, uint16_t port, const char* user, const char* pass);
+
+    /**
+     * @brief Print settings and connection state
+     * @param out Destination
+     */
+    void printStatus(Print& out);
+
+private:
+    /** @brief Read the settings from NVS (defaults from Config.h) */
+    void loadConfig();
+
+    /** @brief Resolve mHost once into mBrokerIp; later logins skip DNS */
+    bool resolveBroker();
+
+    /** @brief Try one broker login; on success announce, subscribe and resync */
+    bool connectOnce();
+
+    /** @brief PubSubClient message callback */
+    static void onMessage(char* topic, uint8_t* payload, unsigned int len);
+
+    /** @brief Route one command payload by its topic leaf */
+    void handleCommand(const char* leaf, const char* value);
+
+    WiFiClient mNet;                        ///< TCP transport
+    PubSubClient mClient{mNet};             ///< MQTT session
+    char mHost[64] = "";                    ///< Broker host ("" = disabled)
+    uint16_t mPort = 0;                     ///< Broker port
+    IPAddress mBrokerIp;                    ///< mHost resolved by resolveBroker()
+    bool mBrokerResolved = false;           ///< mBrokerIp is current
+    char mUser[32] = "";                    ///< User name
+    char mPass[64] = "";                    ///< Password
+    bool mWasConnected = false;             ///< Session was up on the last loop()
+    uint32_t mRetryAtMs = 0;                ///< millis() of the next login attempt
+    bool mRetryPending = false;             ///< mRetryAtMs is in effect
+    uint32_t mBackoffMs = 0;                ///< Delay after the next failure
+    uint32_t mConnects = 0;                 ///< Successful logins since boot
+    volatile bool mReloadRequested = false; ///< Set by saveConfig()
+};
+
+extern MqttLink gMqtt;
@@ -0,0 +1,115 @@
+/**
+ * @file NetworkLink.cpp
+ * @brief Non-blocking WiFi + Blynk connect/reconnect state machine implementation
+ */
+
+#include "NetworkLink.h"
+#include "WiFiManager.h"
+#include "BlynkGlobal.h"
+#include "Config.h"
+#include "Logging.h"
+#include <WiFi.h>
+
+NetworkLink gNetLink;
+
+const char* NetworkLink::stateName(NetLinkState state) {
+    switch (state) {
+        case NET_WIFI_DOWN:        return "wifi-down";
+        case NET_WIFI_CONNECTING:  return "wifi-connecting";
+        case NET_BLYNK_CONNECTING: return "blynk-connecting";
+        case NET_ONLINE:           return "online";
+        default:                   return "?";
+    }
+}
+
+void NetworkLink::begin(const char* auth) {
+    BlynkWrapper::config(auth);
+    mBackoffMs = NET_BACKOFF_MIN_MS;
+    mRetryPending = false;
+    mState = NET_WIFI_DOWN;
+    mStateSinceMs = millis();
+}
+
+void NetworkLink::enter(NetLinkState next, uint32_t nowMs) {
+    if (next == mState) return;
+    logf("[NET] %s -> %s", stateName(mState), stateName(next));
+    mState = next;
+    mStateSinceMs = nowMs;
+}
+
+void NetworkLink::backoff(uint32_t nowMs) {
+    if (!mBackoffMs) mBackoffMs = NET_BACKOFF_MIN_MS;
+    mRetryAtMs = nowMs + mBackoffMs;
+    mRetryPending = true;
+    logf("[NET] Reintento en %lu ms.", (unsigned long)mBackoffMs);
+    mBackoffMs = (mBackoffMs >= NET_BACKOFF_MAX_MS / 2) ? NET_BACKOFF_MAX_MS : mBackoffMs * 2;
+}
+
+void NetworkLink::loop(uint32_t nowMs) {
+    if (mReconnectRequested) {
+        mReconnectRequested = false;
+        logInfo("[NET] Reconexión solicitada.");
+        if (BlynkWrapper::connected()) BlynkWrapper::disconnect();
+        WiFi.disconnect(true);
+        mBackoffMs = NET_BACKOFF_MIN_MS;
+        mRetryPending = false;
+        enter(NET_WIFI_DOWN, nowMs);
+    }
+
+    const bool wifiUp = WiFi.status() == WL_CONNECTED;
+    const bool retryDue = !mRetryPending || (int32_t)(nowMs - mRetryAtMs) >= 0;
+
+    switch (mState) {
+        case NET_WIFI_DOWN:
+            if (wifiUp) {
+                // The stack reassociated on its own.
+                enter(NET_BLYNK_CONNECTING, nowMs);
+            } else if (retryDue) {
+                mRetryPending = false;
+                gWiFiMgr.startConnect();
+                enter(NET_WIFI_CONNECTING, nowMs);
+            }
+            break;
+
+        case NET_WIFI_CONNECTING:
+            if (wifiUp) {
+                logInfo("WiFi OK");
+                mBackoffMs = NET_BACKOFF_MIN_MS;
+                mRetryPending = false;
+                enter(NET_BLYNK_CONNECTING, nowMs);
+            } else if (nowMs - mStateSinceMs >= WIFI_CONNECT_TIMEOUT_MS) {
+                logInfo("WiFi FAIL");
+                WiFi.disconnect();
+                backoff(nowMs);
+                enter(NET_WIFI_DOWN, nowMs);
+            }
+            break;
+
+        case NET_BLYNK_CONNECTING:
+            if (!wifiUp) {
+                enter(NET_WIFI_DOWN, nowMs);
+            } else if (retryDue) {
+                // Bounded block: at most BLYNK_CONNECT_TIMEOUT_MS, in this task only.
+                if (BlynkWrapper::connect(BLYNK_CONNECT_TIMEOUT_MS)) {
+                    mBackoffMs = NET_BACKOFF_MIN_MS;
+                    mRetryPending = false;
+                    enter(NET_ONLINE, millis());
+                    if (mOnlineHook) mOnlineHook();
+                } else {
+                    logInfo("Blynk no conectado.");
+                    backoff(millis());
+                }
+            }
+            break;
+
+        case NET_ONLINE:
+            if (!wifiUp || !BlynkWrapper::connected()) {
+                // First retry is immediate; failures after that back off.
+                mRetryPending = false;
+                enter(wifiUp ? NET_BLYNK_CONNECTING : NET_WIFI_DOWN, nowMs);
+            } else {
+                BlynkWrapper::run();
+            }
+            break;
+    }
+}
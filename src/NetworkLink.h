@@ -0,0 +1,82 @@
+/**
+ * @file NetworkLink.h
+ * @brief Non-blocking WiFi + Blynk connect/reconnect state machine
+ *
+ * Runs inside the network task (see taskNetwork). Each loop() call does a
+ * bounded amount of work: WiFi association is polled rather than waited for,
+ * and a Blynk login blocks for at most BLYNK_CONNECT_TIMEOUT_MS. Failed
+ * attempts are retried with an exponential backoff between NET_BACKOFF_MIN_MS
+ * and NET_BACKOFF_MAX_MS. The control tasks never call into this module; they
+ * only exchange commands and status with the network task through queues.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @enum NetLinkState
+ * @brief Connection stage of the network task
+ */
+enum NetLinkState : uint8_t {
+    NET_WIFI_DOWN = 0,      ///< No WiFi; waiting for the next attempt
+    NET_WIFI_CONNECTING,    ///< Association in progress
+    NET_BLYNK_CONNECTING,   ///< WiFi up; logging in to Blynk (with backoff)
+    NET_ONLINE              ///< Blynk connected; events processed every loop
+};
+
+/**
+ * @class NetworkLink
+ * @brief Owner of the WiFi and Blynk connections
+ */
+class NetworkLink {
+public:
+    /**
+     * @brief Set the Blynk credentials; the first attempt starts on the next loop()
+     * @param auth Blynk authentication token
+     */
+    void begin(const char* auth);
+
+    /**
+     * @brief Advance the state machine and run Blynk while online
+     * @param nowMs Current millis()
+     */
+    void loop(uint32_t nowMs);
+
+    /**
+     * @brief Drop the current connections and start over without backoff
+     *
+     * Safe to call from any task; the network task acts on it.
+     */
+    void requestReconnect() { mReconnectRequested = true; }
+
+    /**
+     * @brief Register a function called each time Blynk comes online
+     *
+     * Runs in the network task after BLYNK_CONNECTED, so it may write pins.
+     */
+    void setOnlineHook(void (*hook)()) { mOnlineHook = hook; }
+
+    /** @brief Current stage */
+    NetLinkState state() const { return mState; }
+
+    /** @brief Short name of a stage for logs and the terminal */
+    static const char* stateName(NetLinkState state);
+
+private:
+    /** @brief Change stage and log the transition */
+    void enter(NetLinkState next, uint32_t nowMs);
+
+    /** @brief Schedule the next attempt after a failure and double the backoff */
+    void backoff(uint32_t nowMs);
+
+    NetLinkState mState = NET_WIFI_DOWN;   ///< Current stage
+    uint32_t mStateSinceMs = 0;            ///< millis() when the stage was entered
+    uint32_t mRetryAtMs = 0;               ///< millis() of the next attempt
+    bool mRetryPending = false;            ///< mRetryAtMs is in effect
+    uint32_t mBackoffMs = 0;               ///< Delay after the next failure
+    volatile bool mReconnectRequested = false;  ///< Set by requestReconnect()
+    void (*mOnlineHook)() = nullptr;       ///< Called on every transition to online
+};
+
+extern NetworkLink gNetLink;
@@ -0,0 +1,238 @@
+/**
+ * @file ScheduleProjector.cpp
+ * @brief Schedule look-ahead and dry-run implementation
+ */
+
+#include "ScheduleProjector.h"
+
+static const char* const DAY_NAMES[7] = {"mon", "tue", "wed", "thu", "fri", "sat", "sun"};
+
+/** @brief Events fetched from the scheduler per project() call */
+static const size_t SIM_CHUNK = 32;
+
+static const char* sourcePrefix(ScheduleSource source) {
+    switch (source) {
+        case SCHED_SRC_CRON:    return "C#";
+        case SCHED_SRC_PREHEAT: return "P#";
+        case SCHED_SRC_WINDOW:  return "W#";
+        default:                return "#";
+    }
+}
+
+/**
+ * @brief Split a window into non-wrapping [start, end) ranges of the week
+ * @return Number of ranges written (at most 14)
+ */
+static size_t windowSpans(const ScheduleWindow& w, uint16_t spans[][2]) {
+    size_t n = 0;
+    for (uint8_t d = 0; d < 7; d++) {
+        if (!(w.dayMask() & (1U << d))) continue;
+        uint32_t s = (uint32_t)d * SCHED_MINUTES_PER_DAY + w.startMinute();
+        uint32_t e = (uint32_t)d * SCHED_MINUTES_PER_DAY + w.endMinute();
+        if (w.wrapsMidnight()) e += SCHED_MINUTES_PER_DAY;
+        if (e > SCHED_MINUTES_PER_WEEK) {
+            spans[n][0] = (uint16_t)s;
+            spans[n++][1] = SCHED_MINUTES_PER_WEEK;
+            spans[n][0] = 0;
+            spans[n++][1] = (uint16_t)(e - SCHED_MINUTES_PER_WEEK);
+        } else {
+            spans[n][0] = (uint16_t)s;
+            spans[n++][1] = (uint16_t)e;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Format the rule part of an event: "#3 start power=4"
+ */
+static size_t formatRule(const ScheduleEvent& ev, char* buf, size_t cap) {
+    char idx[4];
+    if (ev.index == 0xFF) snprintf(idx, sizeof(idx), "?");
+    else snprintf(idx, sizeof(idx), "%u", (unsigned)ev.index);
+    int len;
+    if (ev.action == SCHED_ACTION_SHUTDOWN) {
+        len = snprintf(buf, cap, "%s%s %s", sourcePrefix(ev.source), idx, Scheduler::actionName(ev.action));
+    } else {
+        len = snprintf(buf, cap, "%s%s %s power=%u%s", sourcePrefix(ev.source), idx,
+                       Scheduler::actionName(ev.action), (unsigned)ev.power,
+                       ev.source == SCHED_SRC_PREHEAT ? " (est.)" : "");
+    }
+    if (len < 0) return 0;
+    return ((size_t)len < cap) ? (size_t)len : cap - 1;
+}
+
+size_t ScheduleProjector::formatEvent(const ScheduleEvent& ev, char* buf, size_t cap) {
+    if (!buf || cap < 11) return 0;
+    time_t at = (time_t)ev.minute * 60;
+    struct tm lt;
+    localtime_r(&at, &lt);
+    snprintf(buf, cap, "%s %02d:%02d ", DAY_NAMES[(lt.tm_wday + 6) % 7], lt.tm_hour, lt.tm_min);
+    return 10 + formatRule(ev, buf + 10, cap - 10);
+}
+
+size_t ScheduleProjector::nextEvents(time_t now, ScheduleEvent* out, size_t maxEvents, uint32_t horizonMin) {
+    uint32_t from = (uint32_t)(now / 60) + 1;
+    const uint32_t to = from + horizonMin;
+    size_t n = 0;
+    while (n < maxEvents && from < to) {
+        size_t got = mScheduler.project(from, to, out + n, maxEvents - n);
+        if (!got) break;
+        n += got;
+    }
+    return n;
+}
+
+void ScheduleProjector::checkWindowOverlaps(ScheduleSimReport& rep, Print* log) {
+    uint16_t a[14][2], b[14][2];
+    char line[96];
+    for (size_t i = 0; i < MAX_SCHEDULE_WINDOWS; i++) {
+        ScheduleWindow wi = mScheduler.getWindow(i);
+        if (wi.isEmpty()) continue;
+        size_t na = windowSpans(wi, a);
+        for (size_t j = i + 1; j < MAX_SCHEDULE_WINDOWS; j++) {
+            ScheduleWindow wj = mScheduler.getWindow(j);
+            if (wj.isEmpty()) continue;
+            size_t nb = windowSpans(wj, b);
+            bool found = false;
+            for (size_t x = 0; x < na && !found; x++) {
+                for (size_t y = 0; y < nb && !found; y++) {
+                    uint16_t s = (a[x][0] > b[y][0]) ? a[x][0] : b[y][0];
+                    uint16_t e = (a[x][1] < b[y][1]) ? a[x][1] : b[y][1];
+                    if (s >= e) continue;
+                    found = true;
+                    rep.overlaps++;
+                    if (log) {
+                        uint16_t mod = s % SCHED_MINUTES_PER_DAY;
+                        snprintf(line, sizeof(line), "\r\noverlap: W#%u and W#%u from %s %02u:%02u (power %u vs %u, highest wins)",
+                                 (unsigned)i, (unsigned)j, DAY_NAMES[s / SCHED_MINUTES_PER_DAY],
+                                 mod / 60, mod % 60, (unsigned)wi.power(), (unsigned)wj.power());
+                        log->print(line);
+                    }
+                }
+            }
+        }
+    }
+}
+
+ScheduleSimReport ScheduleProjector::dryRun(time_t now, uint16_t days, bool stoveOn, uint8_t power,
+                                            uint32_t msSinceOn, Print* log) {
+    ScheduleSimReport rep;
+    const uint32_t t0 = millis();
+    if (days < 1) days = 1;
+    if (days > SCHED_SIM_MAX_DAYS) days = SCHED_SIM_MAX_DAYS;
+
+    checkWindowOverlaps(rep, log);
+
+    const uint32_t startMin = (uint32_t)(now / 60) + 1;
+    const uint32_t endMin = startMin + (uint32_t)days * SCHED_MINUTES_PER_DAY;
+
+    // Virtual controller; times are milliseconds since startMin.
+    bool on = stoveOn;
+    uint8_t level = power;
+    int64_t onAtMs = stoveOn ? -(int64_t)msSinceOn : 0;
+    uint8_t windowPower = mScheduler.desiredPower(now);
+
+    ScheduleEvent chunk[SIM_CHUNK];
+    char text[64], other[64], line[160];
+    uint32_t from = startMin;
+    while (from < endMin) {
+        size_t n = mScheduler.project(from, endMin, chunk, SIM_CHUNK);
+        if (!n) break;
+        for (size_t i = 0; i < n;) {
+            size_t j = i;
+            while (j < n && chunk[j].minute == chunk[i].minute) j++;
+
+            // Contradictions within one minute: dispatch order decides.
+            const ScheduleEvent* onEv = nullptr;
+            const ScheduleEvent* offEv = nullptr;
+            const ScheduleEvent* powEv = nullptr;
+            const ScheduleEvent* clash = nullptr;
+            for (size_t k = i; k < j; k++) {
+                const ScheduleEvent& ev = chunk[k];
+                if (ev.action == SCHED_ACTION_SHUTDOWN) {
+                    if (!offEv) offEv = &ev;
+                } else {
+                    if (!onEv && ev.action == SCHED_ACTION_START) onEv = &ev;
+                    if (!powEv) powEv = &ev;
+                    else if (!clash && ev.power != powEv->power) clash = &ev;
+                }
+            }
+            if ((onEv && offEv) || clash) {
+                rep.conflicts++;
+                if (log) {
+                    const ScheduleEvent* x = clash ? powEv : (onEv < offEv ? onEv : offEv);
+                    const ScheduleEvent* y = clash ? clash : (onEv < offEv ? offEv : onEv);
+                    formatEvent(*x, text, sizeof(text));
+                    formatRule(*y, other, sizeof(other));
+                    snprintf(line, sizeof(line), "\r\nconflict: %s vs %s (last wins)", text, other);
+                    log->print(line);
+                }
+            }
+
+            for (size_t k = i; k < j; k++) {
+                const ScheduleEvent& ev = chunk[k];
+                const int64_t vms = (int64_t)(ev.minute - startMin) * 60000;
+                rep.events++;
+                if (ev.source == SCHED_SRC_WINDOW) windowPower = ev.power;
+                switch (ev.action) {
+                    case SCHED_ACTION_START:
+                        if (!on) {
+                            if (ev.power) level = ev.power;
+                            on = true;
+                            onAtMs = vms;
+                            rep.starts++;
+                        } else if (ev.source != SCHED_SRC_PREHEAT && ev.power && ev.power != level) {
+                            level = ev.power;
+                            rep.powerChanges++;
+                        } else {
+                            rep.noEffect++;
+                        }
+                        break;
+                    case SCHED_ACTION_POWER:
+                        if (on && ev.power && ev.power != level) {
+                            level = ev.power;
+                            rep.powerChanges++;
+                        } else {
+                            rep.noEffect++;
+                        }
+                        break;
+                    case SCHED_ACTION_SHUTDOWN:
+                        if (!on) {
+                            rep.noEffect++;
+                        } else if (vms - onAtMs < (int64_t)SAFETY_MIN_ON_TIME_MS) {
+                            rep.conflicts++;
+                            if (log) {
+                                formatEvent(ev, text, sizeof(text));
+                                snprintf(line, sizeof(line), "\r\nrefused: %s (on for %lu min, minimum %lu)",
+                                         text, (unsigned long)((vms - onAtMs) / 60000),
+                                         (unsigned long)(SAFETY_MIN_ON_TIME_MS / 60000UL));
+                                log->print(line);
+                            }
+                        } else {
+                            rep.onMinutes += (uint32_t)((vms - (onAtMs > 0 ? onAtMs : 0)) / 60000);
+                            on = false;
+                            rep.shutdowns++;
+                            if (windowPower && ev.source != SCHED_SRC_WINDOW) {
+                                rep.conflicts++;
+                                if (log) {
+                                    formatEvent(ev, text, sizeof(text));
+                                    snprintf(line, sizeof(line), "\r\nconflict: %s inside a window (power %u), stays off until its next edge",
+                                             text, (unsigned)windowPower);
+                                    log->print(line);
+                                }
+                            }
+                        }
+                        break;
+                }
+            }
+            i = j;
+        }
+    }
+    if (on) {
+        const int64_t endMs = (int64_t)(endMin - startMin) * 60000;
+        rep.onMinutes += (uint32_t)((endMs - (onAtMs > 0 ? onAtMs : 0)) / 60000);
+    }
+    rep.elapsedMs = millis() - t0;
+    return rep;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file ScheduleProjector.h
+ * @brief Look-ahead over the schedule: upcoming events and a dry run
+ *
+ * Answers "what will the scheduler do this week?" without waiting for it.
+ * Events come from Scheduler::project(); the dry run replays them in
+ * virtual time against a small model of the controller (the same rules the
+ * scheduler task's dispatch applies: start only when off, power and
+ * shutdown only while on, shutdown refused before SAFETY_MIN_ON_TIME_MS)
+ * and reports conflicts and overlaps. A week runs in a few milliseconds.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "Scheduler.h"
+#include "Config.h"
+
+/**
+ * @struct ScheduleSimReport
+ * @brief Outcome of ScheduleProjector::dryRun()
+ */
+struct ScheduleSimReport {
+    uint32_t events = 0;        ///< Events dispatched
+    uint32_t starts = 0;        ///< Off -> on transitions
+    uint32_t shutdowns = 0;     ///< On -> off transitions
+    uint32_t powerChanges = 0;  ///< Power changes while running
+    uint32_t noEffect = 0;      ///< Events that change nothing (already in that state)
+    uint32_t conflicts = 0;     ///< Same-minute contradictions and refused shutdowns
+    uint32_t overlaps = 0;      ///< Pairs of windows that overlap
+    uint32_t onMinutes = 0;     ///< Virtual minutes the stove runs
+    uint32_t elapsedMs = 0;     ///< Real time the dry run took
+};
+
+/**
+ * @class ScheduleProjector
+ * @brief Read-only projection of a Scheduler's rules into the future
+ */
+class ScheduleProjector {
+public:
+    /**
+     * @brief Bind to a scheduler
+     */
+    explicit ScheduleProjector(Scheduler& scheduler) : mScheduler(scheduler) {}
+
+    /**
+     * @brief List the next events after now
+     * @param now Current wall-clock time (the current minute is excluded,
+     *        it has already been evaluated)
+     * @param out Receives events in firing order
+     * @param maxEvents Capacity of out
+     * @param horizonMin How far ahead to look (minutes)
+     * @return Number of events written
+     */
+    size_t nextEvents(time_t now, ScheduleEvent* out, size_t maxEvents,
+                      uint32_t horizonMin = SCHED_MINUTES_PER_WEEK);
+
+    /**
+     * @brief Simulate the schedule and the controller's reactions
+     * @param now Start of the simulation (wall-clock time)
+     * @param days Days to simulate (1-SCHED_SIM_MAX_DAYS)
+     * @param stoveOn Stove state at the start
+     * @param power Power level at the start
+     * @param msSinceOn Time the stove has already been on (safety minimum)
+     * @param log Optional sink receiving one line per conflict or overlap
+     * @return Counters for the simulated period
+     */
+    ScheduleSimReport dryRun(time_t now, uint16_t days, bool stoveOn, uint8_t power,
+                             uint32_t msSinceOn, Print* log);
+
+    /**
+     * @brief Format an event as "mon 07:00 #3 start power=4"
+     * @param ev Event to format (local time)
+     * @param buf Destination buffer
+     * @param cap Capacity of buf
+     * @return Length of the text in buf
+     */
+    static size_t formatEvent(const ScheduleEvent& ev, char* buf, size_t cap);
+
+private:
+    /**
+     * @brief Report every pair of windows that cover a common minute
+     */
+    void checkWindowOverlaps(ScheduleSimReport& rep, Print* log);
+
+    Scheduler& mScheduler;  ///< Scheduler being projected
+};
@@ -0,0 +1,109 @@
+/**
+ * @file ScheduleStore.cpp
+ * @brief Persistent, versioned storage of the scheduler table implementation
+ */
+
+#include "ScheduleStore.h"
+#include "Config.h"
+#include "Logging.h"
+
+static const char* const SLOT_KEYS[2] = {"s0", "s1"};
+static const char* const CURRENT_KEY = "cur";
+
+uint32_t ScheduleStore::crc32(uint32_t crc, const uint8_t* data, size_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+        }
+    }
+    return ~crc;
+}
+
+bool ScheduleStore::begin() {
+    _open = _prefs.begin(SCHED_STORE_NAMESPACE, false);
+    if (!_open) {
+        logInfo("[SCHED] NVS no disponible, el programa no se guardará.");
+    }
+    return _open;
+}
+
+size_t ScheduleStore::readSlot(uint8_t slot, uint8_t* buf, size_t cap) {
+    size_t blobLen = _prefs.getBytesLength(SLOT_KEYS[slot]);
+    if (blobLen < sizeof(ScheduleBlobHeader) || blobLen > cap) return 0;
+    if (_prefs.getBytes(SLOT_KEYS[slot], buf, blobLen) != blobLen) return 0;
+
+    ScheduleBlobHeader hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != SCHED_STORE_MAGIC) return 0;
+    if (hdr.version > SCHED_STORE_VERSION) return 0;
+    if (sizeof(hdr) + hdr.length != blobLen) return 0;
+
+    uint32_t stored = hdr.crc;
+    hdr.crc = 0;
+    uint32_t crc = crc32(0, (const uint8_t*)&hdr, sizeof(hdr));
+    crc = crc32(crc, buf + sizeof(hdr), hdr.length);
+    if (crc != stored) {
+        logf("[SCHED] Slot %u corrupto (CRC), ignorado.", (unsigned)slot);
+        return 0;
+    }
+
+    memmove(buf, buf + sizeof(hdr), hdr.length);
+    _generation = hdr.generation;
+    _payloadCrc = crc32(0, buf, hdr.length);
+    return hdr.length;
+}
+
+size_t ScheduleStore::load(uint8_t* buf, size_t cap) {
+    if (!_open) return 0;
+    uint8_t cur = _prefs.getUChar(CURRENT_KEY, 0) & 1;
+    size_t len = readSlot(cur, buf, cap);
+    if (len == 0) {
+        cur ^= 1;
+        len = readSlot(cur, buf, cap);
+    }
+    if (len == 0) return 0;
+    _current = cur;
+    _hasImage = true;
+    return len;
+}
+
+bool ScheduleStore::save(const uint8_t* payload, size_t len) {
+    if (!_open) return false;
+    if (len > 0xFFFF) return false;
+    uint32_t payloadCrc = crc32(0, payload, len);
+    if (_hasImage && payloadCrc == _payloadCrc) return true;
+
+    static uint8_t blob[sizeof(ScheduleBlobHeader) + SCHED_STORE_MAX_PAYLOAD];
+    if (len > SCHED_STORE_MAX_PAYLOAD) return false;
+
+    ScheduleBlobHeader hdr;
+    hdr.magic = SCHED_STORE_MAGIC;
+    hdr.version = SCHED_STORE_VERSION;
+    hdr.length = (uint16_t)len;
+    hdr.generation = _generation + 1;
+    hdr.crc = 0;
+    uint32_t crc = crc32(0, (const uint8_t*)&hdr, sizeof(hdr));
+    hdr.crc = crc32(crc, payload, len);
+
+    memcpy(blob, &hdr, sizeof(hdr));
+    memcpy(blob + sizeof(hdr), payload, len);
+
+    uint8_t next = _hasImage ? (_current ^ 1) : _current;
+    size_t total = sizeof(hdr) + len;
+    if (_prefs.putBytes(SLOT_KEYS[next], blob, total) != total) {
+        logInfo("[SCHED] Error escribiendo programa en NVS.");
+        return false;
+    }
+    if (next != _current || !_prefs.isKey(CURRENT_KEY)) {
+        _prefs.putUChar(CURRENT_KEY, next);
+    }
+
+    _current = next;
+    _generation = hdr.generation;
+    _payloadCrc = payloadCrc;
+    _hasImage = true;
+    logf("[SCHED] Programa guardado (gen %lu, %u bytes).", (unsigned long)_generation, (unsigned)total);
+    return true;
+}
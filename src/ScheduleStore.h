@@ -0,0 +1,104 @@
+/**
+ * @file ScheduleStore.h
+ * @brief Persistent, versioned storage of the scheduler table in NVS
+ *
+ * The schedule is saved as a single binary blob made of a fixed header and a
+ * sequence of tagged sections. Two blob slots are kept in NVS: a save always
+ * writes the inactive slot and only then flips the "current slot" key, so a
+ * power cut during a write leaves the previous copy intact. Each blob carries
+ * a CRC32 over header and payload and is ignored on mismatch.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+/** @brief Blob magic ("MNSC") */
+#define SCHED_STORE_MAGIC    0x43534E4DUL
+
+/** @brief Current blob header layout version */
+#define SCHED_STORE_VERSION  1
+
+/**
+ * @struct ScheduleBlobHeader
+ * @brief Fixed header at the start of every stored schedule blob
+ */
+struct ScheduleBlobHeader {
+  uint32_t magic;        ///< SCHED_STORE_MAGIC
+  uint16_t version;      ///< SCHED_STORE_VERSION at write time
+  uint16_t length;       ///< Payload length in bytes (sections only)
+  uint32_t generation;   ///< Incremented on every save
+  uint32_t crc;          ///< CRC32 of header (crc field zeroed) and payload
+};
+
+/**
+ * @struct ScheduleSectionHeader
+ * @brief Header of one tagged section inside the payload
+ *
+ * Unknown tags are skipped on load, so newer firmware can add sections
+ * without breaking older images.
+ */
+struct ScheduleSectionHeader {
+  uint8_t tag;           ///< Section type (see Scheduler::SECTION_*)
+  uint8_t reserved;      ///< Always 0
+  uint16_t length;       ///< Section payload length in bytes
+};
+
+/**
+ * @class ScheduleStore
+ * @brief Double-buffered, CRC-protected blob storage on top of Preferences
+ */
+class ScheduleStore {
+public:
+  /**
+   * @brief Open the NVS namespace
+   * @return true if NVS is available
+   */
+  bool begin();
+
+  /**
+   * @brief Load the current schedule payload
+   * @param buf Buffer receiving the section payload (header stripped)
+   * @param cap Capacity of buf in bytes; must also fit the blob header
+   * @return Payload length, or 0 if no valid image exists
+   *
+   * Reads the current slot with a single blob read and only falls back to
+   * the other slot if the current one fails validation.
+   */
+  size_t load(uint8_t* buf, size_t cap);
+
+  /**
+   * @brief Save a new schedule payload
+   * @param payload Section payload to store
+   * @param len Payload length in bytes
+   * @return true if stored (or identical to the last stored payload)
+   *
+   * Writes the inactive slot and then makes it current. Skipped when the
+   * payload CRC matches the last loaded or saved image.
+   */
+  bool save(const uint8_t* payload, size_t len);
+
+  /**
+   * @brief Compute a CRC32 (IEEE 802.3, reflected)
+   * @param crc Running CRC (pass 0 to start)
+   * @param data Data to add
+   * @param len Data length in bytes
+   * @return Updated CRC
+   */
+  static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t len);
+
+private:
+  /**
+   * @brief Read and validate one slot
+   * @return Payload length, or 0 if the slot is missing or corrupt
+   */
+  size_t readSlot(uint8_t slot, uint8_t* buf, size_t cap);
+
+  Preferences _prefs;            ///< NVS handle
+  bool _open = false;            ///< Namespace opened successfully
+  uint8_t _current = 0;          ///< Slot holding the newest valid image
+  uint32_t _generation = 0;      ///< Generation of the newest valid image
+  uint32_t _payloadCrc = 0;      ///< CRC of the newest payload (for skip-if-equal)
+  bool _hasImage = false;        ///< A valid image was loaded or saved
+};
@@ -1,73 +1,1427 @@
 #include "Scheduler.h"
+#include "BufferPrint.h"
+#include "ThermalModel.h"
+#include "Logging.h"
+#include <stdarg.h>
+
+static uint8_t sPersistBuf[sizeof(ScheduleBlobHeader) + SCHED_STORE_MAX_PAYLOAD];
+
+/** @brief Evaluation watermark kept across soft resets (not initialised at boot) */
+struct SchedulerRtcState {
+  uint32_t magic;
+  uint32_t watermarkMin;
+  uint32_t check;
+};
+static const uint32_t RTC_STATE_MAGIC=0x5343574DUL;
+RTC_NOINIT_ATTR static SchedulerRtcState sRtcState;
 
 void Scheduler::begin(){
   _globalEnabled=true;
   _mutex=xSemaphoreCreateMutex();
+  _storeMutex=xSemaphoreCreateMutex();
+  memset(_snap,0,sizeof(_snap));
+  _readers[0].store(0);
+  _readers[1].store(0);
+  _current.store(0);
+  ScheduleSnapshot& snap=_snap[0];
+  if (_store.begin()){
+    size_t len=_store.load(sPersistBuf,sizeof(sPersistBuf));
+    if (len>0 && decode(snap,sPersistBuf,len)){
+      logInfo("[SCHED] Programa restaurado desde NVS.");
+    } else if (len>0){
+      logInfo("[SCHED] Programa en NVS no válido, se usa vacío.");
+      // Sections decoded before the error must not survive either
+      memset(&snap,0,sizeof(snap));
+      _globalEnabled=true;
+    }
+  }
+  rebuildMinuteIndex(snap);
+  rebuildWindowIndex(snap);
+}
+
+const ScheduleSnapshot& Scheduler::acquireSnapshot(uint8_t& slot) const{
+  // Pin, then confirm the buffer is still the published one; if an editor
+  // swapped in between, drop the pin and retry on the new snapshot.
+  for(;;){
+    slot=_current.load();
+    _readers[slot].fetch_add(1);
+    if (_current.load()==slot) return _snap[slot];
+    _readers[slot].fetch_sub(1);
+  }
+}
+
+void Scheduler::releaseSnapshot(uint8_t slot) const{
+  _readers[slot].fetch_sub(1);
+}
+
+ScheduleSnapshot& Scheduler::beginEdit(){
+  uint8_t cur=_current.load();
+  uint8_t back=cur ^ 1;
+  // Readers left on the back buffer are finishing a scan of the previous
+  // snapshot; that takes microseconds, so just yield until they are gone.
+  while (_readers[back].load()!=0) vTaskDelay(1);
+  memcpy(&_snap[back],&_snap[cur],sizeof(ScheduleSnapshot));
+  return _snap[back];
+}
+
+void Scheduler::publishSnapshot(ScheduleSnapshot& snap){
+  rebuildMinuteIndex(snap);
+  rebuildWindowIndex(snap);
+  _current.store((uint8_t)(&snap-_snap));
+}
+
+void Scheduler::markDirty(){
+  uint32_t now=millis();
+  if (!_dirty) _firstDirtyMs=now;
+  _lastEditMs=now;
+  _dirty=true;
+}
+
+size_t Scheduler::encode(const ScheduleSnapshot& snap, uint8_t* buf, size_t cap) const{
+  size_t count=0;
   for(size_t i=0;i<MAX_SCHEDULE_ENTRIES;i++){
-    _entries[i].active=false;
-    _entries[i].day=WD_MON;
-    _entries[i].hour=0;
-    _entries[i].minute=0;
-    _entries[i].targetPower=1;
+    if (!snap.entries[i].isEmpty()) count=i+1;
+  }
+  size_t windows=0;
+  for(size_t i=0;i<MAX_SCHEDULE_WINDOWS;i++){
+    if (!snap.windows[i].isEmpty()) windows=i+1;
   }
+  size_t need=2*sizeof(ScheduleSectionHeader)+4+count*sizeof(ScheduleEntry);
+  if (windows) need+=sizeof(ScheduleSectionHeader)+windows*sizeof(ScheduleWindow);
+  size_t rules=0;
+  for(size_t i=0;i<MAX_CRON_RULES;i++){
+    if (!snap.cron[i].isEmpty()) rules=i+1;
+  }
+  if (rules) need+=sizeof(ScheduleSectionHeader)+rules*sizeof(CronRule);
+  size_t preheat=0;
+  for(size_t i=0;i<MAX_PREHEAT_RULES;i++){
+    if (!snap.preheat[i].isEmpty()) preheat=i+1;
+  }
+  if (preheat) need+=sizeof(ScheduleSectionHeader)+preheat*sizeof(PreheatRule);
+  if (need>cap) return 0;
+
+  size_t off=0;
+  ScheduleSectionHeader sh{SECTION_SETTINGS,0,4};
+  memcpy(buf+off,&sh,sizeof(sh)); off+=sizeof(sh);
+  uint8_t settings[4]={(uint8_t)(_globalEnabled?1:0),0,0,0};
+  memcpy(buf+off,settings,4); off+=4;
+
+  sh={SECTION_ENTRIES,0,(uint16_t)(count*sizeof(ScheduleEntry))};
+  memcpy(buf+off,&sh,sizeof(sh)); off+=sizeof(sh);
+  memcpy(buf+off,snap.entries,count*sizeof(ScheduleEntry)); off+=count*sizeof(ScheduleEntry);
+
+  if (windows){
+    sh={SECTION_WINDOWS,0,(uint16_t)(windows*sizeof(ScheduleWindow))};
+    memcpy(buf+off,&sh,sizeof(sh)); off+=sizeof(sh);
+    memcpy(buf+off,snap.windows,windows*sizeof(ScheduleWindow)); off+=windows*sizeof(ScheduleWindow);
+  }
+
+  if (rules){
+    sh={SECTION_CRON,0,(uint16_t)(rules*sizeof(CronRule))};
+    memcpy(buf+off,&sh,sizeof(sh)); off+=sizeof(sh);
+    memcpy(buf+off,snap.cron,rules*sizeof(CronRule)); off+=rules*sizeof(CronRule);
+  }
+
+  if (preheat){
+    sh={SECTION_PREHEAT,0,(uint16_t)(preheat*sizeof(PreheatRule))};
+    memcpy(buf+off,&sh,sizeof(sh)); off+=sizeof(sh);
+    memcpy(buf+off,snap.preheat,preheat*sizeof(PreheatRule)); off+=preheat*sizeof(PreheatRule);
+  }
+  return off;
+}
+
+bool Scheduler::decode(ScheduleSnapshot& snap, const uint8_t* buf, size_t len){
+  size_t off=0;
+  while (off+sizeof(ScheduleSectionHeader)<=len){
+    ScheduleSectionHeader sh;
+    memcpy(&sh,buf+off,sizeof(sh));
+    off+=sizeof(sh);
+    if (off+sh.length>len) return false;
+    const uint8_t* p=buf+off;
+    switch(sh.tag){
+      case SECTION_SETTINGS:
+        if (sh.length>=1) _globalEnabled=(p[0] & 1)!=0;
+        break;
+      case SECTION_ENTRIES: {
+        size_t n=sh.length/sizeof(ScheduleEntry);
+        if (n>MAX_SCHEDULE_ENTRIES) n=MAX_SCHEDULE_ENTRIES;
+        memcpy(snap.entries,p,n*sizeof(ScheduleEntry));
+        for(size_t i=0;i<n;i++){
+          const ScheduleEntry& e=snap.entries[i];
+          if (!e.isEmpty() && (e.minuteOfDay()>=SCHED_MINUTES_PER_DAY || e.action()>SCHED_ACTION_SHUTDOWN))
+            snap.entries[i].raw=0;
+        }
+        break;
+      }
+      case SECTION_WINDOWS: {
+        size_t n=sh.length/sizeof(ScheduleWindow);
+        if (n>MAX_SCHEDULE_WINDOWS) n=MAX_SCHEDULE_WINDOWS;
+        memcpy(snap.windows,p,n*sizeof(ScheduleWindow));
+        for(size_t i=0;i<n;i++){
+          const ScheduleWindow& w=snap.windows[i];
+          if (!w.isEmpty() && (w.startMinute()>=SCHED_MINUTES_PER_DAY || w.endMinute()>=SCHED_MINUTES_PER_DAY ||
+                               w.startMinute()==w.endMinute() || w.power()<1 || w.power()>5))
+            snap.windows[i].raw=0;
+        }
+        break;
+      }
+      case SECTION_CRON: {
+        size_t n=sh.length/sizeof(CronRule);
+        if (n>MAX_CRON_RULES) n=MAX_CRON_RULES;
+        memcpy(snap.cron,p,n*sizeof(CronRule));
+        for(size_t i=0;i<n;i++){
+          CronRule& r=snap.cron[i];
+          if (r.isEmpty()) continue;
+          if ((r.minutes>>60) || (r.hours>>24) || r.action>SCHED_ACTION_SHUTDOWN)
+            memset(&r,0,sizeof(r));
+        }
+        break;
+      }
+      case SECTION_PREHEAT: {
+        size_t n=sh.length/sizeof(PreheatRule);
+        if (n>MAX_PREHEAT_RULES) n=MAX_PREHEAT_RULES;
+        memcpy(snap.preheat,p,n*sizeof(PreheatRule));
+        for(size_t i=0;i<n;i++){
+          const PreheatRule& r=snap.preheat[i];
+          if (!r.isEmpty() && (r.minuteOfDay()>=SCHED_MINUTES_PER_DAY || r.power()<1 || r.power()>5))
+            snap.preheat[i].raw=0;
+        }
+        break;
+      }
+      default:
+        break;  // Unknown section from newer firmware: skip.
+    }
+    off+=sh.length;
+  }
+  return off==len;
+}
+
+void Scheduler::persistIfDue(uint32_t nowMs){
+  if (!_dirty || !_mutex) return;
+  if ((nowMs-_lastEditMs)<SCHED_PERSIST_DEBOUNCE_MS &&
+      (nowMs-_firstDirtyMs)<SCHED_PERSIST_MAX_DELAY_MS) return;
+  flush();
 }
 
-bool Scheduler::updateEntry(int idx,bool active,uint8_t day,uint8_t hour,uint8_t minute,uint8_t power){
+void Scheduler::flush(){
+  if (!_mutex || !_storeMutex) return;
+  // sPersistBuf is shared by every caller (scheduler task, 'sched save',
+  // reboot): hold the store mutex from encode until the NVS write is done.
+  if (xSemaphoreTake(_storeMutex,pdMS_TO_TICKS(500))!=pdTRUE) return;
+  if (xSemaphoreTake(_mutex,pdMS_TO_TICKS(200))!=pdTRUE){
+    xSemaphoreGive(_storeMutex);
+    return;
+  }
+  if (!_dirty){
+    xSemaphoreGive(_mutex);
+    xSemaphoreGive(_storeMutex);
+    return;
+  }
+  uint8_t slot;
+  const ScheduleSnapshot& snap=acquireSnapshot(slot);
+  size_t len=encode(snap,sPersistBuf,SCHED_STORE_MAX_PAYLOAD);
+  releaseSnapshot(slot);
+  _dirty=false;
+  xSemaphoreGive(_mutex);
+  bool saved=len>0 && _store.save(sPersistBuf,len);
+  xSemaphoreGive(_storeMutex);
+  if (!saved){
+    logInfo("[SCHED] No se pudo guardar el programa, se reintentará.");
+    xSemaphoreTake(_mutex,portMAX_DELAY);
+    markDirty();
+    xSemaphoreGive(_mutex);
+  }
+}
+
+bool Scheduler::updateEntry(int idx,bool active,uint8_t dayMask,uint8_t hour,uint8_t minute,uint8_t power,ScheduleAction action,uint8_t graceMin){
   if (idx<0 || idx>=(int)MAX_SCHEDULE_ENTRIES) return false;
-  if (day<1 || day>7) return false;
+  if (dayMask==0 || dayMask>DM_ALL) return false;
   if (hour>23 || minute>59) return false;
+  if (action>SCHED_ACTION_SHUTDOWN) return false;
   if (power<1) power=1;
   if (power>5) power=5;
   if (!_mutex) return false;
   if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE) return false;
-  _entries[idx].active=active;
-  _entries[idx].day=(Weekday)day;
-  _entries[idx].hour=hour;
-  _entries[idx].minute=minute;
-  _entries[idx].targetPower=power;
+  ScheduleSnapshot& next=beginEdit();
+  next.entries[idx]=ScheduleEntry::make(active,dayMask,hour,minute,power,action,graceMin);
+  publishSnapshot(next);
+  markDirty();
   xSemaphoreGive(_mutex);
+  notifyChanged();
   return true;
 }
 
+bool Scheduler::updateEntry(int idx,const ScheduleEntry& e){
+  return updateEntry(idx,e.active(),e.dayMask(),e.hour(),e.minute(),e.targetPower(),e.action(),e.graceMinutes());
+}
+
 ScheduleEntry Scheduler::getEntry(size_t idx){
   if (idx>=MAX_SCHEDULE_ENTRIES) idx=MAX_SCHEDULE_ENTRIES-1;
-  ScheduleEntry e=_entries[idx];
-  if (!_mutex) return e;
-  if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE) return e;
-  e=_entries[idx];
-  xSemaphoreGive(_mutex);
+  uint8_t slot;
+  ScheduleEntry e=acquireSnapshot(slot).entries[idx];
+  releaseSnapshot(slot);
   return e;
 }
 
-void Scheduler::setGlobalEnabled(bool en){ _globalEnabled=en; }
-bool Scheduler::isGlobalEnabled() const{ return _globalEnabled; }
+bool Scheduler::updateWindow(int idx,uint8_t dayMask,uint16_t startMin,uint16_t endMin,uint8_t power){
+  if (idx<0 || idx>=(int)MAX_SCHEDULE_WINDOWS) return false;
+  if (dayMask==0 || dayMask>DM_ALL) return false;
+  if (startMin>=SCHED_MINUTES_PER_DAY || endMin>=SCHED_MINUTES_PER_DAY || startMin==endMin) return false;
+  if (power<1) power=1;
+  if (power>5) power=5;
+  if (!_mutex) return false;
+  if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE) return false;
+  ScheduleSnapshot& next=beginEdit();
+  next.windows[idx]=ScheduleWindow::make(dayMask,startMin,endMin,power);
+  publishSnapshot(next);
+  markDirty();
+  xSemaphoreGive(_mutex);
+  _windowsReconciled=false;
+  notifyChanged();
+  return true;
+}
+
+bool Scheduler::clearWindow(int idx){
+  if (idx<0 || idx>=(int)MAX_SCHEDULE_WINDOWS) return false;
+  if (!_mutex) return false;
+  if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE) return false;
+  ScheduleSnapshot& next=beginEdit();
+  next.windows[idx].raw=0;
+  publishSnapshot(next);
+  markDirty();
+  xSemaphoreGive(_mutex);
+  _windowsReconciled=false;
+  notifyChanged();
+  return true;
+}
 
-void Scheduler::evaluate(uint8_t day,uint8_t hour,uint8_t minute,bool stoveOn,void(*startAndPower)(uint8_t)){
-  if (!_globalEnabled) return;
+bool Scheduler::setCronRule(int idx,const char* text){
+  if (idx<0 || idx>=(int)MAX_CRON_RULES || !text) return false;
+  CronRule rule;
+  memset(&rule,0,sizeof(rule));
+  while (*text==' ') text++;
+  if (strcasecmp(text,"clear")!=0 && !parseCron(text,rule)) return false;
+  if (!_mutex) return false;
+  if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE) return false;
+  ScheduleSnapshot& next=beginEdit();
+  next.cron[idx]=rule;
+  publishSnapshot(next);
+  markDirty();
+  xSemaphoreGive(_mutex);
+  notifyChanged();
+  return true;
+}
+
+CronRule Scheduler::getCronRule(size_t idx){
+  CronRule r;
+  memset(&r,0,sizeof(r));
+  if (idx>=MAX_CRON_RULES) return r;
+  uint8_t slot;
+  r=acquireSnapshot(slot).cron[idx];
+  releaseSnapshot(slot);
+  return r;
+}
+
+bool Scheduler::updatePreheat(int idx,uint8_t dayMask,uint16_t minuteOfDay,float targetTemp,uint8_t power){
+  if (idx<0 || idx>=(int)MAX_PREHEAT_RULES) return false;
+  if (dayMask==0 || dayMask>DM_ALL) return false;
+  if (minuteOfDay>=SCHED_MINUTES_PER_DAY) return false;
+  if (!(targetTemp>=5.0f && targetTemp<=35.0f)) return false;
+  if (power<1) power=1;
+  if (power>5) power=5;
+  if (!_mutex) return false;
+  if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE) return false;
+  ScheduleSnapshot& next=beginEdit();
+  next.preheat[idx]=PreheatRule::make(dayMask,minuteOfDay,targetTemp,power);
+  publishSnapshot(next);
+  markDirty();
+  xSemaphoreGive(_mutex);
+  _preheatDone[idx]=0;
+  notifyChanged();
+  return true;
+}
+
+bool Scheduler::clearPreheat(int idx){
+  if (idx<0 || idx>=(int)MAX_PREHEAT_RULES) return false;
+  if (!_mutex) return false;
+  if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE) return false;
+  ScheduleSnapshot& next=beginEdit();
+  next.preheat[idx].raw=0;
+  publishSnapshot(next);
+  markDirty();
+  xSemaphoreGive(_mutex);
+  notifyChanged();
+  return true;
+}
+
+PreheatRule Scheduler::getPreheat(size_t idx){
+  PreheatRule r{0};
+  if (idx>=MAX_PREHEAT_RULES) return r;
+  uint8_t slot;
+  r=acquireSnapshot(slot).preheat[idx];
+  releaseSnapshot(slot);
+  return r;
+}
+
+void Scheduler::setThermalModel(ThermalModel* model){ _thermal=model; }
+
+void Scheduler::evaluatePreheat(const PreheatRule* rules,time_t now,bool stoveOn,PendingActions& out){
+  struct tm t;
+  localtime_r(&now,&t);
+  uint32_t nowMin=(uint32_t)(now/60);
+  uint8_t today=(uint8_t)((t.tm_wday+6)%7);
+  uint16_t mod=(uint16_t)(t.tm_hour*60+t.tm_min);
+  for(size_t i=0;i<MAX_PREHEAT_RULES;i++){
+    const PreheatRule& r=rules[i];
+    if (r.isEmpty()) continue;
+    // Next target occurrence (today's counts until the target minute passes).
+    uint32_t until=0;
+    bool found=false;
+    for(uint8_t d=0;d<=7 && !found;d++){
+      if (!(r.dayMask() & (1U << ((today+d)%7)))) continue;
+      int32_t delta=(int32_t)d*SCHED_MINUTES_PER_DAY+r.minuteOfDay()-mod;
+      if (delta>=0){ until=(uint32_t)delta; found=true; }
+    }
+    if (!found || until>PREHEAT_MAX_LEAD_MIN) continue;
+    uint32_t occurrence=nowMin+until;
+    if (_preheatDone[i]==occurrence) continue;
+    if (stoveOn){
+      _preheatDone[i]=occurrence;  // Already heating: nothing to plan.
+      continue;
+    }
+
+    bool start;
+    if (_thermal && _thermal->hasTemp()){
+      float latest=_thermal->latestStartMinutes(r.targetTemp(),r.power(),(float)until);
+      bool staysWarm=_thermal->predictOff((float)until)>=r.targetTemp();
+      start=!staysWarm && latest<=PREHEAT_MARGIN_MIN;
+      if (start){
+        logf("[SCHED] P#%u: %.1f C -> %.1f C a las %02u:%02u, arranque ahora (potencia %u).",
+             (unsigned)i,_thermal->currentTemp(),r.targetTemp(),
+             r.minuteOfDay()/60,r.minuteOfDay()%60,r.power());
+      }
+    } else {
+      start=until<=PREHEAT_FALLBACK_LEAD_MIN;
+    }
+    if (start || until==0){
+      if (start) out.push(SCHED_ACTION_START,r.power());
+      _preheatDone[i]=occurrence;
+    }
+  }
+}
+
+void Scheduler::setWakeTask(TaskHandle_t task){ _wakeTask=task; }
+
+void Scheduler::notifyChanged(){
+  if (_wakeTask) xTaskNotifyGive(_wakeTask);
+}
+
+ScheduleWindow Scheduler::getWindow(size_t idx){
+  ScheduleWindow w{0};
+  if (idx>=MAX_SCHEDULE_WINDOWS) return w;
+  uint8_t slot;
+  w=acquireSnapshot(slot).windows[idx];
+  releaseSnapshot(slot);
+  return w;
+}
+
+uint8_t Scheduler::desiredPower(time_t now){
+  if (!_mutex || now<SCHED_TIME_VALID_EPOCH) return 0;
+  struct tm t;
+  localtime_r(&now,&t);
+  uint8_t slot;
+  uint8_t power=windowPowerAt(acquireSnapshot(slot),minuteOfWeek(t));
+  releaseSnapshot(slot);
+  return power;
+}
+
+void Scheduler::setGlobalEnabled(bool en){
+  if (en==_globalEnabled) return;
+  _globalEnabled=en;
   if (!_mutex) return;
   if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE) return;
+  markDirty();
+  xSemaphoreGive(_mutex);
+  notifyChanged();
+}
+bool Scheduler::isGlobalEnabled() const{ return _globalEnabled; }
+
+void Scheduler::rebuildMinuteIndex(ScheduleSnapshot& snap){
+  memset(snap.minuteIndex,0,sizeof(snap.minuteIndex));
   for(size_t i=0;i<MAX_SCHEDULE_ENTRIES;i++){
-    const ScheduleEntry& e=_entries[i];
-    if (!e.active) continue;
-    if ((uint8_t)e.day!=day) continue;
-    if (e.hour==hour && e.minute==minute){
-      startAndPower(e.targetPower);
+    const ScheduleEntry& e=snap.entries[i];
+    if (!e.active() || e.isEmpty()) continue;
+    uint16_t m=e.minuteOfDay();
+    snap.minuteIndex[m>>5] |= (1UL << (m & 31));
+  }
+}
+
+void Scheduler::rebuildWindowIndex(ScheduleSnapshot& snap){
+  static uint16_t bounds[SCHED_MAX_SEGMENTS];
+  size_t n=0;
+  bounds[n++]=0;
+  for(size_t i=0;i<MAX_SCHEDULE_WINDOWS;i++){
+    const ScheduleWindow& w=snap.windows[i];
+    if (w.isEmpty()) continue;
+    for(uint8_t d=0;d<7;d++){
+      if (!(w.dayMask() & (1U<<d))) continue;
+      uint16_t start=(uint16_t)(d*SCHED_MINUTES_PER_DAY+w.startMinute());
+      uint16_t end=(uint16_t)(d*SCHED_MINUTES_PER_DAY+w.endMinute()+(w.wrapsMidnight()?SCHED_MINUTES_PER_DAY:0));
+      bounds[n++]=start;
+      bounds[n++]=(uint16_t)(end % SCHED_MINUTES_PER_WEEK);
     }
   }
-  xSemaphoreGive(_mutex);
+  // Insertion sort + dedupe: at most a few hundred values, edit path only.
+  for(size_t i=1;i<n;i++){
+    uint16_t v=bounds[i];
+    size_t j=i;
+    while (j>0 && bounds[j-1]>v){ bounds[j]=bounds[j-1]; j--; }
+    bounds[j]=v;
+  }
+  size_t u=0;
+  for(size_t i=0;i<n;i++){
+    if (u==0 || bounds[u-1]!=bounds[i]) bounds[u++]=bounds[i];
+  }
+
+  snap.segmentCount=0;
+  for(size_t i=0;i<u;i++){
+    uint16_t start=bounds[i];
+    uint16_t end=(i+1<u) ? bounds[i+1] : (uint16_t)SCHED_MINUTES_PER_WEEK;
+    uint8_t power=0;
+    for(size_t k=0;k<MAX_SCHEDULE_WINDOWS;k++){
+      const ScheduleWindow& w=snap.windows[k];
+      if (!w.isEmpty() && w.power()>power && w.covers(start)) power=w.power();
+    }
+    if (power==0) continue;
+    if (snap.segmentCount>0){
+      ScheduleSegment& last=snap.segments[snap.segmentCount-1];
+      if (last.end==start && last.power==power){ last.end=end; continue; }
+    }
+    snap.segments[snap.segmentCount++]=ScheduleSegment{start,end,power};
+  }
 }
 
-String Scheduler::buildSummary(){
-  String out;
-  if (!_mutex) return out;
-  if (xSemaphoreTake(_mutex,pdMS_TO_TICKS(200))!=pdTRUE) return out;
-  out += String("Global: ") + (_globalEnabled?"ENABLED":"DISABLED") + "\n";
+uint8_t Scheduler::windowPowerAt(const ScheduleSnapshot& snap,uint16_t minuteOfWeek){
+  // First segment starting after the minute; the candidate is the one before it.
+  size_t lo=0, hi=snap.segmentCount;
+  while (lo<hi){
+    size_t mid=(lo+hi)/2;
+    if (snap.segments[mid].start<=minuteOfWeek) lo=mid+1;
+    else hi=mid;
+  }
+  if (lo==0) return 0;
+  const ScheduleSegment& seg=snap.segments[lo-1];
+  return (minuteOfWeek<seg.end) ? seg.power : 0;
+}
+
+void Scheduler::PendingActions::push(ScheduleAction action,uint8_t power){
+  if (count==SCHED_MAX_PENDING_ACTIONS){
+    logInfo("[SCHED] Demasiadas acciones simultáneas, se conserva la última.");
+    count--;
+  }
+  items[count].action=action;
+  items[count].power=power;
+  count++;
+}
+
+void Scheduler::evaluateMinute(const ScheduleSnapshot& snap,uint16_t minuteOfWeek,uint32_t lateMin,PendingActions& out){
+  uint8_t dayBit=(uint8_t)(1U << (minuteOfWeek / SCHED_MINUTES_PER_DAY));
+  uint16_t mod=minuteOfWeek % SCHED_MINUTES_PER_DAY;
+  // Fast path: nothing active at this minute of day on any weekday.
+  if ((snap.minuteIndex[mod>>5] & (1UL << (mod & 31)))==0) return;
   for(size_t i=0;i<MAX_SCHEDULE_ENTRIES;i++){
-    const auto& e=_entries[i];
-    out += String("#")+i+" act="+(e.active?"1":"0")+" day="+(uint8_t)e.day+
-           " "+(e.hour<10?"0":"")+e.hour+":"+(e.minute<10?"0":"")+e.minute+
-           " power="+e.targetPower+"\n";
+    const ScheduleEntry& e=snap.entries[i];
+    if (!e.matches(dayBit,mod)) continue;
+    if (lateMin==0){
+      out.push(e.action(),e.targetPower());
+    } else if (lateMin<=e.graceMinutes()){
+      logf("[SCHED] #%u %02u:%02u disparada con %lu min de retraso.",
+           (unsigned)i,e.hour(),e.minute(),(unsigned long)lateMin);
+      out.push(e.action(),e.targetPower());
+    } else {
+      logf("[SCHED] #%u %02u:%02u perdida (%lu min, fuera de margen).",
+           (unsigned)i,e.hour(),e.minute(),(unsigned long)lateMin);
+    }
+  }
+}
+
+void Scheduler::evaluate(time_t now,bool stoveOn,void(*dispatch)(ScheduleAction,uint8_t)){
+  if (!_mutex) return;
+  if (now<SCHED_TIME_VALID_EPOCH) return;
+  uint32_t nowMin=(uint32_t)(now/60);
+  // After a cold boot nobody knows what happened while the device was off
+  // (the stove may have been started by hand since), so window edges in the
+  // catch-up are not replayed; the reconcile below still converges.
+  bool replayEdges=true;
+
+  if (_watermarkMin==0){
+    bool rtcValid=sRtcState.magic==RTC_STATE_MAGIC &&
+                  sRtcState.check==(sRtcState.watermarkMin ^ RTC_STATE_MAGIC) &&
+                  sRtcState.watermarkMin<=nowMin;
+    _watermarkMin=rtcValid ? sRtcState.watermarkMin : nowMin-SCHED_MAX_GRACE_MIN;
+    replayEdges=rtcValid;
   }
+  if (nowMin<_watermarkMin){
+    logInfo("[SCHED] Reloj retrocedió, marca de evaluación reiniciada.");
+    _watermarkMin=nowMin;
+  }
+  // A window edit is reconciled right away, even within the same minute
+  // (the scan below then covers no minutes and only reads "now").
+  if (nowMin==_watermarkMin && _windowsReconciled) return;
+
+  uint32_t from=_watermarkMin+1;
+  if (from<=nowMin && nowMin-from>SCHED_MAX_GRACE_MIN) from=nowMin-SCHED_MAX_GRACE_MIN;
+
+  PendingActions pending;
+  if (_globalEnabled){
+    time_t first=(time_t)from*60;
+    struct tm t;
+    localtime_r(&first,&t);
+    uint16_t mow=minuteOfWeek(t);
+    uint8_t slot;
+    const ScheduleSnapshot& snap=acquireSnapshot(slot);
+    bool windowEdge=false;
+    uint8_t prevPower=windowPowerAt(snap,(uint16_t)((mow+SCHED_MINUTES_PER_WEEK-1)%SCHED_MINUTES_PER_WEEK));
+    uint8_t power=prevPower;
+    uint32_t cronActive=0, cronFired=0;
+    for(size_t r=0;r<MAX_CRON_RULES;r++){
+      if (!snap.cron[r].isEmpty()) cronActive|=(1UL<<r);
+    }
+    for(uint32_t m=from;m<=nowMin;m++){
+      evaluateMinute(snap,mow,nowMin-m,pending);
+      if (cronActive && nowMin-m<=SCHED_DEFAULT_GRACE_MIN){
+        time_t at=(time_t)m*60;
+        struct tm lt;
+        localtime_r(&at,&lt);
+        uint8_t dayBit=(uint8_t)(1U << ((lt.tm_wday+6)%7));
+        for(size_t r=0;r<MAX_CRON_RULES;r++){
+          if ((cronActive>>r)&1 &&
+              snap.cron[r].matches((uint8_t)lt.tm_min,(uint8_t)lt.tm_hour,(uint8_t)lt.tm_mday,(uint8_t)(lt.tm_mon+1),dayBit))
+            cronFired|=(1UL<<r);
+        }
+      }
+      if (snap.segmentCount){
+        power=windowPowerAt(snap,mow);
+        // Like cron, an edge only acts within the default grace.
+        if (power!=prevPower && replayEdges && nowMin-m<=SCHED_DEFAULT_GRACE_MIN) windowEdge=true;
+        prevPower=power;
+      }
+      if (++mow>=SCHED_MINUTES_PER_WEEK) mow=0;
+    }
+    // A rule that matched several times during a catch-up is re-asserted once.
+    for(size_t r=0;r<MAX_CRON_RULES;r++){
+      if ((cronFired>>r)&1) pending.push((ScheduleAction)snap.cron[r].action,snap.cron[r].power);
+    }
+    PreheatRule preheat[MAX_PREHEAT_RULES];
+    memcpy(preheat,snap.preheat,sizeof(preheat));
+    releaseSnapshot(slot);
+
+    // The thermal model takes its own lock, so pre-heat runs unpinned.
+    evaluatePreheat(preheat,now,stoveOn,pending);
+
+    // Converge on the window state. At an edge, in either direction. After
+    // boot or an edit, towards "on"/the window power, and towards "off" only
+    // when the stove is burning because a window started it: a stove started
+    // by hand outside any window is left alone. Pushed last so it wins over
+    // point entries.
+    if (windowEdge || !_windowsReconciled){
+      if (power>0){
+        if (windowEdge || !stoveOn || power!=_windowPower) pending.push(SCHED_ACTION_START,power);
+      } else if (windowEdge || (stoveOn && _windowPower>0)){
+        pending.push(SCHED_ACTION_SHUTDOWN,0);
+      }
+      _windowPower=power;
+    }
+    _windowsReconciled=true;
+  }
+
+  // Advance the watermark before dispatching: a dispatch that blocks or
+  // re-enters the scheduler must not cause the same minutes to fire twice.
+  _watermarkMin=nowMin;
+  sRtcState.magic=RTC_STATE_MAGIC;
+  sRtcState.watermarkMin=nowMin;
+  sRtcState.check=nowMin ^ RTC_STATE_MAGIC;
+
+  for(uint8_t i=0;i<pending.count;i++){
+    dispatch(pending.items[i].action,pending.items[i].power);
+  }
+}
+
+void Scheduler::copyRules(ScheduleRules& out) const{
+  uint8_t slot;
+  const ScheduleSnapshot& snap=acquireSnapshot(slot);
+  memcpy(out.entries,snap.entries,sizeof(out.entries));
+  memcpy(out.windows,snap.windows,sizeof(out.windows));
+  memcpy(out.cron,snap.cron,sizeof(out.cron));
+  memcpy(out.preheat,snap.preheat,sizeof(out.preheat));
+  releaseSnapshot(slot);
+  out.enabled=_globalEnabled;
+}
+
+/**
+ * @brief Copy and format buffers of writeSummary()/exportTable(), owned by
+ *        the holder of _storeMutex
+ *
+ * About 1.3 KB: too much for TaskTerminal's stack next to printf and the
+ * serial driver.
+ */
+static struct {
+  ScheduleRules rules;
+  char line[128];
+  char expr[SCHED_CRON_TEXT_MAX];
+} sList;
+
+size_t Scheduler::writeSummary(Print& out){
+  if (!_mutex || !_storeMutex) return 0;
+  // One copy of the tables: the listing matches a single snapshot and no
+  // reader pin is held while the sink blocks (a save meanwhile waits, or
+  // gives up and retries on the next flush()).
+  xSemaphoreTake(_storeMutex,portMAX_DELAY);
+  ScheduleRules& rules=sList.rules;
+  char (&line)[sizeof(sList.line)]=sList.line;
+  char (&expr)[sizeof(sList.expr)]=sList.expr;
+  char days[8];
+  copyRules(rules);
+  size_t n=0;
+  snprintf(line,sizeof(line),"Global: %s\n",rules.enabled?"ENABLED":"DISABLED");
+  n+=out.print(line);
+  for(size_t i=0;i<MAX_SCHEDULE_ENTRIES;i++){
+    const ScheduleEntry& e=rules.entries[i];
+    if (e.isEmpty()) continue;
+    formatDayMask(e.dayMask(),days);
+    int len=snprintf(line,sizeof(line),"#%u act=%u days=%s %02u:%02u %s power=%u",
+                     (unsigned)i,e.active()?1U:0U,days,(unsigned)e.hour(),(unsigned)e.minute(),
+                     actionName(e.action()),(unsigned)e.targetPower());
+    if (e.graceMinutes() && len>0 && (size_t)len<sizeof(line))
+      snprintf(line+len,sizeof(line)-len," grace=%u",(unsigned)e.graceMinutes());
+    n+=out.print(line);
+    n+=out.print('\n');
+  }
+  for(size_t i=0;i<MAX_SCHEDULE_WINDOWS;i++){
+    const ScheduleWindow& w=rules.windows[i];
+    if (w.isEmpty()) continue;
+    formatDayMask(w.dayMask(),days);
+    snprintf(line,sizeof(line),"W#%u days=%s %02u:%02u-%02u:%02u power=%u\n",
+             (unsigned)i,days,w.startMinute()/60,w.startMinute()%60,
+             w.endMinute()/60,w.endMinute()%60,(unsigned)w.power());
+    n+=out.print(line);
+  }
+  for(size_t i=0;i<MAX_CRON_RULES;i++){
+    const CronRule& r=rules.cron[i];
+    if (r.isEmpty()) continue;
+    formatCron(r,expr,sizeof(expr));
+    snprintf(line,sizeof(line),"C#%u ",(unsigned)i);
+    n+=out.print(line);
+    n+=out.print(expr);
+    n+=out.print('\n');
+  }
+  for(size_t i=0;i<MAX_PREHEAT_RULES;i++){
+    const PreheatRule& r=rules.preheat[i];
+    if (r.isEmpty()) continue;
+    formatDayMask(r.dayMask(),days);
+    snprintf(line,sizeof(line),"P#%u days=%s %02u:%02u to=%.1fC power=%u\n",
+             (unsigned)i,days,r.minuteOfDay()/60,r.minuteOfDay()%60,r.targetTemp(),(unsigned)r.power());
+    n+=out.print(line);
+  }
+  xSemaphoreGive(_storeMutex);
+  return n;
+}
+
+size_t Scheduler::writeSummary(char* buf, size_t cap){
+  if (!buf || !cap) return 0;
+  BufferPrint sink(buf,cap);
+  writeSummary(sink);
+  size_t len=sink.length();
+  if (sink.overflowed() && cap>4){
+    // Mark the cut so a truncated UI widget is not mistaken for the full table
+    len=(len>cap-5) ? cap-5 : len;
+    memcpy(buf+len,"...\n",5);
+    len+=4;
+  }
+  return len;
+}
+
+size_t Scheduler::exportTable(Print& out, char sep){
+  if (!_mutex || !_storeMutex) return 0;
+  // Formatted from one copy like writeSummary(): the export is a single
+  // consistent table, and no snapshot pin is held while out blocks.
+  xSemaphoreTake(_storeMutex,portMAX_DELAY);
+  ScheduleRules& rules=sList.rules;
+  char (&line)[sizeof(sList.line)]=sList.line;
+  char (&expr)[sizeof(sList.expr)]=sList.expr;
+  copyRules(rules);
+  size_t n=0;
+  // A rule that cannot be written in full must not be exported cut short:
+  // importing the result would silently replace it with another rule.
+  for(size_t i=0;i<MAX_CRON_RULES;i++){
+    const CronRule& r=rules.cron[i];
+    if (!r.isEmpty() && !formatCron(r,expr,sizeof(expr))){
+      xSemaphoreGive(_storeMutex);
+      return 0;
+    }
+  }
+  snprintf(line,sizeof(line),"clear%cG %u",sep,rules.enabled?1U:0U);
+  n+=out.print(line);
+  for(size_t i=0;i<MAX_SCHEDULE_ENTRIES;i++){
+    const ScheduleEntry& e=rules.entries[i];
+    if (e.isEmpty()) continue;
+    snprintf(line,sizeof(line),"%cE %u %u 0x%02X %02u:%02u %s %u %u",sep,(unsigned)i,e.active()?1U:0U,
+             (unsigned)e.dayMask(),(unsigned)e.hour(),(unsigned)e.minute(),actionName(e.action()),
+             (unsigned)e.targetPower(),(unsigned)e.graceMinutes());
+    n+=out.print(line);
+  }
+  for(size_t i=0;i<MAX_SCHEDULE_WINDOWS;i++){
+    const ScheduleWindow& w=rules.windows[i];
+    if (w.isEmpty()) continue;
+    snprintf(line,sizeof(line),"%cW %u 0x%02X %02u:%02u %02u:%02u %u",sep,(unsigned)i,(unsigned)w.dayMask(),
+             w.startMinute()/60,w.startMinute()%60,w.endMinute()/60,w.endMinute()%60,(unsigned)w.power());
+    n+=out.print(line);
+  }
+  for(size_t i=0;i<MAX_CRON_RULES;i++){
+    const CronRule& r=rules.cron[i];
+    if (r.isEmpty()) continue;
+    formatCron(r,expr,sizeof(expr));
+    snprintf(line,sizeof(line),"%cC %u ",sep,(unsigned)i);
+    n+=out.print(line);
+    n+=out.print(expr);
+  }
+  for(size_t i=0;i<MAX_PREHEAT_RULES;i++){
+    const PreheatRule& r=rules.preheat[i];
+    if (r.isEmpty()) continue;
+    snprintf(line,sizeof(line),"%cP %u 0x%02X %02u:%02u %.1f %u",sep,(unsigned)i,(unsigned)r.dayMask(),
+             r.minuteOfDay()/60,r.minuteOfDay()%60,r.targetTemp(),(unsigned)r.power());
+    n+=out.print(line);
+  }
+  if (sep=='\n') n+=out.print('\n');
+  xSemaphoreGive(_storeMutex);
+  return n;
+}
+
+/** @brief Parse a slot index below limit; -1 if invalid */
+static int parseIndex(const char* tok, size_t limit){
+  if (!tok) return -1;
+  char* end=nullptr;
+  long v=strtol(tok,&end,10);
+  if (end==tok || *end || v<0 || v>=(long)limit) return -1;
+  return (int)v;
+}
+
+/** @brief Parse a power level 1-5; 0 if invalid */
+static uint8_t parsePower(const char* tok){
+  if (!tok) return 0;
+  char* end=nullptr;
+  long v=strtol(tok,&end,10);
+  return (end==tok || *end || v<1 || v>5) ? 0 : (uint8_t)v;
+}
+
+bool Scheduler::importRecord(ScheduleSnapshot& snap, char* rec, bool& enabled, uint8_t& touched, const char*& error){
+  char* save=nullptr;
+  char* kind=strtok_r(rec," \t",&save);
+  if (!kind){ error="vacío"; return false; }
+  if (strcasecmp(kind,"clear")==0){
+    memset(snap.entries,0,sizeof(snap.entries));
+    memset(snap.windows,0,sizeof(snap.windows));
+    memset(snap.cron,0,sizeof(snap.cron));
+    memset(snap.preheat,0,sizeof(snap.preheat));
+    touched|=TOUCH_WINDOWS|TOUCH_PREHEAT;
+    return true;
+  }
+  if (kind[1]){ error="tipo de registro"; return false; }
+  const char k=(char)toupper((unsigned char)kind[0]);
+  char* tok[8];
+  size_t n=0;
+  for(char* t=strtok_r(nullptr," \t",&save);t && n<8;){
+    tok[n++]=t;
+    // A cron expression keeps its spaces: after the index, take the rest whole.
+    t=strtok_r(nullptr,(k=='C') ? "" : " \t",&save);
+  }
+  if (k=='C' && n==2) while (isspace((unsigned char)*tok[1])) tok[1]++;
+  if (k=='G'){
+    if (n!=1 || (strcmp(tok[0],"0")!=0 && strcmp(tok[0],"1")!=0)){ error="G 0|1"; return false; }
+    enabled=tok[0][0]=='1';
+    return true;
+  }
+  const size_t limit=(k=='E') ? MAX_SCHEDULE_ENTRIES : (k=='W') ? MAX_SCHEDULE_WINDOWS
+                    : (k=='C') ? MAX_CRON_RULES : (k=='P') ? MAX_PREHEAT_RULES : 0;
+  if (!limit){ error="tipo de registro"; return false; }
+  int idx=parseIndex(n ? tok[0] : nullptr,limit);
+  if (idx<0){ error="índice"; return false; }
+  const bool clear=(n==2 && strcasecmp(tok[1],"clear")==0);
+  uint8_t mask=0;
+  uint16_t at=0, end=0;
+  switch(k){
+    case 'E': {
+      if (clear){ snap.entries[idx].raw=0; return true; }
+      if (n!=7){ error="E i act days HH:MM action power grace"; return false; }
+      ScheduleAction action;
+      uint8_t power=parsePower(tok[5]);
+      char* graceEnd=nullptr;
+      long grace=strtol(tok[6],&graceEnd,10);
+      if (strcmp(tok[1],"0")!=0 && strcmp(tok[1],"1")!=0){ error="act 0|1"; return false; }
+      if (!parseDayMask(tok[2],mask)){ error="días"; return false; }
+      if (!parseClock(tok[3],at)){ error="hora"; return false; }
+      if (!parseAction(tok[4],action)){ error="acción"; return false; }
+      if (!power){ error="potencia"; return false; }
+      if (graceEnd==tok[6] || *graceEnd || grace<0 || grace>SCHED_MAX_GRACE_MIN){ error="margen"; return false; }
+      snap.entries[idx]=ScheduleEntry::make(tok[1][0]=='1',mask,at/60,at%60,power,action,(uint8_t)grace);
+      return true;
+    }
+    case 'W': {
+      if (clear){ snap.windows[idx].raw=0; touched|=TOUCH_WINDOWS; return true; }
+      if (n!=5){ error="W i days HH:MM HH:MM power"; return false; }
+      if (!parseDayMask(tok[1],mask)){ error="días"; return false; }
+      if (!parseClock(tok[2],at) || !parseClock(tok[3],end) || at==end){ error="hora"; return false; }
+      uint8_t power=parsePower(tok[4]);
+      if (!power){ error="potencia"; return false; }
+      snap.windows[idx]=ScheduleWindow::make(mask,at,end,power);
+      touched|=TOUCH_WINDOWS;
+      return true;
+    }
+    case 'C': {
+      CronRule rule;
+      memset(&rule,0,sizeof(rule));
+      if (!clear && (n!=2 || !parseCron(tok[1],rule))){ error="cron"; return false; }
+      snap.cron[idx]=rule;
+      return true;
+    }
+    default: {  // 'P'
+      if (clear){ snap.preheat[idx].raw=0; touched|=TOUCH_PREHEAT; return true; }
+      if (n!=5){ error="P i days HH:MM temp power"; return false; }
+      if (!parseDayMask(tok[1],mask)){ error="días"; return false; }
+      if (!parseClock(tok[2],at)){ error="hora"; return false; }
+      char* tempEnd=nullptr;
+      float temp=strtof(tok[3],&tempEnd);
+      if (*tempEnd || !(temp>=5.0f && temp<=35.0f)){ error="temperatura"; return false; }
+      uint8_t power=parsePower(tok[4]);
+      if (!power){ error="potencia"; return false; }
+      snap.preheat[idx]=PreheatRule::make(mask,at,temp,power);
+      touched|=TOUCH_PREHEAT;
+      return true;
+    }
+  }
+}
+
+bool Scheduler::importTable(const char* text, ScheduleImportResult& res){
+  res.record=0;
+  res.applied=0;
+  res.error=nullptr;
+  if (!text){ res.error="vacío"; return false; }
+  if (!_mutex || xSemaphoreTake(_mutex, pdMS_TO_TICKS(200))!=pdTRUE){ res.error="ocupado"; return false; }
+  // Records are applied to the back buffer; on any error it is simply not
+  // published (the next beginEdit() copies the current snapshot over it).
+  ScheduleSnapshot& next=beginEdit();
+  bool enabled=_globalEnabled;
+  uint8_t touched=0;
+  uint16_t applied=0;
+  char rec[SCHED_CRON_TEXT_MAX+16];  // "C <i> " plus the longest rule
+  for(const char* p=text;*p;){
+    size_t len=strcspn(p,";\n");
+    const char* stop=p+len;
+    res.record++;
+    while (len && isspace((unsigned char)*p)){ p++; len--; }
+    while (len && isspace((unsigned char)p[len-1])) len--;
+    if (len>=sizeof(rec)){ res.error="registro largo"; xSemaphoreGive(_mutex); return false; }
+    if (len && *p!='#'){
+      memcpy(rec,p,len);
+      rec[len]=0;
+      if (!importRecord(next,rec,enabled,touched,res.error)){
+        xSemaphoreGive(_mutex);
+        return false;
+      }
+      applied++;
+    }
+    p=*stop ? stop+1 : stop;
+  }
+  if (!applied){
+    xSemaphoreGive(_mutex);
+    return true;
+  }
+  publishSnapshot(next);
+  _globalEnabled=enabled;
+  markDirty();
   xSemaphoreGive(_mutex);
-  return out;
-}
\ No newline at end of file
+  if (touched & TOUCH_WINDOWS) _windowsReconciled=false;
+  if (touched & TOUCH_PREHEAT) memset(_preheatDone,0,sizeof(_preheatDone));
+  res.applied=applied;
+  notifyChanged();
+  logf("[SCHED] Tabla importada: %u registros.",(unsigned)applied);
+  return true;
+}
+
+uint8_t Scheduler::windowIndexAt(const ScheduleSnapshot& snap,uint16_t minuteOfWeek,uint8_t power){
+  for(size_t i=0;i<MAX_SCHEDULE_WINDOWS;i++){
+    const ScheduleWindow& w=snap.windows[i];
+    if (!w.isEmpty() && w.power()==power && w.covers(minuteOfWeek)) return (uint8_t)i;
+  }
+  return 0xFF;
+}
+
+int16_t Scheduler::preheatLeadMinutes(const PreheatRule& rule){
+  if (rule.isEmpty()) return -1;
+  if (!_thermal || !_thermal->hasTemp()) return PREHEAT_FALLBACK_LEAD_MIN;
+  // Judged over the full look-ahead: evaluatePreheat() starts once the latest
+  // start is within PREHEAT_MARGIN_MIN, i.e. heating time + margin ahead.
+  const float horizon=(float)PREHEAT_MAX_LEAD_MIN;
+  if (_thermal->predictOff(horizon)>=rule.targetTemp()) return -1;
+  float latest=_thermal->latestStartMinutes(rule.targetTemp(),rule.power(),horizon);
+  float lead=horizon-latest+PREHEAT_MARGIN_MIN;
+  if (lead<0) lead=0;
+  if (lead>PREHEAT_MAX_LEAD_MIN) lead=PREHEAT_MAX_LEAD_MIN;
+  return (int16_t)lead;
+}
+
+size_t Scheduler::project(uint32_t& fromMin,uint32_t toMin,ScheduleEvent* out,size_t cap){
+  if (!_mutex || !out || !cap || fromMin>=toMin) return 0;
+  if (!_globalEnabled){ fromMin=toMin; return 0; }
+
+  // The thermal model takes its own lock, so leads are worked out unpinned.
+  int16_t lead[MAX_PREHEAT_RULES];
+  for(size_t i=0;i<MAX_PREHEAT_RULES;i++) lead[i]=preheatLeadMinutes(getPreheat(i));
+
+  time_t at=(time_t)fromMin*60;
+  struct tm lt;
+  localtime_r(&at,&lt);
+  uint16_t mow=minuteOfWeek(lt);
+  uint8_t slot;
+  const ScheduleSnapshot& snap=acquireSnapshot(slot);
+  uint16_t prevMow=(uint16_t)((mow+SCHED_MINUTES_PER_WEEK-1)%SCHED_MINUTES_PER_WEEK);
+  uint8_t prevPower=windowPowerAt(snap,prevMow);
+  size_t n=0;
+  uint32_t m=fromMin;
+  for(;m<toMin;m++){
+    const size_t mark=n;
+    bool full=false;
+    auto emit=[&](ScheduleAction action,uint8_t power,ScheduleSource source,uint8_t idx){
+      if (n==cap){ full=true; return; }
+      out[n++]={m,action,power,source,idx};
+    };
+    uint8_t dayBit=(uint8_t)(1U << (mow / SCHED_MINUTES_PER_DAY));
+    uint16_t mod=mow % SCHED_MINUTES_PER_DAY;
+    if (snap.minuteIndex[mod>>5] & (1UL << (mod & 31))){
+      for(size_t i=0;i<MAX_SCHEDULE_ENTRIES;i++){
+        const ScheduleEntry& e=snap.entries[i];
+        if (e.matches(dayBit,mod)) emit(e.action(),e.targetPower(),SCHED_SRC_ENTRY,(uint8_t)i);
+      }
+    }
+    uint8_t localDayBit=(uint8_t)(1U << ((lt.tm_wday+6)%7));
+    for(size_t r=0;r<MAX_CRON_RULES;r++){
+      const CronRule& c=snap.cron[r];
+      if (!c.isEmpty() &&
+          c.matches((uint8_t)lt.tm_min,(uint8_t)lt.tm_hour,(uint8_t)lt.tm_mday,(uint8_t)(lt.tm_mon+1),localDayBit))
+        emit((ScheduleAction)c.action,c.power,SCHED_SRC_CRON,(uint8_t)r);
+    }
+    for(size_t i=0;i<MAX_PREHEAT_RULES;i++){
+      const PreheatRule& r=snap.preheat[i];
+      if (lead[i]<0 || r.isEmpty()) continue;
+      uint16_t target=(uint16_t)((mow+lead[i])%SCHED_MINUTES_PER_WEEK);
+      if ((r.dayMask() & (1U << (target / SCHED_MINUTES_PER_DAY))) &&
+          target % SCHED_MINUTES_PER_DAY==r.minuteOfDay())
+        emit(SCHED_ACTION_START,r.power(),SCHED_SRC_PREHEAT,(uint8_t)i);
+    }
+    if (snap.segmentCount || prevPower){
+      uint8_t power=windowPowerAt(snap,mow);
+      if (power!=prevPower){
+        uint8_t idx=power ? windowIndexAt(snap,mow,power) : windowIndexAt(snap,prevMow,prevPower);
+        emit(power ? SCHED_ACTION_START : SCHED_ACTION_SHUTDOWN,power,SCHED_SRC_WINDOW,idx);
+      }
+      prevPower=power;
+    }
+    if (full){
+      // Keep minutes whole; a single minute larger than out is cut instead.
+      if (mark){ n=mark; break; }
+      m++;
+      break;
+    }
+    // Broken-down time is refreshed every hour so DST changes are followed.
+    at+=60;
+    if (lt.tm_min==59) localtime_r(&at,&lt);
+    else lt.tm_min++;
+    prevMow=mow;
+    mow=minuteOfWeek(lt);
+  }
+  releaseSnapshot(slot);
+  fromMin=m;
+  return n;
+}
+
+static bool isLeapYear(int year){
+  return (year%4==0 && year%100!=0) || year%400==0;
+}
+
+static uint8_t daysInMonth(int year,int month){
+  static const uint8_t days[12]={31,28,31,30,31,30,31,31,30,31,30,31};
+  return (month==1 && isLeapYear(year)) ? 29 : days[month];
+}
+
+uint32_t Scheduler::cronMinutesUntil(const CronRule& rule,const struct tm& from){
+  if (rule.isEmpty()) return 0;
+  int year=from.tm_year+1900, month=from.tm_mon, mday=from.tm_mday, wday=from.tm_wday;
+  const uint32_t fromMod=(uint32_t)(from.tm_hour*60+from.tm_min);
+  for(uint32_t day=0;day<=366;day++){
+    uint8_t dayBit=(uint8_t)(1U << ((wday+6)%7));
+    if ((rule.months>>(month+1)) & 1){
+      bool domHit=(rule.daysOfMonth>>mday) & 1;
+      bool dowHit=(rule.dayMask & dayBit)!=0;
+      bool dayOk=(rule.flags & (CRON_FLAG_DOM_STAR|CRON_FLAG_DOW_STAR)) ? (domHit && dowHit) : (domHit || dowHit);
+      if (dayOk){
+        uint32_t first=(day==0) ? fromMod+1 : 0;
+        for(uint32_t h=first/60;h<24;h++){
+          if (!((rule.hours>>h) & 1)) continue;
+          uint32_t m0=(h==first/60) ? first%60 : 0;
+          uint64_t left=rule.minutes>>m0;
+          if (!left) continue;
+          uint32_t m=m0+(uint32_t)__builtin_ctzll(left);
+          return day*SCHED_MINUTES_PER_DAY+h*60+m-fromMod;
+        }
+      }
+    }
+    wday=(wday+1)%7;
+    if (++mday>daysInMonth(year,month)){
+      mday=1;
+      if (++month==12){ month=0; year++; }
+    }
+  }
+  return 0;
+}
+
+uint32_t Scheduler::tableMinutesUntil(const ScheduleSnapshot& snap,uint16_t minuteOfWeek){
+  uint32_t best=0;
+  // Entries: next occupied minute of day (the day mask is checked at evaluation).
+  uint16_t mod=minuteOfWeek % SCHED_MINUTES_PER_DAY;
+  for(uint32_t k=1;k<=SCHED_MINUTES_PER_DAY;k++){
+    uint16_t m=(uint16_t)((mod+k)%SCHED_MINUTES_PER_DAY);
+    uint32_t word=snap.minuteIndex[m>>5];
+    if (word==0 && (m & 31)==0 && k+31<=SCHED_MINUTES_PER_DAY){ k+=31; continue; }
+    if (word & (1UL << (m & 31))){ best=k; break; }
+  }
+  // Windows: next segment start after now, or the end of the current segment.
+  if (snap.segmentCount){
+    size_t lo=0, hi=snap.segmentCount;
+    while (lo<hi){
+      size_t mid=(lo+hi)/2;
+      if (snap.segments[mid].start<=minuteOfWeek) lo=mid+1;
+      else hi=mid;
+    }
+    uint32_t edge=(lo<snap.segmentCount) ? (uint32_t)(snap.segments[lo].start-minuteOfWeek)
+                                         : (uint32_t)(snap.segments[0].start+SCHED_MINUTES_PER_WEEK-minuteOfWeek);
+    if (lo>0 && snap.segments[lo-1].end>minuteOfWeek){
+      uint32_t toEnd=(uint32_t)(snap.segments[lo-1].end-minuteOfWeek);
+      if (toEnd<edge) edge=toEnd;
+    }
+    if (best==0 || edge<best) best=edge;
+  }
+  return best;
+}
+
+uint32_t Scheduler::nextWakeDelayMs(time_t now,uint32_t nowMs){
+  uint32_t delayMs=SCHED_MAX_SLEEP_MS;
+  if (_dirty){
+    uint32_t sinceEdit=nowMs-_lastEditMs, sinceFirst=nowMs-_firstDirtyMs;
+    uint32_t a=(sinceEdit<SCHED_PERSIST_DEBOUNCE_MS) ? SCHED_PERSIST_DEBOUNCE_MS-sinceEdit : 0;
+    uint32_t b=(sinceFirst<SCHED_PERSIST_MAX_DELAY_MS) ? SCHED_PERSIST_MAX_DELAY_MS-sinceFirst : 0;
+    uint32_t due=(a<b) ? a : b;
+    if (due<delayMs) delayMs=due;
+  }
+  if (!_mutex || now<SCHED_TIME_VALID_EPOCH){
+    return (delayMs<SCHED_CLOCK_POLL_MS) ? delayMs : SCHED_CLOCK_POLL_MS;
+  }
+
+  struct tm t;
+  localtime_r(&now,&t);
+  uint8_t slot;
+  const ScheduleSnapshot& snap=acquireSnapshot(slot);
+  uint32_t minutes=tableMinutesUntil(snap,minuteOfWeek(t));
+  for(size_t r=0;r<MAX_CRON_RULES;r++){
+    uint32_t m=cronMinutesUntil(snap.cron[r],t);
+    if (m && (minutes==0 || m<minutes)) minutes=m;
+  }
+  releaseSnapshot(slot);
+
+  if (minutes){
+    uint32_t ms=(minutes*60UL-(uint32_t)t.tm_sec)*1000UL;
+    if (ms<delayMs) delayMs=ms;
+  }
+  return delayMs ? delayMs : 1;
+}
+
+uint16_t Scheduler::minuteOfWeek(const struct tm& t){
+  uint16_t dayIdx=(uint16_t)((t.tm_wday+6)%7);
+  return (uint16_t)(dayIdx*SCHED_MINUTES_PER_DAY + t.tm_hour*60 + t.tm_min);
+}
+
+static int dayIndexFromToken(const char* s, size_t len){
+  static const char* const names[7]={"mon","tue","wed","thu","fri","sat","sun"};
+  if (len==1 && s[0]>='0' && s[0]<='7'){
+    return (s[0]=='0') ? 6 : (s[0]-'1');
+  }
+  if (len==3){
+    for(int i=0;i<7;i++){
+      if (strncasecmp(s,names[i],3)==0) return i;
+    }
+  }
+  return -1;
+}
+
+bool Scheduler::parseDayMask(const char* spec, uint8_t& out){
+  if (!spec || !*spec) return false;
+  if (strcasecmp(spec,"all")==0 || strcasecmp(spec,"daily")==0){ out=DM_ALL; return true; }
+  if (strcasecmp(spec,"weekdays")==0 || strcasecmp(spec,"wd")==0){ out=DM_WEEKDAYS; return true; }
+  if (strcasecmp(spec,"weekend")==0 || strcasecmp(spec,"we")==0){ out=DM_WEEKEND; return true; }
+  if (spec[0]=='0' && (spec[1]=='x' || spec[1]=='X')){
+    char* end=nullptr;
+    long v=strtol(spec,&end,16);
+    if (*end || v<1 || v>DM_ALL) return false;
+    out=(uint8_t)v;
+    return true;
+  }
+  uint8_t mask=0;
+  const char* p=spec;
+  while (*p){
+    const char* tokEnd=p;
+    while (*tokEnd && *tokEnd!=',') tokEnd++;
+    const char* dash=p;
+    while (dash<tokEnd && *dash!='-') dash++;
+    int from=dayIndexFromToken(p,(size_t)(dash-p));
+    int to=from;
+    if (dash<tokEnd) to=dayIndexFromToken(dash+1,(size_t)(tokEnd-dash-1));
+    if (from<0 || to<0) return false;
+    for(int d=from;;d=(d+1)%7){
+      mask |= (uint8_t)(1U << d);
+      if (d==to) break;
+    }
+    p=(*tokEnd==',') ? tokEnd+1 : tokEnd;
+  }
+  if (mask==0) return false;
+  out=mask;
+  return true;
+}
+
+static bool parseCronValue(const char*& p, bool dow, int& out){
+  if (*p>='0' && *p<='9'){
+    char* end=nullptr;
+    out=(int)strtol(p,&end,10);
+    p=end;
+    return true;
+  }
+  if (!dow) return false;
+  static const char* const names[7]={"sun","mon","tue","wed","thu","fri","sat"};
+  for(int i=0;i<7;i++){
+    if (strncasecmp(p,names[i],3)==0){ out=i; p+=3; return true; }
+  }
+  return false;
+}
+
+/** @brief Compile one cron field ("*", "a", "a-b", lists and "/step") into a bitset */
+static bool parseCronField(const char* p, int lo, int hi, bool dow, uint64_t& bits){
+  bits=0;
+  while (*p){
+    int from=lo, to=hi, step=1;
+    if (*p=='*'){
+      p++;
+    } else {
+      if (!parseCronValue(p,dow,from)) return false;
+      to=from;
+      if (*p=='-'){
+        p++;
+        if (!parseCronValue(p,dow,to)) return false;
+      } else if (*p=='/'){
+        to=hi;  // "a/n" = from a to the end of the range
+      }
+    }
+    if (*p=='/'){
+      p++;
+      char* end=nullptr;
+      step=(int)strtol(p,&end,10);
+      if (end==p || step<1) return false;
+      p=end;
+    }
+    if (from<lo || to>hi || from>to) return false;
+    for(int v=from;v<=to;v+=step) bits|=(1ULL<<v);
+    if (*p==','){ p++; if (!*p) return false; }
+    else if (*p) return false;
+  }
+  return bits!=0;
+}
+
+bool Scheduler::parseCron(const char* text, CronRule& out){
+  if (!text) return false;
+  char buf[SCHED_CRON_TEXT_MAX];
+  size_t len=strlen(text);
+  if (len>=sizeof(buf)) return false;
+  memcpy(buf,text,len+1);
+  char* tok[8];
+  size_t n=0;
+  char* save=nullptr;
+  for(char* t=strtok_r(buf," \t",&save);t && n<8;t=strtok_r(nullptr," \t",&save)) tok[n++]=t;
+  if (n<6 || n>7) return false;
+
+  CronRule r;
+  memset(&r,0,sizeof(r));
+  uint64_t bits;
+  if (!parseCronField(tok[0],0,59,false,bits)) return false;
+  r.minutes=bits;
+  if (!parseCronField(tok[1],0,23,false,bits)) return false;
+  r.hours=(uint32_t)bits;
+  if (!parseCronField(tok[2],1,31,false,bits)) return false;
+  r.daysOfMonth=(uint32_t)bits;
+  if (!parseCronField(tok[3],1,12,false,bits)) return false;
+  r.months=(uint16_t)bits;
+  if (!parseCronField(tok[4],0,7,true,bits)) return false;
+  // Cron numbering (0/7 = Sunday, 1 = Monday) to DayMask (bit 0 = Monday).
+  r.dayMask=(uint8_t)(((bits>>1) & 0x3F) | ((bits & 0x81) ? DM_SUN : 0));
+  if (tok[2][0]=='*') r.flags|=CRON_FLAG_DOM_STAR;
+  if (tok[4][0]=='*') r.flags|=CRON_FLAG_DOW_STAR;
+
+  ScheduleAction action;
+  if (!parseAction(tok[5],action)) return false;
+  r.action=action;
+  if (action==SCHED_ACTION_SHUTDOWN){
+    if (n!=6) return false;
+  } else {
+    if (n!=7) return false;
+    char* end=nullptr;
+    long p=strtol(tok[6],&end,10);
+    if (end==tok[6] || *end || p<1 || p>5) return false;
+    r.power=(uint8_t)p;
+  }
+  out=r;
+  return true;
+}
+
+/** @brief Bitset of lo, lo+step, ... up to hi */
+static uint64_t cronSequence(int lo, int hi, int step){
+  uint64_t seq=0;
+  for(int v=lo;v<=hi;v+=step) seq|=(1ULL<<v);
+  return seq;
+}
+
+/** @brief Append formatted text; false (and len = cap) once it no longer fits */
+static bool cronAppend(char* out, size_t cap, size_t& len, const char* fmt, ...){
+  if (len>=cap) return false;
+  va_list ap;
+  va_start(ap,fmt);
+  int n=vsnprintf(out+len,cap-len,fmt,ap);
+  va_end(ap);
+  if (n<0 || (size_t)n>=cap-len){ len=cap; return false; }
+  len+=(size_t)n;
+  return true;
+}
+
+/**
+ * @brief Write a cron bitset as comma-separated values, "a-b" and "a-b/n" runs
+ * @param sep Whether a comma goes before the first item
+ *
+ * Greedy: from the lowest value left, take the longest arithmetic run
+ * through the remaining values. A run is never longer than listing its
+ * values, so the output never exceeds the plain comma-separated list.
+ */
+static bool formatCronList(uint64_t bits, int lo, int hi, bool sep, char* out, size_t cap, size_t& len){
+  for(int v=lo;v<=hi;v++){
+    if (!((bits>>v) & 1)) continue;
+    int bestStep=1, bestCount=1;
+    for(int step=1;v+step<=hi;step++){
+      int count=1;
+      while (v+count*step<=hi && ((bits>>(v+count*step)) & 1)) count++;
+      if (count>bestCount){ bestCount=count; bestStep=step; }
+    }
+    const char* comma=sep ? "," : "";
+    sep=true;
+    bool ok;
+    int last=v+(bestCount-1)*bestStep;
+    if (bestCount>=3 && bestStep>1) ok=cronAppend(out,cap,len,"%s%d-%d/%d",comma,v,last,bestStep);
+    else if (bestCount>=2 && bestStep==1) ok=cronAppend(out,cap,len,"%s%d-%d",comma,v,last);
+    else { bestCount=1; ok=cronAppend(out,cap,len,"%s%d",comma,v); }
+    if (!ok) return false;
+    for(int i=0;i<bestCount;i++) bits&=~(1ULL<<(v+i*bestStep));
+  }
+  return true;
+}
+
+/**
+ * @brief Write one cron field
+ * @param star Field must start with "*": a day field whose text did, where
+ *        dropping the "*" would change the dom/dow OR rule when parsed
+ *        back. Written as "*", or "*\/n" followed by any extra values.
+ * @param allowStar Other fields may use "*" or "*\/n" when that is exact
+ */
+static bool formatCronField(uint64_t bits, int lo, int hi, bool star, bool allowStar, char* out, size_t cap, size_t& len){
+  uint64_t full=cronSequence(lo,hi,1);
+  if ((star || allowStar) && bits==full) return cronAppend(out,cap,len,"*");
+  if (star){
+    // Smallest step whose "*\/n" values are all set; lo is always one of
+    // them, so some step up to the field width fits.
+    for(int step=2;step<=hi-lo+1;step++){
+      uint64_t seq=cronSequence(lo,hi,step);
+      if ((bits & seq)!=seq) continue;
+      if (!cronAppend(out,cap,len,"*/%d",step)) return false;
+      return formatCronList(bits & ~seq,lo,hi,true,out,cap,len);
+    }
+  } else if (allowStar){
+    for(int step=2;step<=(hi-lo)/2+1;step++){
+      if (cronSequence(lo,hi,step)==bits) return cronAppend(out,cap,len,"*/%d",step);
+    }
+  }
+  return formatCronList(bits,lo,hi,false,out,cap,len);
+}
+
+bool Scheduler::formatCron(const CronRule& rule, char* out, size_t cap){
+  if (!out || cap==0) return false;
+  out[0]=0;
+  uint64_t dow=((uint64_t)(rule.dayMask & 0x3F)<<1) | ((rule.dayMask & DM_SUN) ? 1 : 0);
+  size_t len=0;
+  bool ok=formatCronField(rule.minutes,0,59,false,true,out,cap,len) &&
+          cronAppend(out,cap,len," ") &&
+          formatCronField(rule.hours,0,23,false,true,out,cap,len) &&
+          cronAppend(out,cap,len," ") &&
+          formatCronField(rule.daysOfMonth,1,31,(rule.flags & CRON_FLAG_DOM_STAR)!=0,false,out,cap,len) &&
+          cronAppend(out,cap,len," ") &&
+          formatCronField(rule.months,1,12,false,true,out,cap,len) &&
+          cronAppend(out,cap,len," ") &&
+          formatCronField(dow,0,6,(rule.flags & CRON_FLAG_DOW_STAR)!=0,false,out,cap,len) &&
+          cronAppend(out,cap,len," %s",actionName((ScheduleAction)rule.action));
+  if (ok && rule.action!=SCHED_ACTION_SHUTDOWN) ok=cronAppend(out,cap,len," %u",(unsigned)rule.power);
+  return ok;
+}
+
+void Scheduler::formatDayMask(uint8_t mask, char* out){
+  static const char letters[8]="MTWTFSS";
+  for(int i=0;i<7;i++) out[i]=(mask & (1U<<i)) ? letters[i] : '-';
+  out[7]=0;
+}
+
+bool Scheduler::parseClock(const char* text, uint16_t& out){
+  if (!text || !*text) return false;
+  unsigned h=0, m=0;
+  const char* colon=strchr(text,':');
+  char* end=nullptr;
+  if (colon){
+    h=(unsigned)strtoul(text,&end,10);
+    if (end!=colon) return false;
+    m=(unsigned)strtoul(colon+1,&end,10);
+    if (*end || end==colon+1) return false;
+  } else {
+    if (strlen(text)!=4) return false;
+    unsigned v=(unsigned)strtoul(text,&end,10);
+    if (*end) return false;
+    h=v/100; m=v%100;
+  }
+  if (h>23 || m>59) return false;
+  out=(uint16_t)(h*60+m);
+  return true;
+}
+
+const char* Scheduler::actionName(ScheduleAction action){
+  switch(action){
+    case SCHED_ACTION_START: return "start";
+    case SCHED_ACTION_POWER: return "power";
+    case SCHED_ACTION_SHUTDOWN: return "off";
+    default: return "?";
+  }
+}
+
+bool Scheduler::parseAction(const char* name, ScheduleAction& out){
+  if (strcasecmp(name,"start")==0 || strcasecmp(name,"on")==0){ out=SCHED_ACTION_START; return true; }
+  if (strcasecmp(name,"power")==0){ out=SCHED_ACTION_POWER; return true; }
+  if (strcasecmp(name,"off")==0 || strcasecmp(name,"shutdown")==0){ out=SCHED_ACTION_SHUTDOWN; return true; }
+  return false;
+}
@@ -1,18 +1,28 @@
 /**
  * @file Scheduler.h
  * @brief Weekly schedule management for automatic stove control
- * 
+ *
  * Manages up to MAX_SCHEDULE_ENTRIES timed events that can automatically
- * start the stove and set power levels based on day of week and time.
+ * start the stove, change power or shut it down based on a set of weekdays
+ * and a time of day, plus up to MAX_SCHEDULE_WINDOWS on/off windows that
+ * describe when the stove should be running and at which power, up to
+ * MAX_CRON_RULES cron-style rules for recurring patterns, and up to
+ * MAX_PREHEAT_RULES "warm by HH:MM to T °C" rules driven by ThermalModel.
+ * Entries are packed into 32 bits so large tables stay small, and matching
+ * uses bitwise operations only. The table is persisted in NVS (see
+ * ScheduleStore) and restored at boot.
  * Thread-safe for use with FreeRTOS tasks.
  */
 
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <freertos/task.h>
 #include "Config.h"
+#include "ScheduleStore.h"
 
 // ============================================================================
 // ENUMERATIONS
@@ -21,7 +31,7 @@
 /**
  * @enum Weekday
  * @brief Days of the week enumeration
- * 
+ *
  * Values align with common calendar standards (Monday = 1, Sunday = 7).
  */
 enum Weekday : uint8_t {
@@ -34,22 +44,372 @@ enum Weekday : uint8_t {
   WD_SUN = 7   ///< Sunday
 };
 
+/**
+ * @enum DayMask
+ * @brief 7-bit day selection masks (bit 0 = Monday ... bit 6 = Sunday)
+ *
+ * The bit for a Weekday value d is (1 << (d - 1)).
+ */
+enum DayMask : uint8_t {
+  DM_MON      = 0x01,  ///< Monday
+  DM_TUE      = 0x02,  ///< Tuesday
+  DM_WED      = 0x04,  ///< Wednesday
+  DM_THU      = 0x08,  ///< Thursday
+  DM_FRI      = 0x10,  ///< Friday
+  DM_SAT      = 0x20,  ///< Saturday
+  DM_SUN      = 0x40,  ///< Sunday
+  DM_WEEKDAYS = 0x1F,  ///< Monday to Friday
+  DM_WEEKEND  = 0x60,  ///< Saturday and Sunday
+  DM_ALL      = 0x7F   ///< Every day
+};
+
+/**
+ * @enum ScheduleAction
+ * @brief Action performed when a schedule entry fires
+ */
+enum ScheduleAction : uint8_t {
+  SCHED_ACTION_START    = 0,  ///< Start the stove and set target power
+  SCHED_ACTION_POWER    = 1,  ///< Set target power (only while running)
+  SCHED_ACTION_SHUTDOWN = 2   ///< Request a (safety-checked) shutdown
+};
+
+// ============================================================================
+// PACKED ENTRY LAYOUT
+// ============================================================================
+
+/** @brief Minutes in one day */
+#define SCHED_MINUTES_PER_DAY   1440
+
+/** @brief Minutes in one week (minute-of-week range is 0..SCHED_MINUTES_PER_WEEK-1) */
+#define SCHED_MINUTES_PER_WEEK  (7 * SCHED_MINUTES_PER_DAY)
+
+#define SCHED_DAYS_SHIFT     0           ///< Bits 0-6: day mask
+#define SCHED_DAYS_MASK      0x0000007FUL
+#define SCHED_MINUTE_SHIFT   7           ///< Bits 7-17: minute of day (0-1439)
+#define SCHED_MINUTE_MASK    0x0003FF80UL
+#define SCHED_POWER_SHIFT    18          ///< Bits 18-20: target power (1-5)
+#define SCHED_POWER_MASK     0x001C0000UL
+#define SCHED_ACTION_SHIFT   21          ///< Bits 21-22: ScheduleAction
+#define SCHED_ACTION_MASK    0x00600000UL
+#define SCHED_GRACE_SHIFT    23          ///< Bits 23-26: late-fire grace in SCHED_GRACE_UNIT_MIN units
+#define SCHED_GRACE_MASK     0x07800000UL
+#define SCHED_ACTIVE_BIT     0x80000000UL ///< Bit 31: entry enabled
+
+/** @brief Granularity of the per-entry grace window (minutes) */
+#define SCHED_GRACE_UNIT_MIN 10
+
+/** @brief Largest grace window an entry can carry (minutes) */
+#define SCHED_MAX_GRACE_MIN  (15 * SCHED_GRACE_UNIT_MIN)
+
+/**
+ * @brief Actions one evaluate() call can collect before dispatching
+ *
+ * When more entries fire in a single call, the last slot is overwritten so
+ * the most recent action still wins.
+ */
+#define SCHED_MAX_PENDING_ACTIONS 8
+
 // ============================================================================
 // DATA STRUCTURES
 // ============================================================================
 
 /**
  * @struct ScheduleEntry
- * @brief Single schedule entry configuration
- * 
- * Represents a timed event that triggers stove power control.
+ * @brief Single schedule entry packed into 32 bits
+ *
+ * Represents a timed event on one or more weekdays. The all-zero value is an
+ * empty (unused) slot. See the SCHED_* layout constants for the bit layout.
  */
 struct ScheduleEntry {
-  bool active;          ///< Whether this entry is enabled
-  Weekday day;          ///< Day of week when this entry triggers
-  uint8_t hour;         ///< Hour of day (0-23)
-  uint8_t minute;       ///< Minute of hour (0-59)
-  uint8_t targetPower;  ///< Target power level (1-5)
+  uint32_t raw;  ///< Packed entry fields
+
+  bool active() const { return (raw & SCHED_ACTIVE_BIT) != 0; }
+  uint8_t dayMask() const { return (uint8_t)((raw & SCHED_DAYS_MASK) >> SCHED_DAYS_SHIFT); }
+  uint16_t minuteOfDay() const { return (uint16_t)((raw & SCHED_MINUTE_MASK) >> SCHED_MINUTE_SHIFT); }
+  uint8_t hour() const { return (uint8_t)(minuteOfDay() / 60); }
+  uint8_t minute() const { return (uint8_t)(minuteOfDay() % 60); }
+  uint8_t targetPower() const { return (uint8_t)((raw & SCHED_POWER_MASK) >> SCHED_POWER_SHIFT); }
+  ScheduleAction action() const { return (ScheduleAction)((raw & SCHED_ACTION_MASK) >> SCHED_ACTION_SHIFT); }
+  uint8_t graceMinutes() const { return (uint8_t)(((raw & SCHED_GRACE_MASK) >> SCHED_GRACE_SHIFT) * SCHED_GRACE_UNIT_MIN); }
+  bool isEmpty() const { return dayMask() == 0; }
+
+  /**
+   * @brief Check whether the entry fires at a given day and minute
+   * @param dayBit Single DayMask bit of the day being evaluated
+   * @param minuteOfDay Minute of day being evaluated (0-1439)
+   * @return true if the entry is active, on that day and at that minute
+   */
+  bool matches(uint8_t dayBit, uint16_t minuteOfDay) const {
+    const uint32_t key = SCHED_ACTIVE_BIT | ((uint32_t)minuteOfDay << SCHED_MINUTE_SHIFT);
+    return (raw & (SCHED_ACTIVE_BIT | SCHED_MINUTE_MASK)) == key && (raw & dayBit) != 0;
+  }
+
+  /**
+   * @brief Build a packed entry from its fields (no range checking)
+   * @param graceMin Late-fire window in minutes; rounded up to
+   *        SCHED_GRACE_UNIT_MIN and capped at SCHED_MAX_GRACE_MIN.
+   *        0 means a missed occurrence is skipped.
+   */
+  static ScheduleEntry make(bool active, uint8_t dayMask, uint8_t hour, uint8_t minute,
+                            uint8_t power, ScheduleAction action, uint8_t graceMin = 0) {
+    uint32_t graceUnits = (graceMin + SCHED_GRACE_UNIT_MIN - 1) / SCHED_GRACE_UNIT_MIN;
+    if (graceUnits > 15) graceUnits = 15;
+    ScheduleEntry e;
+    e.raw = ((uint32_t)(dayMask & 0x7F) << SCHED_DAYS_SHIFT)
+          | ((uint32_t)(hour * 60 + minute) << SCHED_MINUTE_SHIFT)
+          | ((uint32_t)(power & 0x07) << SCHED_POWER_SHIFT)
+          | ((uint32_t)(action & 0x03) << SCHED_ACTION_SHIFT)
+          | (graceUnits << SCHED_GRACE_SHIFT)
+          | (active ? SCHED_ACTIVE_BIT : 0);
+    return e;
+  }
+};
+
+static_assert(sizeof(ScheduleEntry) == 4, "ScheduleEntry must stay packed in 32 bits");
+
+// ============================================================================
+// PACKED WINDOW LAYOUT
+// ============================================================================
+
+#define SCHED_WIN_DAYS_SHIFT   0           ///< Bits 0-6: day mask (days the window starts on)
+#define SCHED_WIN_DAYS_MASK    0x0000007FUL
+#define SCHED_WIN_START_SHIFT  7           ///< Bits 7-17: start minute of day (0-1439)
+#define SCHED_WIN_START_MASK   0x0003FF80UL
+#define SCHED_WIN_END_SHIFT    18          ///< Bits 18-28: end minute of day (0-1439, exclusive)
+#define SCHED_WIN_END_MASK     0x1FFC0000UL
+#define SCHED_WIN_POWER_SHIFT  29          ///< Bits 29-31: power level (1-5)
+#define SCHED_WIN_POWER_MASK   0xE0000000UL
+
+/** @brief Capacity of the flattened window index */
+#define SCHED_MAX_SEGMENTS     (MAX_SCHEDULE_WINDOWS * 14 + 1)
+
+/**
+ * @struct ScheduleWindow
+ * @brief On/off window packed into 32 bits
+ *
+ * The stove should run at power() from startMinute() to endMinute() on each
+ * day in dayMask(). A window whose end is not after its start runs past
+ * midnight into the next day. The all-zero value is an empty slot.
+ */
+struct ScheduleWindow {
+  uint32_t raw;  ///< Packed window fields
+
+  uint8_t dayMask() const { return (uint8_t)((raw & SCHED_WIN_DAYS_MASK) >> SCHED_WIN_DAYS_SHIFT); }
+  uint16_t startMinute() const { return (uint16_t)((raw & SCHED_WIN_START_MASK) >> SCHED_WIN_START_SHIFT); }
+  uint16_t endMinute() const { return (uint16_t)((raw & SCHED_WIN_END_MASK) >> SCHED_WIN_END_SHIFT); }
+  uint8_t power() const { return (uint8_t)((raw & SCHED_WIN_POWER_MASK) >> SCHED_WIN_POWER_SHIFT); }
+  bool isEmpty() const { return dayMask() == 0; }
+  bool wrapsMidnight() const { return endMinute() <= startMinute(); }
+
+  /**
+   * @brief Check whether the window covers a minute of week
+   * @param minuteOfWeek Minute to test (0 = Monday 00:00)
+   */
+  bool covers(uint16_t minuteOfWeek) const {
+    uint8_t day = (uint8_t)(minuteOfWeek / SCHED_MINUTES_PER_DAY);
+    uint16_t mod = minuteOfWeek % SCHED_MINUTES_PER_DAY;
+    uint8_t dayBit = (uint8_t)(1U << day);
+    uint8_t prevBit = (uint8_t)(1U << ((day + 6) % 7));
+    if (!wrapsMidnight()) return (dayMask() & dayBit) && mod >= startMinute() && mod < endMinute();
+    return ((dayMask() & dayBit) && mod >= startMinute()) || ((dayMask() & prevBit) && mod < endMinute());
+  }
+
+  /** @brief Build a packed window from its fields (no range checking) */
+  static ScheduleWindow make(uint8_t dayMask, uint16_t startMin, uint16_t endMin, uint8_t power) {
+    ScheduleWindow w;
+    w.raw = ((uint32_t)(dayMask & 0x7F) << SCHED_WIN_DAYS_SHIFT)
+          | ((uint32_t)(startMin & 0x7FF) << SCHED_WIN_START_SHIFT)
+          | ((uint32_t)(endMin & 0x7FF) << SCHED_WIN_END_SHIFT)
+          | ((uint32_t)(power & 0x07) << SCHED_WIN_POWER_SHIFT);
+    return w;
+  }
+};
+
+static_assert(sizeof(ScheduleWindow) == 4, "ScheduleWindow must stay packed in 32 bits");
+
+/**
+ * @struct ScheduleSegment
+ * @brief Half-open minute-of-week range with a single desired power
+ */
+struct ScheduleSegment {
+  uint16_t start;  ///< First minute of week covered
+  uint16_t end;    ///< One past the last minute covered
+  uint8_t power;   ///< Desired power (1-5)
+};
+
+// ============================================================================
+// CRON RULES
+// ============================================================================
+
+#define CRON_FLAG_DOM_STAR  0x01  ///< Day-of-month field started with "*" ("*", "*\/2", ...)
+#define CRON_FLAG_DOW_STAR  0x02  ///< Day-of-week field started with "*"
+
+/**
+ * @brief Longest text formatCron() can produce, terminator included
+ *
+ * Worst case: every field an irregular list that no range or step
+ * shortens (minutes alone take 170 characters), plus action and power.
+ */
+#define SCHED_CRON_TEXT_MAX 384
+
+static_assert(MAX_CRON_RULES <= 32, "evaluate() keeps one bit per cron rule in a uint32_t");
+
+/**
+ * @struct CronRule
+ * @brief Cron expression compiled into per-field bitsets
+ *
+ * Fields follow classic cron: minute (0-59), hour (0-23), day of month
+ * (1-31), month (1-12) and day of week (0-7, 0 and 7 = Sunday, or names).
+ * Each field accepts "*", values, ranges, lists and "/step". When both
+ * day fields are restricted a day matches if either does, as in cron; a
+ * day field that starts with "*" (even "*\/2") counts as unrestricted for
+ * that rule, so the flag is kept apart from the field's bits.
+ * A rule with no minute bits is an empty slot.
+ */
+struct CronRule {
+  uint64_t minutes;      ///< Bit n = minute n
+  uint32_t hours;        ///< Bit n = hour n
+  uint32_t daysOfMonth;  ///< Bit n = day n (1-31)
+  uint16_t months;       ///< Bit n = month n (1-12)
+  uint8_t dayMask;       ///< Days of week as a DayMask
+  uint8_t flags;         ///< CRON_FLAG_* bits
+  uint8_t action;        ///< ScheduleAction to dispatch
+  uint8_t power;         ///< Target power (1-5; unused for shutdown)
+  uint8_t reserved[2];   ///< Always 0
+
+  bool isEmpty() const { return minutes == 0; }
+
+  /**
+   * @brief Check whether the rule fires at a broken-down local time
+   * @param minute Minute (0-59)
+   * @param hour Hour (0-23)
+   * @param dayOfMonth Day of month (1-31)
+   * @param month Month (1-12)
+   * @param dayBit Single DayMask bit of the weekday
+   */
+  bool matches(uint8_t minute, uint8_t hour, uint8_t dayOfMonth, uint8_t month, uint8_t dayBit) const {
+    if (!((minutes >> minute) & 1) || !((hours >> hour) & 1) || !((months >> month) & 1)) return false;
+    bool domHit = (daysOfMonth >> dayOfMonth) & 1;
+    bool dowHit = (dayMask & dayBit) != 0;
+    if (flags & (CRON_FLAG_DOM_STAR | CRON_FLAG_DOW_STAR)) return domHit && dowHit;
+    return domHit || dowHit;
+  }
+};
+
+static_assert(sizeof(CronRule) == 24, "CronRule is persisted as a 24-byte record");
+
+// ============================================================================
+// PRE-HEAT RULES
+// ============================================================================
+
+#define SCHED_PRE_DAYS_SHIFT   0           ///< Bits 0-6: day mask
+#define SCHED_PRE_DAYS_MASK    0x0000007FUL
+#define SCHED_PRE_MINUTE_SHIFT 7           ///< Bits 7-17: target minute of day (0-1439)
+#define SCHED_PRE_MINUTE_MASK  0x0003FF80UL
+#define SCHED_PRE_POWER_SHIFT  18          ///< Bits 18-20: power level to heat at (1-5)
+#define SCHED_PRE_POWER_MASK   0x001C0000UL
+#define SCHED_PRE_TEMP_SHIFT   21          ///< Bits 21-28: target temperature in 0.5 °C steps
+#define SCHED_PRE_TEMP_MASK    0x1FE00000UL
+
+/**
+ * @struct PreheatRule
+ * @brief "Warm by HH:MM to T °C" rule packed into 32 bits
+ *
+ * Instead of a start time the user gives the time the room must be warm;
+ * the scheduler starts the stove at the latest moment the learned thermal
+ * model says still reaches the target. The all-zero value is an empty slot.
+ */
+struct PreheatRule {
+  uint32_t raw;  ///< Packed rule fields
+
+  uint8_t dayMask() const { return (uint8_t)((raw & SCHED_PRE_DAYS_MASK) >> SCHED_PRE_DAYS_SHIFT); }
+  uint16_t minuteOfDay() const { return (uint16_t)((raw & SCHED_PRE_MINUTE_MASK) >> SCHED_PRE_MINUTE_SHIFT); }
+  uint8_t power() const { return (uint8_t)((raw & SCHED_PRE_POWER_MASK) >> SCHED_PRE_POWER_SHIFT); }
+  float targetTemp() const { return ((raw & SCHED_PRE_TEMP_MASK) >> SCHED_PRE_TEMP_SHIFT) * 0.5f; }
+  bool isEmpty() const { return dayMask() == 0; }
+
+  /** @brief Build a packed rule (temperature rounded to 0.5 °C, no range checking) */
+  static PreheatRule make(uint8_t dayMask, uint16_t minuteOfDay, float targetTemp, uint8_t power) {
+    uint32_t half = (uint32_t)(targetTemp * 2.0f + 0.5f);
+    if (half > 255) half = 255;
+    PreheatRule r;
+    r.raw = ((uint32_t)(dayMask & 0x7F) << SCHED_PRE_DAYS_SHIFT)
+          | ((uint32_t)(minuteOfDay & 0x7FF) << SCHED_PRE_MINUTE_SHIFT)
+          | ((uint32_t)(power & 0x07) << SCHED_PRE_POWER_SHIFT)
+          | (half << SCHED_PRE_TEMP_SHIFT);
+    return r;
+  }
+};
+
+static_assert(sizeof(PreheatRule) == 4, "PreheatRule must stay packed in 32 bits");
+
+class ThermalModel;
+
+/**
+ * @struct ScheduleSnapshot
+ * @brief Immutable published copy of the schedule table
+ *
+ * Readers only ever see a fully built snapshot; edits are made on a private
+ * copy that is published with a single atomic store.
+ */
+struct ScheduleSnapshot {
+  ScheduleEntry entries[MAX_SCHEDULE_ENTRIES];        ///< Packed schedule entries
+  uint32_t minuteIndex[SCHED_MINUTES_PER_DAY / 32];   ///< Bit per minute of day with any active entry
+  ScheduleWindow windows[MAX_SCHEDULE_WINDOWS];       ///< On/off windows as configured
+  ScheduleSegment segments[SCHED_MAX_SEGMENTS];       ///< Windows flattened: disjoint, sorted by start
+  uint16_t segmentCount;                              ///< Valid entries in segments
+  CronRule cron[MAX_CRON_RULES];                      ///< Compiled cron rules
+  PreheatRule preheat[MAX_PREHEAT_RULES];             ///< Pre-heat rules
+};
+
+/**
+ * @struct ScheduleRules
+ * @brief Copy of every rule table taken from one snapshot (see Scheduler::copyRules())
+ *
+ * Listings format from this copy so an edit landing mid-listing cannot
+ * mix rows of the old and the new table.
+ */
+struct ScheduleRules {
+  bool enabled;                                       ///< Global enable at copy time
+  ScheduleEntry entries[MAX_SCHEDULE_ENTRIES];        ///< Point entries
+  ScheduleWindow windows[MAX_SCHEDULE_WINDOWS];       ///< On/off windows
+  CronRule cron[MAX_CRON_RULES];                      ///< Cron rules
+  PreheatRule preheat[MAX_PREHEAT_RULES];             ///< Pre-heat rules
+};
+
+static_assert(sizeof(ScheduleRules) <= 1024, "ScheduleRules is copied onto the network task's stack (LocalApi)");
+
+/**
+ * @enum ScheduleSource
+ * @brief Kind of rule behind a projected schedule event
+ */
+enum ScheduleSource : uint8_t {
+  SCHED_SRC_ENTRY   = 0,  ///< Point entry ("#i")
+  SCHED_SRC_CRON    = 1,  ///< Cron rule ("C#i")
+  SCHED_SRC_PREHEAT = 2,  ///< Pre-heat rule start, estimated ("P#i")
+  SCHED_SRC_WINDOW  = 3   ///< Window edge ("W#i")
+};
+
+/**
+ * @struct ScheduleEvent
+ * @brief One action the schedule will fire, as returned by Scheduler::project()
+ */
+struct ScheduleEvent {
+  uint32_t minute;        ///< Epoch minute (UTC seconds / 60) the action fires
+  ScheduleAction action;  ///< Action dispatched
+  uint8_t power;          ///< Target power (0 for shutdown)
+  ScheduleSource source;  ///< Kind of rule that fires
+  uint8_t index;          ///< Entry, rule or window index (0xFF if unknown)
+};
+
+/**
+ * @struct ScheduleImportResult
+ * @brief Outcome of Scheduler::importTable()
+ */
+struct ScheduleImportResult {
+  uint16_t record;    ///< Failing record (1-based), or records read on success
+  uint16_t applied;   ///< Records that changed the table (0 on failure)
+  const char* error;  ///< Reason for the failure (nullptr on success)
 };
 
 // ============================================================================
@@ -59,113 +419,610 @@ struct ScheduleEntry {
 /**
  * @class Scheduler
  * @brief Weekly schedule manager with thread-safe operations
- * 
+ *
  * Manages a collection of schedule entries that can trigger stove operations
  * at specific times. Supports global enable/disable and per-entry activation.
- * All operations are protected by a FreeRTOS mutex for thread safety.
+ * A per-minute occupancy bitmap is kept alongside the table so that the
+ * common "nothing scheduled this minute" case costs one bit test regardless
+ * of how many entries exist.
+ *
+ * Evaluation is driven by wall-clock time and a watermark (the last minute
+ * already evaluated). Every minute between the watermark and now is checked
+ * once, so task jitter, a late NTP sync or a reboot do not lose entries:
+ * an occurrence found late fires if it is within the entry's grace window
+ * and is skipped otherwise. The watermark survives soft resets in RTC memory.
+ *
+ * Windows are flattened into a sorted list of disjoint segments (overlaps
+ * resolve to the highest power), so "what should the stove be doing now"
+ * is a binary search. The stove is reconciled with that answer on the first
+ * evaluation after boot (or right after a window edit) and at every window
+ * edge crossed since the watermark, if no more than SCHED_DEFAULT_GRACE_MIN
+ * ago; a manual change in between is respected until the next edge. A cold
+ * boot (no RTC watermark) replays no edges. An edit that clears or shortens the window that
+ * started the stove shuts it down; one that changes its power re-targets it.
+ *
+ * Pre-heat rules are checked against the current time on every evaluation:
+ * within PREHEAT_MAX_LEAD_MIN of the target, the stove is started once the
+ * model's latest start time (minus PREHEAT_MARGIN_MIN) is reached, unless
+ * it is already on or the room is predicted to stay warm enough.
+ *
+ * Cron rules fire at most once per evaluation (a catch-up after a reboot
+ * re-asserts the rule once instead of replaying every missed step).
+ * nextWakeDelayMs() reports how long the scheduler task may sleep before
+ * any entry, window edge or rule can fire; edits wake the task early.
+ *
+ * The table is published as copy-on-write snapshots (two buffers and a
+ * reader count per buffer). Readers - evaluate(), getEntry(), writeSummary()
+ * and the persistence path - never take a lock; edits are serialized by a
+ * FreeRTOS mutex, build the next snapshot off to the side and swap it in
+ * atomically. evaluate() collects the actions that fire and only calls the
+ * dispatch callback after releasing the snapshot, so a blocking dispatch
+ * (e.g. a full command queue) cannot stall editors or other readers.
  */
 class Scheduler {
 public:
   // ========================================================================
   // Initialization
   // ========================================================================
-  
+
   /**
    * @brief Initialize the scheduler
-   * 
-   * Creates the mutex for thread safety and initializes all entries to inactive.
+   *
+   * Creates the mutex for thread safety, initializes all entries to empty
+   * and restores the last saved schedule from NVS if one exists.
    * Must be called before using any other methods.
    */
   void begin();
-  
+
+  // ========================================================================
+  // Persistence
+  // ========================================================================
+
+  /**
+   * @brief Save pending edits once they have settled
+   * @param nowMs Current millis()
+   *
+   * Edits are debounced: the table is written SCHED_PERSIST_DEBOUNCE_MS
+   * after the last change, or at most SCHED_PERSIST_MAX_DELAY_MS after the
+   * first unsaved change. Call periodically from the scheduler task.
+   */
+  void persistIfDue(uint32_t nowMs);
+
+  /**
+   * @brief Save pending edits immediately (e.g. before a reboot)
+   */
+  void flush();
+
   // ========================================================================
   // Entry Management
   // ========================================================================
-  
+
   /**
    * @brief Update a schedule entry
    * @param idx Entry index (0 to MAX_SCHEDULE_ENTRIES-1)
    * @param active Whether the entry is enabled
-   * @param day Day of week (1-7, see Weekday enum)
+   * @param dayMask Days the entry fires on (see DayMask, 1-127)
    * @param hour Hour of day (0-23)
    * @param minute Minute of hour (0-59)
    * @param power Target power level (1-5)
-   * @return true if update successful, false if index out of range
-   * 
-   * Thread-safe method to modify a schedule entry.
+   * @param action Action to perform when the entry fires
+   * @param graceMin Late-fire window in minutes (0 = skip if missed)
+   * @return true if update successful, false if any field is out of range
+   *
+   * Thread-safe method to modify a schedule entry. Publishes a new snapshot.
    */
-  bool updateEntry(int idx, bool active, uint8_t day, uint8_t hour, 
-                   uint8_t minute, uint8_t power);
-  
+  bool updateEntry(int idx, bool active, uint8_t dayMask, uint8_t hour,
+                   uint8_t minute, uint8_t power,
+                   ScheduleAction action = SCHED_ACTION_START,
+                   uint8_t graceMin = SCHED_DEFAULT_GRACE_MIN);
+
+  /**
+   * @brief Update a schedule entry from its packed form
+   * @param idx Entry index (0 to MAX_SCHEDULE_ENTRIES-1)
+   * @param e Packed entry (validated like the field-based overload)
+   * @return true if update successful, false if index or fields are invalid
+   */
+  bool updateEntry(int idx, const ScheduleEntry& e);
+
   /**
    * @brief Retrieve a schedule entry
    * @param idx Entry index (0 to MAX_SCHEDULE_ENTRIES-1)
    * @return Copy of the schedule entry
-   * 
-   * Thread-safe method to read a schedule entry.
-   * If index is out of range, returns a default-initialized entry.
+   *
+   * Lock-free read from the current snapshot.
+   * If index is out of range, the last entry is returned.
    */
   ScheduleEntry getEntry(size_t idx);
-  
+
+  // ========================================================================
+  // Window Management
+  // ========================================================================
+
+  /**
+   * @brief Set an on/off window
+   * @param idx Window index (0 to MAX_SCHEDULE_WINDOWS-1)
+   * @param dayMask Days the window starts on (see DayMask, 1-127)
+   * @param startMin Start minute of day (0-1439)
+   * @param endMin End minute of day (0-1439, exclusive); at or before
+   *        startMin means the window ends on the following day
+   * @param power Power level while inside the window (1-5)
+   * @return true if stored, false if any field is out of range
+   */
+  bool updateWindow(int idx, uint8_t dayMask, uint16_t startMin,
+                    uint16_t endMin, uint8_t power);
+
+  /**
+   * @brief Remove an on/off window
+   * @return true if the index was valid
+   */
+  bool clearWindow(int idx);
+
+  /**
+   * @brief Retrieve an on/off window (empty if idx is out of range)
+   */
+  ScheduleWindow getWindow(size_t idx);
+
+  /**
+   * @brief Power the windows ask for at a given time
+   * @param now Wall-clock time (UTC seconds)
+   * @return Desired power 1-5, or 0 if the stove should be off (or the
+   *         clock is not valid yet)
+   */
+  uint8_t desiredPower(time_t now);
+
+  // ========================================================================
+  // Cron Rules
+  // ========================================================================
+
+  /**
+   * @brief Set or clear a cron rule from text
+   * @param idx Rule index (0 to MAX_CRON_RULES-1)
+   * @param text "<min> <hour> <dom> <mon> <dow> <start|power|off> [power]",
+   *        or "clear" to remove the rule
+   * @return true if stored, false on a bad index or syntax error
+   */
+  bool setCronRule(int idx, const char* text);
+
+  /**
+   * @brief Retrieve a compiled cron rule (empty if idx is out of range)
+   */
+  CronRule getCronRule(size_t idx);
+
+  /**
+   * @brief Compile a cron rule from text (see setCronRule())
+   * @return true if the text was valid
+   */
+  static bool parseCron(const char* text, CronRule& out);
+
+  /**
+   * @brief Format a compiled rule back to text
+   * @param rule Rule to format
+   * @param out Output buffer
+   * @param cap Output buffer size (SCHED_CRON_TEXT_MAX always suffices)
+   * @return false if the text did not fit (out is then cut short)
+   *
+   * The output parses back to the same rule; fields are written as "*",
+   * "*\/step", or comma-separated values, ranges and "a-b/step" runs.
+   */
+  static bool formatCron(const CronRule& rule, char* out, size_t cap);
+
+  // ========================================================================
+  // Pre-heat Rules
+  // ========================================================================
+
+  /**
+   * @brief Set a pre-heat rule
+   * @param idx Rule index (0 to MAX_PREHEAT_RULES-1)
+   * @param dayMask Days the target applies to (see DayMask, 1-127)
+   * @param minuteOfDay Time the room must be warm (0-1439)
+   * @param targetTemp Temperature wanted at that time (5-35 °C)
+   * @param power Power level to heat at (1-5)
+   * @return true if stored, false if any field is out of range
+   */
+  bool updatePreheat(int idx, uint8_t dayMask, uint16_t minuteOfDay,
+                     float targetTemp, uint8_t power);
+
+  /**
+   * @brief Remove a pre-heat rule
+   * @return true if the index was valid
+   */
+  bool clearPreheat(int idx);
+
+  /**
+   * @brief Retrieve a pre-heat rule (empty if idx is out of range)
+   */
+  PreheatRule getPreheat(size_t idx);
+
+  /**
+   * @brief Attach the thermal model used by pre-heat rules
+   * @param model Learned model; without one a fixed PREHEAT_FALLBACK_LEAD_MIN is used
+   */
+  void setThermalModel(ThermalModel* model);
+
+  // ========================================================================
+  // Projection
+  // ========================================================================
+
+  /**
+   * @brief List the actions the current table will fire over a range
+   * @param fromMin First epoch minute to scan; advanced past the scanned range
+   * @param toMin One past the last epoch minute to scan
+   * @param out Receives events in dispatch order (entries, cron, pre-heat,
+   *        window edge within a minute, as evaluate() fires them)
+   * @param cap Capacity of out
+   * @return Number of events written
+   *
+   * Read-only: no watermark, pre-heat or reconcile state is touched. When out
+   * fills up the scan stops at a minute boundary, so calling again with the
+   * updated fromMin continues without gaps or duplicates. Pre-heat starts
+   * are estimated once per call from the current thermal model, assuming
+   * the stove stays off until then. Returns nothing while the scheduler is
+   * globally disabled.
+   */
+  size_t project(uint32_t& fromMin, uint32_t toMin, ScheduleEvent* out, size_t cap);
+
+  // ========================================================================
+  // Task Integration
+  // ========================================================================
+
+  /**
+   * @brief Register the task to notify when the schedule changes
+   * @param task Task that sleeps on ulTaskNotifyTake() between evaluations
+   */
+  void setWakeTask(TaskHandle_t task);
+
+  /**
+   * @brief How long the scheduler task may sleep
+   * @param now Current wall-clock time (UTC seconds)
+   * @param nowMs Current millis()
+   * @return Milliseconds until the next entry, window edge or cron rule can
+   *         fire, or a pending save is due; capped at SCHED_MAX_SLEEP_MS and
+   *         SCHED_CLOCK_POLL_MS while the clock is not valid
+   */
+  uint32_t nextWakeDelayMs(time_t now, uint32_t nowMs);
+
+  // ========================================================================
+  // Bulk Table Exchange
+  // ========================================================================
+
+  /**
+   * @brief Write the whole table as import records
+   * @param out Destination
+   * @param sep Record separator ('\n' for the terminal, ';' for one-line widgets)
+   * @return Number of characters written; 0 (nothing written) if a cron
+   *         rule could not be formatted in full
+   *
+   * Records (days are written as hex masks, see parseDayMask()):
+   * - "clear"                                 empty the table first
+   * - "G <0|1>"                               global enable
+   * - "E <i> <act> <days> <HH:MM> <start|power|off> <power> <grace>"
+   * - "W <i> <days> <HH:MM> <HH:MM> <power>"
+   * - "C <i> <cron expression> <action> [power]"
+   * - "P <i> <days> <HH:MM> <temp_C> <power>"
+   * - "E|W|C|P <i> clear"                     empty one slot
+   * The output starts with "clear", so importing it restores the table as is.
+   */
+  size_t exportTable(Print& out, char sep = '\n');
+
+  /**
+   * @brief Apply a batch of records (see exportTable()) as one edit
+   * @param text Records separated by ';' or newlines; blank records and
+   *        records starting with '#' are ignored
+   * @param res Receives the failing record and reason, or the count applied
+   * @return true if every record was valid and the batch was applied
+   *
+   * All records are validated against a private copy of the table before
+   * anything is published: either the whole batch becomes visible in one
+   * snapshot swap with a single save scheduled, or nothing changes.
+   */
+  bool importTable(const char* text, ScheduleImportResult& res);
+
   // ========================================================================
   // Global Control
   // ========================================================================
-  
+
   /**
    * @brief Enable or disable the entire scheduler
    * @param en true to enable scheduling, false to disable
-   * 
+   *
    * When disabled, evaluate() will not trigger any stove actions.
    */
   void setGlobalEnabled(bool en);
-  
+
   /**
    * @brief Check if scheduler is globally enabled
    * @return true if enabled, false if disabled
    */
   bool isGlobalEnabled() const;
-  
+
   // ========================================================================
   // Schedule Evaluation
   // ========================================================================
-  
+
   /**
-   * @brief Evaluate schedule and trigger actions if needed
-   * @param day Current day of week (1-7)
-   * @param hour Current hour (0-23)
-   * @param minute Current minute (0-59)
+   * @brief Evaluate every minute since the last call and trigger actions
+   * @param now Current wall-clock time (UTC seconds, as returned by time())
    * @param stoveOn Current stove power state
-   * @param startAndPower Callback function to start stove and set power
-   * 
-   * Checks all active entries for matches with current time.
-   * If a match is found and conditions are met, calls startAndPower callback.
-   * 
-   * This method should be called periodically (e.g., every minute).
-   * Thread-safe operation.
-   */
-  void evaluate(uint8_t day, uint8_t hour, uint8_t minute, bool stoveOn, 
-                void(*startAndPower)(uint8_t));
-  
+   * @param dispatch Callback receiving the action and target power of each match
+   *
+   * Does nothing until the clock is valid (see SCHED_TIME_VALID_EPOCH).
+   * On the first valid call after a cold boot the watermark starts
+   * SCHED_MAX_GRACE_MIN in the past so entries still inside their grace
+   * window fire. If the clock jumps backwards the watermark is reset without
+   * replaying anything. Safe to call more often than once per minute.
+   * The scan runs on a snapshot without locks; dispatch is called afterwards,
+   * in firing order, with no scheduler state held.
+   */
+  void evaluate(time_t now, bool stoveOn,
+                void(*dispatch)(ScheduleAction action, uint8_t power));
+
   // ========================================================================
   // Reporting
   // ========================================================================
-  
+
+  /**
+   * @brief Copy every rule table out of the published snapshot
+   * @param out Receives the tables (under 1 KB)
+   *
+   * The snapshot is pinned only for the copy.
+   */
+  void copyRules(ScheduleRules& out) const;
+
   /**
-   * @brief Build a text summary of all schedule entries
-   * @return Multi-line string with all active entries formatted for display
-   * 
-   * Format: "[Index] Day HH:MM -> Power X (Active/Inactive)"
+   * @brief Stream a text summary of all schedule entries into a sink
+   * @param out Destination (Serial, BufferPrint, ...)
+   * @return Number of characters written
+   *
+   * Format: "#Index act=X days=MTWTF-- HH:MM <action> power=X [grace=N]",
+   * followed by windows as "W#Index days=MTWTF-- HH:MM-HH:MM power=X",
+   * cron rules as "C#Index <expression> <action> [power]" and pre-heat
+   * rules as "P#Index days=MTWTF-- HH:MM to=T.TC power=X".
    * Empty entries are omitted from the summary.
-   * Thread-safe operation.
+   * The rules are copied out of one snapshot (copyRules()) into static
+   * scratch and formatted from the copy, so the listing is consistent, the
+   * sink may block without delaying editors, and neither the heap nor the
+   * caller's stack pays for the copy. Listings run one at a time.
+   */
+  size_t writeSummary(Print& out);
+
+  /**
+   * @brief Format the summary into a caller-supplied buffer
+   * @param buf Destination buffer, always NUL-terminated
+   * @param cap Capacity of buf in bytes
+   * @return Length of the text in buf
+   *
+   * A summary that does not fit is cut and ends with "...".
+   */
+  size_t writeSummary(char* buf, size_t cap);
+
+  // ========================================================================
+  // Helpers
+  // ========================================================================
+
+  /**
+   * @brief Compute the minute of week for a broken-down local time
+   * @param t Local time (tm_wday 0 = Sunday)
+   * @return Minute of week, 0 = Monday 00:00
+   */
+  static uint16_t minuteOfWeek(const struct tm& t);
+
+  /**
+   * @brief Parse a day specification into a DayMask
+   * @param spec Text such as "3", "1-5", "1,3,5", "mon-fri", "sat,sun",
+   *             "weekdays", "weekend", "all" or "0x1F"
+   * @param out Receives the resulting mask (1-127)
+   * @return true if the specification was valid
+   *
+   * A single number 1-7 selects that weekday (0 is accepted as Sunday).
+   */
+  static bool parseDayMask(const char* spec, uint8_t& out);
+
+  /**
+   * @brief Format a DayMask as a fixed 7-character string ("MTWTF--")
+   * @param mask Day mask to format
+   * @param out Buffer of at least 8 bytes
+   */
+  static void formatDayMask(uint8_t mask, char* out);
+
+  /**
+   * @brief Parse a time of day ("6:30", "06:30" or "0630")
+   * @param text Time to parse
+   * @param out Receives the minute of day (0-1439)
+   * @return true if the time was valid
+   */
+  static bool parseClock(const char* text, uint16_t& out);
+
+  /**
+   * @brief Short display name of a ScheduleAction ("start", "power", "off")
    */
-  String buildSummary();
+  static const char* actionName(ScheduleAction action);
+
+  /**
+   * @brief Parse an action name ("start", "power", "off")
+   * @return true if the name was recognised
+   */
+  static bool parseAction(const char* name, ScheduleAction& out);
 
 private:
+  // ========================================================================
+  // Internal Helpers
+  // ========================================================================
+
+  /**
+   * @brief Pin the current snapshot for reading
+   * @param slot Receives the buffer index to pass to releaseSnapshot()
+   * @return Snapshot that stays valid until released
+   */
+  const ScheduleSnapshot& acquireSnapshot(uint8_t& slot) const;
+
+  /**
+   * @brief Unpin a snapshot obtained from acquireSnapshot()
+   */
+  void releaseSnapshot(uint8_t slot) const;
+
+  /**
+   * @brief Prepare the back buffer as a copy of the current snapshot
+   * @return Writable snapshot (call with mutex held, then publishSnapshot())
+   *
+   * Waits for readers still scanning an older snapshot in that buffer.
+   */
+  ScheduleSnapshot& beginEdit();
+
+  /**
+   * @brief Rebuild the index of the edited snapshot and make it current
+   */
+  void publishSnapshot(ScheduleSnapshot& snap);
+
+  /**
+   * @brief Rebuild the per-minute occupancy bitmap of a snapshot
+   */
+  static void rebuildMinuteIndex(ScheduleSnapshot& snap);
+
+  /**
+   * @brief Flatten the windows of a snapshot into its segment list
+   *
+   * Every window occurrence contributes two boundaries; each elementary
+   * range between boundaries takes the highest power of the windows that
+   * cover it, and equal neighbours are merged.
+   */
+  static void rebuildWindowIndex(ScheduleSnapshot& snap);
+
+  /**
+   * @brief Desired power at a minute of week (binary search, 0 = off)
+   */
+  static uint8_t windowPowerAt(const ScheduleSnapshot& snap, uint16_t minuteOfWeek);
+
+  /**
+   * @brief Minutes from a local time to the next firing of a cron rule
+   * @param rule Compiled rule
+   * @param from Current local time (the current minute is excluded)
+   * @return Minutes until the next match, or 0 if none within a year
+   */
+  static uint32_t cronMinutesUntil(const CronRule& rule, const struct tm& from);
+
+  /**
+   * @brief Minutes from a minute of week to the next entry or window edge
+   * @return Minutes (1-SCHED_MINUTES_PER_WEEK), or 0 if nothing is scheduled
+   */
+  static uint32_t tableMinutesUntil(const ScheduleSnapshot& snap, uint16_t minuteOfWeek);
+
+  /**
+   * @brief Index of a window with the given power covering a minute of week
+   * @return Window index, or 0xFF if none matches
+   */
+  static uint8_t windowIndexAt(const ScheduleSnapshot& snap, uint16_t minuteOfWeek, uint8_t power);
+
+  /**
+   * @brief Estimated minutes before its target that a pre-heat rule starts
+   * @return Lead in minutes, or -1 if the rule is empty or no start is
+   *         expected (the room stays warm enough on its own)
+   */
+  int16_t preheatLeadMinutes(const PreheatRule& rule);
+
+  /**
+   * @brief Wake the scheduler task after an edit
+   */
+  void notifyChanged();
+
+  /**
+   * @brief Record an edit for the debounced save (call with mutex held)
+   */
+  void markDirty();
+
+  /** @brief Parts of the table an import touched (bit mask) */
+  enum : uint8_t {
+    TOUCH_WINDOWS = 0x01,  ///< Windows changed: reconcile again
+    TOUCH_PREHEAT = 0x02   ///< Pre-heat rules changed: forget handled targets
+  };
+
+  /**
+   * @brief Validate one import record and apply it to a snapshot being edited
+   * @param snap Back buffer from beginEdit()
+   * @param rec Record text (modified by tokenizing)
+   * @param enabled Global enable to publish with the batch
+   * @param touched Receives TOUCH_* bits
+   * @param error Receives the reason on failure
+   * @return true if the record was valid
+   */
+  static bool importRecord(ScheduleSnapshot& snap, char* rec, bool& enabled,
+                           uint8_t& touched, const char*& error);
+
+  /**
+   * @brief Serialize a snapshot into tagged sections
+   * @return Payload length in bytes, 0 if it does not fit
+   */
+  size_t encode(const ScheduleSnapshot& snap, uint8_t* buf, size_t cap) const;
+
+  /**
+   * @brief Restore the table from tagged sections into a snapshot
+   * @return true if the payload was well formed
+   */
+  bool decode(ScheduleSnapshot& snap, const uint8_t* buf, size_t len);
+
+  /** @brief Persisted section tags */
+  enum : uint8_t {
+    SECTION_SETTINGS = 1,  ///< uint8_t flags (bit 0 = global enable) + 3 pad bytes
+    SECTION_ENTRIES  = 2,  ///< Packed ScheduleEntry words, index order
+    SECTION_WINDOWS  = 3,  ///< Packed ScheduleWindow words, index order
+    SECTION_CRON     = 4,  ///< CronRule records, index order
+    SECTION_PREHEAT  = 5   ///< Packed PreheatRule words, index order
+  };
+
+  /**
+   * @struct PendingActions
+   * @brief Actions collected during a scan, dispatched after it
+   */
+  struct PendingActions {
+    struct Item {
+      ScheduleAction action;  ///< Action to dispatch
+      uint8_t power;          ///< Target power for the action
+    };
+    Item items[SCHED_MAX_PENDING_ACTIONS];  ///< Collected actions, firing order
+    uint8_t count = 0;                      ///< Number of valid items
+
+    /** @brief Append an action; when full the last item is replaced */
+    void push(ScheduleAction action, uint8_t power);
+  };
+
+  /**
+   * @brief Check one minute of week against a snapshot
+   * @param snap Snapshot being scanned
+   * @param minuteOfWeek Minute being evaluated
+   * @param lateMin How many minutes ago that minute was
+   * @param out Receives the entries that fire
+   */
+  static void evaluateMinute(const ScheduleSnapshot& snap, uint16_t minuteOfWeek,
+                             uint32_t lateMin, PendingActions& out);
+
+  /**
+   * @brief Decide whether pre-heat rules should start the stove now
+   * @param rules Copy of the snapshot's pre-heat rules
+   * @param now Current wall-clock time
+   * @param stoveOn Current stove power state
+   * @param out Receives the start actions
+   */
+  void evaluatePreheat(const PreheatRule* rules, time_t now, bool stoveOn, PendingActions& out);
+
   // ========================================================================
   // Internal State
   // ========================================================================
-  
-  ScheduleEntry _entries[MAX_SCHEDULE_ENTRIES];  ///< Array of schedule entries
-  bool _globalEnabled;                           ///< Global scheduler enable flag
-  SemaphoreHandle_t _mutex;                      ///< Mutex for thread-safe access
-};
\ No newline at end of file
+
+  ScheduleSnapshot _snap[2];                            ///< Published and back snapshot buffers
+  std::atomic<uint8_t> _current{0};                     ///< Index of the published snapshot
+  mutable std::atomic<uint16_t> _readers[2];            ///< Readers pinning each buffer
+  bool _globalEnabled;                                  ///< Global scheduler enable flag
+  SemaphoreHandle_t _mutex;                             ///< Serializes editors and persistence state
+  SemaphoreHandle_t _storeMutex;                        ///< Owns the persist buffer from encode to NVS write, and the listing scratch
+
+  uint32_t _watermarkMin = 0;                           ///< Last evaluated epoch minute (0 = none yet)
+  std::atomic<bool> _windowsReconciled{false};          ///< Stove reconciled with the windows since boot/edit
+  uint8_t _windowPower = 0;                             ///< Window power last asserted by the scheduler (0 = none)
+  TaskHandle_t _wakeTask = nullptr;                     ///< Task woken on edits
+  ThermalModel* _thermal = nullptr;                     ///< Model behind pre-heat rules
+  uint32_t _preheatDone[MAX_PREHEAT_RULES] = {};        ///< Target epoch minute already handled, per rule
+
+  ScheduleStore _store;                                 ///< NVS persistence
+  bool _dirty = false;                                  ///< Unsaved edits pending
+  uint32_t _firstDirtyMs = 0;                           ///< Time of first unsaved edit
+  uint32_t _lastEditMs = 0;                             ///< Time of most recent edit
+};
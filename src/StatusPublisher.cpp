@@ -1,6 +1,6 @@
 /**
  * @file StatusPublisher.cpp
- * @brief Blynk status publishing and UI state management implementation
+ * @brief Status fan-out and Blynk UI state management implementation
  */
 
 #include "StatusPublisher.h"
@@ -8,126 +8,217 @@
 #include "UIGating.h"
 #include "BlynkGlobal.h"
 #include "Config.h"
+#include "Logging.h"
 
 StatusPublisher gStatusPublisher;
 
+const char* StatusPublisher::stateName(StoveRunState state) {
+    switch (state) {
+        case STOVE_OFF: return "Off";
+        case STOVE_STARTING: return "Starting";
+        case STOVE_LOADING_PELLET: return "Loading";
+        case STOVE_FIRE_PRESENT: return "Fire";
+        case STOVE_WORKING: return "Working";
+        case STOVE_FINAL_CLEAN: return "Cleaning";
+        default: return "Undefined";
+    }
+}
+
 void StatusPublisher::publishIfChanged(const StoveStatus& s) {
     uint32_t now = millis();
+    uint8_t changed = 0;
 
-    if (s.state != mSnapshot.state && (now - mSnapshot.lastStatusPublishMs) >= STATUS_MIN_PUBLISH_INTERVAL_MS) {
-        BlynkWrapper::virtualWrite(VPIN_STOVE_STATE_NUM, (int)s.state);
-        String stateStr;
-        switch(s.state) {
-            case STOVE_OFF: stateStr = "Off"; break;
-            case STOVE_STARTING: stateStr = "Starting"; break;
-            case STOVE_LOADING_PELLET: stateStr = "Loading"; break;
-            case STOVE_FIRE_PRESENT: stateStr = "Fire"; break;
-            case STOVE_WORKING: stateStr = "Working"; break;
-            case STOVE_FINAL_CLEAN: stateStr = "Cleaning"; break;
-            default: stateStr = "Undefined"; break;
-        }
-        BlynkWrapper::virtualWrite(VPIN_STOVE_STATE_STRING, stateStr);
-        mSnapshot.state = s.state;
-        mSnapshot.lastStatusPublishMs = now;
+    // One decision and one encoding per field; the sinks share the frame.
+    if (mState.update((int)s.state, now)) {
+        mFrame.setState(s.state, stateName(s.state));
+        changed |= SF_STATE;
     }
-
-    if (s.powerLevel != mSnapshot.power && (now - mSnapshot.lastStatusPublishMs) >= STATUS_MIN_PUBLISH_INTERVAL_MS) {
-        BlynkWrapper::virtualWrite(VPIN_POWER_LEVEL_READ, s.powerLevel);
-        mSnapshot.power = s.powerLevel;
-        mSnapshot.lastStatusPublishMs = now;
+    if (mOn.update(s.isOn ? 1 : 0, now)) {
+        mFrame.setOn(s.isOn);
+        changed |= SF_ON;
     }
-
-    bool tempChanged = isnan(mSnapshot.ambientTemp) || (fabs(s.ambientTemp - mSnapshot.ambientTemp) >= TEMP_CHANGE_THRESHOLD);
-    if (tempChanged && (now - mSnapshot.lastTempPublishMs) >= TEMP_MIN_PUBLISH_INTERVAL_MS) {
-        BlynkWrapper::virtualWrite(VPIN_AMBIENT_TEMP, s.ambientTemp);
-        mSnapshot.ambientTemp = s.ambientTemp;
-        mSnapshot.lastTempPublishMs = now;
+    if (mPower.update(s.powerLevel, now)) {
+        mFrame.setPower(s.powerLevel);
+        changed |= SF_POWER;
+    }
+    if (mTemp.update(s.ambientTemp, now)) {
+        mFrame.setTemp(s.ambientTemp);
+        changed |= SF_TEMP;
     }
 
-    uint32_t remainMs = gController.getAutoShutdownRemainingMs();
+    // The snapshot may be a few seconds old; count the timer down from it.
+    uint32_t age = now - s.takenMs;
+    uint32_t remainMs = s.autoShutdownRemainingMs > age ? s.autoShutdownRemainingMs - age : 0;
     int remainMin = remainMs ? (int)((remainMs + 59999UL) / 60000UL) : 0;
-    if (remainMin != mSnapshot.lastRemainMin) {
-        BlynkWrapper::virtualWrite(VPIN_AUTO_SHUTDOWN_REMAIN, remainMin);
-        mSnapshot.lastRemainMin = remainMin;
+    if (mRemainMin.update(remainMin, now)) {
+        mFrame.setTimer(remainMin);
+        changed |= SF_TIMER;
     }
-}
 
-void StatusPublisher::pushStatus() {
-    if (gTerminal.isUserTyping()) return;
-    
-    StoveStatus s = gController.getStatusSnapshot();
-    publishIfChanged(s);
+    dispatch(changed, now);
+}
 
-    uint32_t now = millis();
-    if (!uiGate.onOffLocked)
-        gBlynk.enableOnOff(gController.isOn());
-
-    if (uiGate.reqOnOffDisable) { gBlynk.disableOnOff(); uiGate.reqOnOffDisable = false; }
-    if (uiGate.reqPowerDisable) { gBlynk.disablePowerSlider(); uiGate.reqPowerDisable = false; }
-    if (uiGate.reqTimerDisable) { gBlynk.disableTimerInput(); uiGate.reqTimerDisable = false; }
-    if (uiGate.reqSchedDisable) { gBlynk.disableSchedulerApply(); uiGate.reqSchedDisable = false; }
-
-    if (uiGate.onOffLocked) {
-        bool stoveOn = gController.isOn();
-        if (stoveOn) {
-            if (s.canShutdown || (now - uiGate.onOffLockStart > STOVE_START_CONFIRM_TIMEOUT_MS)) {
-                uiGate.onOffLocked = false;
-                gBlynk.enableOnOff(true);
-            }
-        } else {
-            if (s.state == STOVE_OFF || (now - uiGate.onOffLockStart > STOVE_SHUTDOWN_CONFIRM_TIMEOUT_MS)) {
-                uiGate.onOffLocked = false;
-                gBlynk.enableOnOff(false);
-            }
-        }
-        if (uiGate.onOffLocked && (now - uiGate.onOffLockStart > UI_REENABLE_FAILSAFE_MS)) {
-            uiGate.onOffLocked = false;
-            gBlynk.enableOnOff(gController.isOn());
-        }
+void StatusPublisher::addSink(StatusSink& sink) {
+    if (mSinkCount >= STATUS_SINKS_MAX) {
+        logf("[STATUS] Sin hueco para el sink '%s'.", sink.name());
+        return;
+    }
+    // Keep mSinks sorted by priority; equal priorities in registration order.
+    uint8_t i = mSinkCount++;
+    while (i > 0 && mSinks[i - 1]->mPolicy.priority > sink.mPolicy.priority) {
+        mSinks[i] = mSinks[i - 1];
+        i--;
     }
+    mSinks[i] = &sink;
+}
+
+/** @brief Whether a sink's rate limit and slow-sink hold allow a delivery now */
+static bool sinkOpen(bool held, uint32_t holdUntilMs, bool delivered, uint32_t lastMs,
+                     uint32_t minIntervalMs, uint32_t now) {
+    if (held && (int32_t)(now - holdUntilMs) < 0) return false;
+    return !delivered || now - lastMs >= minIntervalMs;
+}
 
-    if (uiGate.powerLocked) {
-        if (!gController.isPowerAdjustInProgress()) {
-            uiGate.powerLocked = false;
-            gBlynk.enablePowerSlider(gController.getPowerLevel());
-        } else if (now - uiGate.powerLockStart > POWER_ADJUST_TIMEOUT_MS) {
-            uiGate.powerLocked = false;
-            gBlynk.enablePowerSlider(gController.getPowerLevel());
+void StatusPublisher::dispatch(uint8_t changed, uint32_t now) {
+    const uint32_t passStart = millis();
+    for (uint8_t i = 0; i < mSinkCount; i++) {
+        StatusSink& k = *mSinks[i];
+        const bool open = sinkOpen(k.mHeld, k.mHoldUntilMs, k.mDelivered, k.mLastMs,
+                                   k.mPolicy.minIntervalMs, now);
+        // A sampling sink only sees what changes while it is open.
+        if (open || k.mPolicy.coalesce) k.mPending |= changed;
+        k.mPending &= mFrame.valid;
+        if (!k.mPending || !open) continue;
+        if (!k.ready()) {
+            if (!k.mPolicy.coalesce) k.mPending = 0;
+            continue;
         }
-        if (uiGate.powerLocked && (now - uiGate.powerLockStart > UI_REENABLE_FAILSAFE_MS)) {
-            uiGate.powerLocked = false;
-            gBlynk.enablePowerSlider(gController.getPowerLevel());
+        // Out of time: lower-priority sinks keep their fields for the next pass.
+        if (millis() - passStart >= STATUS_SINK_PASS_BUDGET_MS) {
+            mPushRequested = true;
+            break;
         }
-    }
 
-    if (uiGate.timerLocked) {
-        if (now - uiGate.timerLockStart > 1500) {
-            uiGate.timerLocked = false;
-            BlynkWrapper::setProperty(VPIN_SET_TIMER_MIN, "isDisabled", "false");
-        }
-        if (uiGate.timerLocked && (now - uiGate.timerLockStart > UI_REENABLE_FAILSAFE_MS)) {
-            uiGate.timerLocked = false;
-            BlynkWrapper::setProperty(VPIN_SET_TIMER_MIN, "isDisabled", "false");
+        const uint8_t mask = k.mPending;
+        k.mPending = 0;
+        const uint32_t t0 = millis();
+        k.deliver(mFrame, mask);
+        const uint32_t cost = millis() - t0;
+        k.mDelivered = true;
+        k.mLastMs = now;
+        k.mLastCostMs = cost;
+        k.mDeliveries++;
+        // A sink that blocked is held back so it cannot eat every pass.
+        k.mHeld = cost > STATUS_SINK_SLOW_MS;
+        if (k.mHeld) {
+            uint32_t hold = cost * STATUS_SINK_HOLD_FACTOR;
+            k.mHoldUntilMs = t0 + cost + (hold < STATUS_SINK_HOLD_MAX_MS ? hold : STATUS_SINK_HOLD_MAX_MS);
+            if (k.mSlow++ == 0) logf("[STATUS] Sink '%s' lento (%lu ms); se espacia.", k.mName, (unsigned long)cost);
         }
     }
+}
 
-    if (uiGate.schedLocked) {
-        if (now - uiGate.schedLockStart > 1000) {
-            uiGate.schedLocked = false;
-            gBlynk.enableSchedulerApply();
-        }
-        if (uiGate.schedLocked && (now - uiGate.schedLockStart > UI_REENABLE_FAILSAFE_MS)) {
-            uiGate.schedLocked = false;
-            gBlynk.enableSchedulerApply();
-        }
+void StatusPublisher::printSinks(Print& out) const {
+    char line[112];
+    for (uint8_t i = 0; i < mSinkCount; i++) {
+        const StatusSink& k = *mSinks[i];
+        snprintf(line, sizeof(line), "\r\n  %-7s prio %u  %5lu ms %s  envios %lu  lentos %lu  ultimo %lu ms%s",
+                 k.mName, (unsigned)k.mPolicy.priority, (unsigned long)k.mPolicy.minIntervalMs,
+                 k.mPolicy.coalesce ? "coalesce" : "muestreo", (unsigned long)k.mDeliveries,
+                 (unsigned long)k.mSlow, (unsigned long)k.mLastCostMs, k.ready() ? "" : "  (no listo)");
+        out.print(line);
     }
+}
 
-    if (uiForceSwitchOn) {
+static inline uint32_t earliest(uint32_t a, uint32_t b) { return a < b ? a : b; }
+
+void StatusPublisher::pushStatus() {
+    // Everything this tick sends is collected and flushed as one batch.
+    // Status comes from the control tasks through gStatusQueue only.
+    StoveStatus s;
+    if (!latestStatus(s)) return;
+
+    BlynkWrapper::beginBatch();
+    publishIfChanged(s);
+
+    uint32_t now = millis();
+    if (!uiGate.isLocked(GATE_ONOFF))
+        gBlynk.enableOnOff(s.isOn);
+    uiGate.service(s, now);
+
+    // A refused shutdown leaves the stove on: put the switch back.
+    if (s.shutdownRefusals != mRefusalsSeen) {
+        mRefusalsSeen = s.shutdownRefusals;
         gBlynk.enableOnOff(true);
-        uiForceSwitchOn = false;
     }
+    BlynkWrapper::endBatch();
+}
+
+uint32_t StatusPublisher::nextDueMs(const StoveStatus& s, uint32_t now) const {
+    uint32_t due = UINT32_MAX;
+
+    // Channels held back by a rate limit or waiting for a staleness refresh.
+    due = earliest(due, mState.dueInMs((int)s.state, now));
+    due = earliest(due, mPower.dueInMs(s.powerLevel, now));
+    due = earliest(due, mTemp.dueInMs(s.ambientTemp, now));
+
+    // Sinks owing fields after a rate limit, a slow-sink hold or a skipped pass.
+    for (uint8_t i = 0; i < mSinkCount; i++) {
+        const StatusSink& k = *mSinks[i];
+        if (!k.mPending || !k.ready()) continue;  // Reconnects resync their sink.
+        uint32_t wait = 0;
+        if (k.mDelivered && now - k.mLastMs < k.mPolicy.minIntervalMs)
+            wait = k.mPolicy.minIntervalMs - (now - k.mLastMs);
+        if (k.mHeld && (int32_t)(now - k.mHoldUntilMs) < 0 && k.mHoldUntilMs - now > wait)
+            wait = k.mHoldUntilMs - now;
+        due = earliest(due, wait);
+    }
+
+    // Auto-shutdown countdown: the next whole-minute step.
+    uint32_t age = now - s.takenMs;
+    uint32_t remainMs = s.autoShutdownRemainingMs > age ? s.autoShutdownRemainingMs - age : 0;
+    if (remainMs) due = earliest(due, (remainMs - 1) % 60000UL + 1);
+
+    // Gating deadlines; unlocks driven by controller events arrive as notifications.
+    due = earliest(due, uiGate.nextDueMs(now));
+    return due;
 }
 
-void StatusPublisher::timerPush() {
+void StatusPublisher::armDeadline(uint32_t delayMs, uint32_t now) {
+    if (delayMs != UINT32_MAX && mDeadlineTimer >= 0 && mDeadlineAtMs - now == delayMs) return;
+    if (mDeadlineTimer >= 0) {
+        gTimer.deleteTimer(mDeadlineTimer);
+        mDeadlineTimer = -1;
+    }
+    if (delayMs == UINT32_MAX) return;
+    // A zero delay is still a pass through the loop, never a busy spin.
+    if (delayMs == 0) delayMs = 1;
+    mDeadlineAtMs = now + delayMs;
+    mDeadlineTimer = gTimer.setTimeout(delayMs, []() { gStatusPublisher.onDeadline(); });
+}
+
+void StatusPublisher::onDeadline() {
+    // The timer library frees a one-shot after its callback returns.
+    mDeadlineTimer = -1;
+    mPushRequested = true;
+}
+
+void StatusPublisher::begin() {
+    gTimer.setInterval(STATUS_HEARTBEAT_MS, []() { gStatusPublisher.requestPush(); });
+    mPushRequested = true;
+}
+
+void StatusPublisher::service() {
+    if (!mPushRequested) return;
+    mPushRequested = false;
     pushStatus();
+
+    StoveStatus s;
+    uint32_t now = millis();
+    armDeadline(latestStatus(s) ? nextDueMs(s, now) : UINT32_MAX, now);
+}
+
+void StatusPublisher::resync(StatusSink& sink) {
+    sink.mPending = SF_ALL;
+    mPushRequested = true;
 }
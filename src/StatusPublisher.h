@@ -1,34 +1,92 @@
 /**
  * @file StatusPublisher.h
- * @brief Blynk status publishing and UI state management
+ * @brief Status fan-out to the registered sinks and Blynk UI state management
+ *
+ * publishIfChanged() decides per channel what changed (ChangeTracker), encodes
+ * each changed field once into a StatusFrame and hands it to every
+ * StatusSink (Blynk, MQTT, WebSocket stream, log) in priority order. Each
+ * sink has its own rate limit and coalescing policy; a sink whose delivery
+ * blocks is held back, and one pass never spends more than
+ * STATUS_SINK_PASS_BUDGET_MS before leaving the remaining sinks for the
+ * next pass.
+ *
+ * Pushes are event driven and run in the network task: a new controller
+ * status (task notification from publishStatus()), a UI action or a resync
+ * requests one, and after each push a single one-shot gTimer timeout is
+ * armed for the earliest pending deadline (gating timeout, rate-limited or
+ * stale channel, auto-shutdown minute step). A slow heartbeat remains for
+ * liveness. With nothing changing and nothing locked, no work is done.
  */
 
 #pragma once
 
 #include <Arduino.h>
 #include "StoveController.h"
+#include "ChangeTracker.h"
+#include "StatusSink.h"
+#include "Config.h"
 
 #define TEMP_CHANGE_THRESHOLD          3.0f
 #define TEMP_MIN_PUBLISH_INTERVAL_MS   10000UL
+#define TEMP_MAX_STALE_MS              300000UL
 #define STATUS_MIN_PUBLISH_INTERVAL_MS 300UL
+#define STATUS_HEARTBEAT_MS            60000UL
 
 class StatusPublisher {
 public:
     void publishIfChanged(const StoveStatus& s);
     void pushStatus();
-    void timerPush();
+
+    /** @brief Register the heartbeat and request the first push (before the network task starts) */
+    void begin();
+
+    /** @brief Ask for a push on the next service() call (network task) */
+    void requestPush() { mPushRequested = true; }
+
+    /** @brief Push if requested, then arm the timer for the next deadline (network task loop) */
+    void service();
+
+    /** @brief Display name of a stove state ("Working", "Off", ...) */
+    static const char* stateName(StoveRunState state);
+
+    /** @brief Send every field to one sink on the next push (after its backend reconnects) */
+    void resync(StatusSink& sink);
+
+    /**
+     * @brief Register a sink (before the network task starts)
+     * @param sink Lives for the program's lifetime; served in SinkPolicy::priority order
+     */
+    void addSink(StatusSink& sink);
+
+    /** @brief One line per sink: policy and delivery counters */
+    void printSinks(Print& out) const;
 
 private:
-    struct PublishedSnapshot {
-        int state = -1;
-        int power = -1;
-        float ambientTemp = NAN;
-        bool canShutdown = false;
-        uint32_t msRemainingToAllowShutdown = 0;
-        uint32_t lastTempPublishMs = 0;
-        uint32_t lastStatusPublishMs = 0;
-        int lastRemainMin = -1;
-    } mSnapshot;
+    /** @brief Offer the changed fields to every sink that is due */
+    void dispatch(uint8_t changed, uint32_t now);
+
+    /** @brief Milliseconds until the earliest time-driven change (UINT32_MAX if none) */
+    uint32_t nextDueMs(const StoveStatus& s, uint32_t now) const;
+
+    /** @brief (Re)arm the one-shot deadline timer, or cancel it for UINT32_MAX */
+    void armDeadline(uint32_t delayMs, uint32_t now);
+
+    /** @brief Deadline timer callback */
+    void onDeadline();
+
+    // One tracker per published channel: (deadband, min interval, max staleness)
+    ChangeTracker<int> mState{0, STATUS_MIN_PUBLISH_INTERVAL_MS, 0};
+    ChangeTracker<int> mOn{0, 0, 0};
+    ChangeTracker<int> mPower{0, STATUS_MIN_PUBLISH_INTERVAL_MS, 0};
+    ChangeTracker<float> mTemp{TEMP_CHANGE_THRESHOLD, TEMP_MIN_PUBLISH_INTERVAL_MS, TEMP_MAX_STALE_MS};
+    ChangeTracker<int> mRemainMin{0, 0, 0};
+    StatusFrame mFrame;                          ///< Latest published values, encoded
+    StatusSink* mSinks[STATUS_SINKS_MAX] = {};   ///< Registered sinks by priority
+    uint8_t mSinkCount = 0;                      ///< Entries used in mSinks
+    uint32_t mRefusalsSeen = 0;  ///< StoveStatus::shutdownRefusals already acted on
+    bool mPushRequested = false; ///< A push is due on the next service()
+    int mDeadlineTimer = -1;     ///< gTimer id of the armed one-shot (-1 = none)
+    uint32_t mDeadlineAtMs = 0;  ///< millis() the armed one-shot fires at
 };
 
 extern StatusPublisher gStatusPublisher;
@@ -0,0 +1,70 @@
+/**
+ * @file StatusSink.cpp
+ * @brief Status frame encoding implementation
+ */
+
+#include "StatusSink.h"
+#include "BufferPrint.h"
+#include "JsonWriter.h"
+
+template <typename Fn>
+void StatusFrame::encode(uint8_t field, Fn&& members) {
+    uint8_t i = index(field);
+    BufferPrint out(json[i], sizeof(json[i]));
+    JsonWriter j(out);
+    members(j);
+    jsonLen[i] = out.overflowed() ? 0 : (uint8_t)out.length();
+    valid |= field;
+}
+
+uint8_t StatusFrame::index(uint8_t field) {
+    uint8_t i = 0;
+    while (field > 1) { field >>= 1; i++; }
+    return i;
+}
+
+void StatusFrame::setState(StoveRunState s, const char* name) {
+    state = s;
+    stateName = name;
+    snprintf(text[index(SF_STATE)], sizeof(text[0]), "%d", (int)s);
+    encode(SF_STATE, [&](JsonWriter& j) {
+        j.key("state"); j.value((int)s);
+        j.key("stateName"); j.value(name);
+    });
+}
+
+void StatusFrame::setOn(bool v) {
+    on = v;
+    strlcpy(text[index(SF_ON)], v ? "1" : "0", sizeof(text[0]));
+    encode(SF_ON, [&](JsonWriter& j) { j.key("on"); j.value(v); });
+}
+
+void StatusFrame::setPower(uint8_t v) {
+    power = v;
+    snprintf(text[index(SF_POWER)], sizeof(text[0]), "%u", (unsigned)v);
+    encode(SF_POWER, [&](JsonWriter& j) { j.key("power"); j.value((unsigned)v); });
+}
+
+void StatusFrame::setTemp(float v) {
+    temp = v;
+    snprintf(text[index(SF_TEMP)], sizeof(text[0]), "%.1f", (double)v);
+    encode(SF_TEMP, [&](JsonWriter& j) { j.key("temp"); j.value(v); });
+}
+
+void StatusFrame::setTimer(int minutes) {
+    timerMin = minutes;
+    snprintf(text[index(SF_TIMER)], sizeof(text[0]), "%d", minutes);
+    encode(SF_TIMER, [&](JsonWriter& j) { j.key("timerMin"); j.value(minutes); });
+}
+
+void StatusFrame::writeJson(uint8_t mask, Print& out) const {
+    bool first = true;
+    out.write('{');
+    for (uint8_t i = 0; i < SF_COUNT; i++) {
+        if (!(mask & valid & (1 << i)) || !jsonLen[i]) continue;
+        if (!first) out.write(',');
+        out.write((const uint8_t*)json[i], jsonLen[i]);
+        first = false;
+    }
+    out.write('}');
+}
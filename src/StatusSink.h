@@ -0,0 +1,119 @@
+/**
+ * @file StatusSink.h
+ * @brief Normalized status frame and the sink interface StatusPublisher fans out to
+ *
+ * StatusPublisher decides once per push which fields changed (ChangeTracker
+ * deadbands and rate limits), encodes each changed field once into a
+ * StatusFrame (plain text and a JSON fragment) and hands the frame plus a
+ * field mask to every registered StatusSink. Sinks only pick the
+ * representation they need: Blynk writes the raw values, MQTT the text,
+ * the WebSocket stream concatenates the JSON fragments. Adding a sink adds
+ * its own I/O, not another encoding pass.
+ *
+ * Each sink carries a SinkPolicy (rate limit, coalescing, priority); the
+ * publisher keeps the per-sink bookkeeping so a sink implementation is just
+ * deliver().
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "StoveController.h"
+
+/** @brief Fields of a status frame (bit mask) */
+enum StatusField : uint8_t {
+    SF_STATE = 1 << 0,  ///< Run state (number and name)
+    SF_ON    = 1 << 1,  ///< Stove on/off
+    SF_POWER = 1 << 2,  ///< Power level
+    SF_TEMP  = 1 << 3,  ///< Ambient temperature
+    SF_TIMER = 1 << 4,  ///< Auto-shutdown minutes remaining
+};
+
+#define SF_COUNT 5
+#define SF_ALL   ((uint8_t)((1 << SF_COUNT) - 1))
+
+/**
+ * @struct StatusFrame
+ * @brief Latest published value of every field, pre-encoded for the sinks
+ */
+struct StatusFrame {
+    uint8_t valid = 0;               ///< Fields set at least once
+    StoveRunState state = STOVE_OFF; ///< SF_STATE
+    const char* stateName = "";      ///< SF_STATE display name
+    bool on = false;                 ///< SF_ON
+    uint8_t power = 0;               ///< SF_POWER
+    float temp = 0.0f;               ///< SF_TEMP
+    int timerMin = 0;                ///< SF_TIMER
+    char text[SF_COUNT][12] = {};    ///< Plain-text value per field ("4", "21.5", ...)
+    char json[SF_COUNT][40] = {};    ///< JSON members per field ("\"power\":3")
+    uint8_t jsonLen[SF_COUNT] = {};  ///< Length of each json entry
+
+    void setState(StoveRunState s, const char* name);
+    void setOn(bool v);
+    void setPower(uint8_t v);
+    void setTemp(float v);
+    void setTimer(int minutes);
+
+    /** @brief Index of a single-bit field in text/json */
+    static uint8_t index(uint8_t field);
+
+    /**
+     * @brief Write the fields in mask as one JSON object (fragments are copied, not re-encoded)
+     * @param mask Fields to include
+     * @param out Destination
+     */
+    void writeJson(uint8_t mask, Print& out) const;
+
+private:
+    /** @brief Re-encode the JSON fragment of one field with JsonWriter */
+    template <typename Fn>
+    void encode(uint8_t field, Fn&& members);
+};
+
+/**
+ * @struct SinkPolicy
+ * @brief How often and in which order a sink is served
+ */
+struct SinkPolicy {
+    uint32_t minIntervalMs; ///< Minimum time between two deliveries (0 = every push)
+    bool coalesce;          ///< true: changes during the interval are delivered (latest values)
+                            ///< after it; false: they are dropped (sampling)
+    uint8_t priority;       ///< Served in ascending order; 0 first
+};
+
+/**
+ * @class StatusSink
+ * @brief One consumer of status deltas (Blynk, MQTT, WebSocket stream, log, ...)
+ */
+class StatusSink {
+public:
+    StatusSink(const char* name, const SinkPolicy& policy) : mName(name), mPolicy(policy) {}
+    virtual ~StatusSink() {}
+
+    /**
+     * @brief Send the fields in mask
+     * @param f Frame holding the latest values and their encodings
+     * @param mask Fields that changed for this sink since its last delivery
+     */
+    virtual void deliver(const StatusFrame& f, uint8_t mask) = 0;
+
+    /** @brief Whether the backend can take a delivery now (pending fields wait otherwise) */
+    virtual bool ready() const { return true; }
+
+    const char* name() const { return mName; }
+    const SinkPolicy& policy() const { return mPolicy; }
+
+private:
+    friend class StatusPublisher;
+
+    const char* mName;           ///< Shown by 'sinks'
+    SinkPolicy mPolicy;          ///< Rate, coalescing and priority
+    uint8_t mPending = 0;        ///< Fields owed to this sink
+    bool mDelivered = false;     ///< mLastMs is valid
+    uint32_t mLastMs = 0;        ///< millis() of the last delivery
+    uint32_t mHoldUntilMs = 0;   ///< Slow-sink back-off end (see STATUS_SINK_SLOW_MS)
+    bool mHeld = false;          ///< mHoldUntilMs is in effect
+    uint32_t mLastCostMs = 0;    ///< Duration of the last deliver()
+    uint32_t mDeliveries = 0;    ///< deliver() calls
+    uint32_t mSlow = 0;          ///< Deliveries slower than STATUS_SINK_SLOW_MS
+};
@@ -10,10 +10,12 @@ StoveController::StoveController():
   _ambientTemp(0.0f),
   _physicalPower(1),
   _powerAdjustInProgress(false),
+  _powerTarget(1),
   _autoShutdownEnabled(false),
   _autoShutdownMinutes(0),
   _autoShutdownDeadlineMs(0),
-  _shutdownInProgress(false)
+  _shutdownInProgress(false),
+  _shutdownRefusals(0)
 {}
 
 void StoveController::begin(IStoveComm* comm){
@@ -79,6 +81,7 @@ bool StoveController::requestShutdown(){
   StoveStatus snap=getStatusSnapshot();
   if (!snap.canShutdown){
     logInfo("Shutdown denied (safety).");
+    _shutdownRefusals++;
     if (snap.msRemainingToAllowShutdown>0){
       if (scheduleEarliestSafeShutdown(snap.msRemainingToAllowShutdown)){
         logf("Auto-shutdown scheduled in %lu ms (≈%u min) for safe shutdown.",
@@ -125,6 +128,38 @@ void StoveController::setPowerLevel(uint8_t level){
 uint8_t StoveController::getPowerLevel() const{ return _physicalPower; }
 bool StoveController::isPowerAdjustInProgress() const{ return _powerAdjustInProgress; }
 
+bool StoveController::retargetPower(uint8_t level){
+  if (level<1) level=1;
+  if (level>5) level=5;
+  bool redirected=false;
+  xSemaphoreTake(_stateMutex, portMAX_DELAY);
+  if (_powerAdjustInProgress){
+    _powerTarget=level;
+    redirected=true;
+  }
+  xSemaphoreGive(_stateMutex);
+  if (redirected) logf("[applyTargetPower] retarget -> %u", level);
+  return redirected;
+}
+
+void StoveController::cancelPowerAdjust(){
+  bool cancelled=false;
+  xSemaphoreTake(_stateMutex, portMAX_DELAY);
+  if (_powerAdjustInProgress){
+    _powerTarget=0;
+    cancelled=true;
+  }
+  xSemaphoreGive(_stateMutex);
+  if (cancelled) logInfo("[applyTargetPower] cancelled");
+}
+
+uint8_t StoveController::currentPowerTarget(){
+  xSemaphoreTake(_stateMutex, portMAX_DELAY);
+  uint8_t t=_powerTarget;
+  xSemaphoreGive(_stateMutex);
+  return t;
+}
+
 void StoveController::applyTargetPower(uint8_t target){
   if (_shutdownInProgress) return;
   if (_powerAdjustInProgress) return;
@@ -135,27 +170,60 @@ void StoveController::applyTargetPower(uint8_t target){
 
   if (target == _physicalPower) return;
 
+  xSemaphoreTake(_stateMutex, portMAX_DELAY);
+  _powerTarget = target;
   _powerAdjustInProgress = true;
+  xSemaphoreGive(_stateMutex);
 
-  if (_comm){
-    if (target > _physicalPower){
-      uint8_t steps = (target - _physicalPower) + 1;
-      for(uint8_t i = 0; i < steps; i++){
-        _comm->writeRAM(RAM_ADDR_COMMAND, COMMAND_POWER_MINUS);
-        vTaskDelay(pdMS_TO_TICKS(600));
-      }
-    } else {
-      uint8_t steps = (_physicalPower - target) +1;
-      for(uint8_t i = 0; i < steps; i++){
-        _comm->writeRAM(RAM_ADDR_COMMAND, COMMAND_POWER_PLUS);
-        vTaskDelay(pdMS_TO_TICKS(600));
-      }
+  // Step one level at a time, re-reading the target before every press, so a
+  // retargetPower() from another task steers this adjustment instead of
+  // queueing a second one behind it.
+  uint8_t pos = _physicalPower;
+  uint32_t lastPressMs = 0;
+  bool menuOpen = false;
+  uint8_t corrections = 0;
+  while (_comm && !_shutdownInProgress){
+    uint8_t t = currentPowerTarget();
+    if (t == 0) break;  // cancelPowerAdjust()
+    if (t != pos){
+      uint8_t cmd = (t > pos) ? COMMAND_POWER_MINUS : COMMAND_POWER_PLUS;
+      if (menuOpen && millis() - lastPressMs > POWER_KEY_WAKE_MS) menuOpen = false;
+      _comm->writeRAM(RAM_ADDR_COMMAND, cmd);
+      lastPressMs = millis();
+      // The first press of a sequence only wakes the power menu.
+      if (menuOpen) pos = (t > pos) ? pos + 1 : pos - 1;
+      menuOpen = true;
+      vTaskDelay(pdMS_TO_TICKS(POWER_KEY_INTERVAL_MS));
+      continue;
     }
-    vTaskDelay(pdMS_TO_TICKS(4000));
+
+    // On target: let the stove settle, still listening for a new target.
+    uint32_t settleStart = millis();
+    while (millis() - settleStart < POWER_SETTLE_MS && currentPowerTarget() == pos){
+      vTaskDelay(pdMS_TO_TICKS(POWER_SETTLE_SLICE_MS));
+    }
+    if (currentPowerTarget() != pos) continue;
+
     syncPhysicalPower();
+    if (_physicalPower != pos && corrections++ == 0){
+      // A press was missed: step again from what the stove reports.
+      logf("[applyTargetPower] stove at %u, expected %u; correcting", _physicalPower, pos);
+      pos = _physicalPower;
+      menuOpen = false;
+      continue;
+    }
+
+    // Finish only if no retarget slipped in since the last check.
+    xSemaphoreTake(_stateMutex, portMAX_DELAY);
+    bool done = (_powerTarget == pos) || corrections > 1;
+    if (done) _powerAdjustInProgress = false;
+    xSemaphoreGive(_stateMutex);
+    if (done) return;
   }
 
+  xSemaphoreTake(_stateMutex, portMAX_DELAY);
   _powerAdjustInProgress = false;
+  xSemaphoreGive(_stateMutex);
 }
 
 
@@ -198,7 +266,12 @@ StoveStatus StoveController::getStatusSnapshot(){
   s.msSinceOn=_isOn ? (millis()-_onStartMillis) : 0;
   s.msRemainingToAllowShutdown=0;
   s.canShutdown=false;
+  s.isOn=_isOn;
+  s.powerAdjustInProgress=_powerAdjustInProgress;
+  s.shutdownRefusals=_shutdownRefusals;
+  s.takenMs=millis();
   xSemaphoreGive(_stateMutex);
+  s.autoShutdownRemainingMs=getAutoShutdownRemainingMs();
   internalUpdateShutdown(s);
   return s;
 }
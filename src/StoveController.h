@@ -56,6 +56,11 @@ struct StoveStatus {
   bool canShutdown;                       ///< Whether safe shutdown is allowed
   uint32_t msSinceOn;                     ///< Milliseconds since stove turned on
   uint32_t msRemainingToAllowShutdown;    ///< Milliseconds until safe shutdown allowed
+  bool isOn;                              ///< Stove on/off flag (see isOn())
+  bool powerAdjustInProgress;             ///< A power adjustment is running
+  uint32_t autoShutdownRemainingMs;       ///< Time left on the auto-shutdown timer (0 = none)
+  uint32_t shutdownRefusals;              ///< Shutdowns refused for safety since boot
+  uint32_t takenMs;                       ///< millis() when the snapshot was taken
 };
 
 // ============================================================================
@@ -139,6 +144,26 @@ public:
    * Only effective when stove is in WORKING state.
    */
   void setPowerLevel(uint8_t level);
+
+  /**
+   * @brief Redirect a running power adjustment to a new level
+   * @param level New target (clamped to 1-5)
+   * @return true if an adjustment was running and now heads for level;
+   *         false if none is running (queue a SET_POWER instead)
+   *
+   * Safe to call from any task. The running applyTargetPower() picks the
+   * new target up before its next key press or during its settle wait, so
+   * the stove ends at the last requested level after one adjustment.
+   */
+  bool retargetPower(uint8_t level);
+
+  /**
+   * @brief Stop a running power adjustment before its next key press
+   *
+   * Safe to call from any task; used when a shutdown is queued so it does
+   * not wait for the rest of the adjustment. No-op if none is running.
+   */
+  void cancelPowerAdjust();
   
   /**
    * @brief Get current power level
@@ -234,12 +259,14 @@ private:
   
   // Power Adjustment
   bool _powerAdjustInProgress;         ///< Power adjustment active flag
+  uint8_t _powerTarget;                ///< Level the running adjustment heads for, 0 = cancel (guarded by _stateMutex)
   
   // Auto-Shutdown
   bool _autoShutdownEnabled;           ///< Auto-shutdown enabled flag
   uint32_t _autoShutdownMinutes;       ///< Requested auto-shutdown duration
   uint32_t _autoShutdownDeadlineMs;    ///< Absolute deadline for auto-shutdown
   bool _shutdownInProgress;            ///< Shutdown sequence active flag
+  uint32_t _shutdownRefusals;          ///< Shutdowns refused for safety
   
   // ========================================================================
   // Internal Helper Methods
@@ -277,9 +304,14 @@ private:
    * @brief Apply target power level adjustments
    * @param target Target power level (1-5)
    * 
-   * Sends incremental power commands to reach target level.
+   * Sends incremental power commands to reach target level. The target is
+   * re-read before every press and while settling (see retargetPower()),
+   * and one missed press is corrected from the power read back.
    */
   void applyTargetPower(uint8_t target);
+
+  /** @brief _powerTarget read under the state mutex */
+  uint8_t currentPowerTarget();
   
   /**
    * @brief Update shutdown-related status fields
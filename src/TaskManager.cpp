@@ -6,10 +6,16 @@
 #include "TaskManager.h"
 #include "AppGlobals.h"
 #include "UIGating.h"
+#include "ThermalModel.h"
+#include "NetworkLink.h"
+#include "StatusPublisher.h"
+#include "MqttLink.h"
+#include "LocalApi.h"
+#include "UdpStatus.h"
 #include "Config.h"
+#include "Logging.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/queue.h>
 #include <time.h>
 
 void taskTerminal(void* param) {
@@ -22,19 +28,16 @@ void taskTerminal(void* param) {
 void taskComm(void* param) {
     Command cmd;
     while (true) {
-        if (xQueueReceive(gCommandQueue, &cmd, portMAX_DELAY) == pdTRUE) {
+        if (gCommandBus.take(cmd, portMAX_DELAY)) {
             switch (cmd.type) {
                 case Command::START:
                     gController.startStove();
                     break;
                     
-                case Command::SHUTDOWN: {
-                    bool ok = gController.requestShutdown();
-                    if (!ok) {
-                        uiForceSwitchOn = true;
-                    }
+                case Command::SHUTDOWN:
+                    // A refusal shows up as StoveStatus::shutdownRefusals.
+                    gController.requestShutdown();
                     break;
-                }
                 
                 case Command::SET_POWER:
                     gController.setPowerLevel(cmd.power);
@@ -51,10 +54,11 @@ void taskComm(void* param) {
                     break;
                     
                 case Command::SCHED_APPLY:
-                    gScheduler.updateEntry(cmd.schedIndex, cmd.schedActive, cmd.schedDay,
-                                          cmd.schedHour, cmd.schedMinute, cmd.schedPower);
+                    gScheduler.updateEntry(cmd.schedIndex, cmd.schedEntry);
                     break;
             }
+            gCommandBus.done();
+            publishStatus(true);
         }
     }
 }
@@ -65,40 +69,109 @@ void taskPoll(void* param) {
         gComm.simulateLoop();
 #endif
         gController.poll();
+        StoveStatus st = gController.getStatusSnapshot();
+        gThermal.addSample(millis(), st.ambientTemp, st.state, st.powerLevel);
+        gThermal.persistIfDue(millis());
+        publishStatus();
         vTaskDelay(pdMS_TO_TICKS(gController.isOn() ? POLL_INTERVAL_ON_MS : POLL_INTERVAL_OFF_MS));
     }
 }
 
+/** @brief Post a scheduled command; the scheduler never waits on the control task */
+static void postFromScheduler(const Command& c) {
+    if (gCommandBus.post(c) == CommandBus::REJECTED) {
+        logf("[SCHED] Cola llena: %s programado descartado.", CommandBus::typeName(c.type));
+    }
+}
+
 void taskScheduler(void* param) {
-    uint32_t lastMinute = 0;
+    gScheduler.setWakeTask(xTaskGetCurrentTaskHandle());
     while (true) {
-        uint32_t cur = millis() / 60000UL;
-        if (cur != lastMinute) {
-            lastMinute = cur;
-            time_t now = time(nullptr);
-            struct tm* info = localtime(&now);
-            uint8_t day = (info->tm_wday == 0) ? 7 : (uint8_t)info->tm_wday;
-            uint8_t hour = info->tm_hour;
-            uint8_t minute = info->tm_min;
-            
-            gScheduler.evaluate(day, hour, minute, gController.isOn(),
-                [](uint8_t targetPower) {
-                    if (gCommandQueue) {
-                        Command st{Command::START, 0, 0, 0, false, 0, 0, 0, 0};
-                        xQueueSend(gCommandQueue, &st, portMAX_DELAY);
-                        Command pw{Command::SET_POWER, targetPower, 0, 0, false, 0, 0, 0, 0};
-                        xQueueSend(gCommandQueue, &pw, portMAX_DELAY);
+        // The scheduler tracks its own watermark, so each wall-clock minute
+        // is evaluated exactly once no matter how long the task slept.
+        gScheduler.evaluate(time(nullptr), gController.isOn(),
+            [](ScheduleAction action, uint8_t targetPower) {
+                switch (action) {
+                    case SCHED_ACTION_START: {
+                        if (!gController.isOn()) {
+                            Command st{Command::START, 0, 0, 0, {0}};
+                            postFromScheduler(st);
+                        }
+                        Command pw{Command::SET_POWER, targetPower, 0, 0, {0}};
+                        postFromScheduler(pw);
+                        break;
+                    }
+                    case SCHED_ACTION_POWER: {
+                        if (!gController.isOn()) break;
+                        Command pw{Command::SET_POWER, targetPower, 0, 0, {0}};
+                        postFromScheduler(pw);
+                        break;
+                    }
+                    case SCHED_ACTION_SHUTDOWN: {
+                        if (!gController.isOn()) break;
+                        Command sd{Command::SHUTDOWN, 0, 0, 0, {0}};
+                        postFromScheduler(sd);
+                        break;
                     }
                 }
-            );
+            }
+        );
+        gScheduler.persistIfDue(millis());
+        // Sleep until something can fire (or a save is due); edits wake us early.
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(gScheduler.nextWakeDelayMs(time(nullptr), millis())));
+    }
+}
+
+void taskNetwork(void* param) {
+    // Owns WiFi, Blynk, MQTT, the local API, the UDP beacon and gTimer: the only task that touches BlynkWrapper.
+    setStatusListener(xTaskGetCurrentTaskHandle());
+    while (true) {
+        gNetLink.loop(millis());
+        gMqtt.loop(millis());
+        gLocalApi.loop(millis());
+        gUdpStatus.loop(millis());
+        gTimer.run();
+        gStatusPublisher.service();
+        // Sleeps one Blynk period, or less when the control tasks publish a change.
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NET_TASK_PERIOD_MS))) {
+            gStatusPublisher.requestPush();
         }
-        vTaskDelay(pdMS_TO_TICKS(2000));
     }
 }
 
+/** @brief A created task, kept for printTaskStacks() */
+struct TaskInfo {
+    const char* name;
+    uint32_t stack;
+    TaskHandle_t handle;
+};
+
+static const uint8_t TASK_COUNT = 5;
+static TaskInfo sTasks[TASK_COUNT];
+static uint8_t sTaskCount = 0;
+
+static void createTask(TaskFunction_t fn, const char* name, uint32_t stack, UBaseType_t prio, BaseType_t core) {
+    TaskHandle_t handle = nullptr;
+    xTaskCreatePinnedToCore(fn, name, stack, nullptr, prio, &handle, core);
+    if (sTaskCount < TASK_COUNT) sTasks[sTaskCount++] = {name, stack, handle};
+}
+
 void createAllTasks() {
-    xTaskCreatePinnedToCore(taskTerminal, "TaskTerminal", TASK_STACK_CTRL, nullptr, TASK_PRIO_CTRL, nullptr, 1);
-    xTaskCreatePinnedToCore(taskComm, "TaskComm", TASK_STACK_COMM, nullptr, TASK_PRIO_COMM, nullptr, 1);
-    xTaskCreatePinnedToCore(taskPoll, "TaskPoll", TASK_STACK_POLL, nullptr, TASK_PRIO_POLL, nullptr, 1);
-    xTaskCreatePinnedToCore(taskScheduler, "TaskScheduler", TASK_STACK_SCHED, nullptr, TASK_PRIO_SCHED, nullptr, 1);
+    createTask(taskTerminal, "TaskTerminal", TASK_STACK_CTRL, TASK_PRIO_CTRL, 1);
+    createTask(taskComm, "TaskComm", TASK_STACK_COMM, TASK_PRIO_COMM, 1);
+    createTask(taskPoll, "TaskPoll", TASK_STACK_POLL, TASK_PRIO_POLL, 1);
+    createTask(taskScheduler, "TaskScheduler", TASK_STACK_SCHED, TASK_PRIO_SCHED, 1);
+    // Core 0 runs the WiFi stack; a stalled connect never competes with the control tasks.
+    createTask(taskNetwork, "TaskNetwork", TASK_STACK_NET, TASK_PRIO_NET, NET_TASK_CORE);
+}
+
+void printTaskStacks(Print& out) {
+    char line[80];
+    for (uint8_t i = 0; i < sTaskCount; i++) {
+        const TaskInfo& t = sTasks[i];
+        if (!t.handle) continue;
+        snprintf(line, sizeof(line), "\r\n  %-14s pila %5lu  mínimo libre %5lu bytes", t.name,
+                 (unsigned long)t.stack, (unsigned long)uxTaskGetStackHighWaterMark(t.handle));
+        out.print(line);
+    }
 }
@@ -8,7 +8,17 @@
 #include <Arduino.h>
 
 void createAllTasks();
+
+/**
+ * @brief Print each task's stack size and the least it has had free since boot
+ * @param out Destination
+ *
+ * uxTaskGetStackHighWaterMark() counts bytes on the ESP32.
+ */
+void printTaskStacks(Print& out);
+
 void taskTerminal(void* param);
 void taskComm(void* param);
 void taskPoll(void* param);
 void taskScheduler(void* param);
+void taskNetwork(void* param);
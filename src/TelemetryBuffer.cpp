@@ -0,0 +1,52 @@
+/**
+ * @file TelemetryBuffer.cpp
+ * @brief Offline telemetry ring implementation
+ */
+
+#include "TelemetryBuffer.h"
+
+TelemetryBuffer gTelemetry;
+
+bool TelemetryBuffer::isTrendPin(uint8_t pin) {
+    switch (pin) {
+        case VPIN_STOVE_STATE_NUM:
+        case VPIN_POWER_LEVEL_READ:
+        case VPIN_AMBIENT_TEMP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void TelemetryBuffer::record(uint8_t pin, int32_t value, uint32_t nowMs) {
+    if (value > INT16_MAX) value = INT16_MAX;
+    if (value < INT16_MIN) value = INT16_MIN;
+    uint16_t slot;
+    if (mCount == TELEMETRY_BUFFER_RECORDS) {
+        slot = mHead;
+        mHead = (uint16_t)((mHead + 1) % TELEMETRY_BUFFER_RECORDS);
+        mDropped++;
+    } else {
+        slot = (uint16_t)((mHead + mCount) % TELEMETRY_BUFFER_RECORDS);
+        mCount++;
+    }
+    mRing[slot] = {nowMs, (int16_t)value, pin, 0};
+}
+
+bool TelemetryBuffer::peek(Record& out) const {
+    if (!mCount) return false;
+    out = mRing[mHead];
+    return true;
+}
+
+void TelemetryBuffer::pop() {
+    if (!mCount) return;
+    mHead = (uint16_t)((mHead + 1) % TELEMETRY_BUFFER_RECORDS);
+    mCount--;
+}
+
+uint32_t TelemetryBuffer::takeDropped() {
+    uint32_t n = mDropped;
+    mDropped = 0;
+    return n;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file TelemetryBuffer.h
+ * @brief Offline ring of timestamped trend samples, replayed after reconnect
+ *
+ * While the cloud link is down, writes to trend pins (state, power,
+ * temperature) are kept here with their millis() timestamp instead of being
+ * lost. After reconnect they are replayed oldest first, a few records per
+ * call, each stamped with its original wall-clock time so the charts have no
+ * holes. UI pins are not buffered: the reconnect resync sends their latest
+ * values. When the ring is full the oldest record is overwritten.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "Config.h"
+
+/**
+ * @class TelemetryBuffer
+ * @brief Fixed-size ring of (time, pin, value) trend records
+ */
+class TelemetryBuffer {
+public:
+    /** @brief One buffered sample */
+    struct Record {
+        uint32_t ms;      ///< millis() when the value was produced
+        int16_t value;    ///< Value written to the pin
+        uint8_t pin;      ///< Virtual pin
+        uint8_t reserved; ///< Always 0
+    };
+
+    /**
+     * @brief Whether a pin keeps its full history while offline
+     */
+    static bool isTrendPin(uint8_t pin);
+
+    /**
+     * @brief Buffer a sample (overwrites the oldest one when full)
+     */
+    void record(uint8_t pin, int32_t value, uint32_t nowMs);
+
+    /**
+     * @brief Oldest buffered record
+     * @return false if the buffer is empty
+     */
+    bool peek(Record& out) const;
+
+    /** @brief Drop the oldest record */
+    void pop();
+
+    /** @brief Number of buffered records */
+    size_t pending() const { return mCount; }
+
+    /**
+     * @brief Records overwritten since the last call (and reset the count)
+     */
+    uint32_t takeDropped();
+
+private:
+    Record mRing[TELEMETRY_BUFFER_RECORDS];  ///< Ring storage
+    uint16_t mHead = 0;                      ///< Index of the oldest record
+    uint16_t mCount = 0;                     ///< Records in the ring
+    uint32_t mDropped = 0;                   ///< Records overwritten while full
+};
+
+extern TelemetryBuffer gTelemetry;
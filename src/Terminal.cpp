@@ -2,6 +2,10 @@
 #ifdef SIMULATION_MODE
   #include "SimStoveComm.h"
 #endif
+#include "StatusPublisher.h"
+#include "CommandBus.h"
+#include "UdpStatus.h"
+#include "TaskManager.h"
 #include <WiFi.h>
 
 // Extern WiFi vars / funcs
@@ -16,15 +20,15 @@ static const uint32_t PROMPT_MIN_INTERVAL_MS = 120;
 void Terminal::printPrompt(){
   _serial->print("\r\n> ");
   _lastPromptMs=millis();
-  _cursorPos=_line.length();
+  _cursorPos=_len;
 }
 
 void Terminal::fullRefresh(){
   _serial->print("\r");
   _serial->print("\033[K");
   _serial->print("> ");
-  _serial->print(_line);
-  int tail=_line.length()-_cursorPos;
+  _serial->write((const uint8_t*)_line, _len);
+  int tail=_len-_cursorPos;
   if (tail>0) _serial->printf("\033[%dD", tail);
 }
 
@@ -36,7 +40,7 @@ void Terminal::begin(HardwareSerial* serial,
   _comm      = comm;
   _controller= controller;
   _scheduler = scheduler;
-  _line.reserve(128);
+  _len=0; _cursorPos=0; _line[0]=0;
   _serial->print("\r\n[Terminal] Ready. Type 'help'.");
   printPrompt();
   _lastKeypressMs=millis();
@@ -88,18 +92,34 @@ void Terminal::process(){
     }
 
     if (c=='\n'){
-      if (_line.length()>0){
-        String line=_line;
-        _line="";
+      if (_len>0){
+        // Trim in place; the command is then tokenized inside _line itself
+        uint16_t start=0, end=_len;
+        while (start<end && isspace((unsigned char)_line[start])) start++;
+        while (end>start && isspace((unsigned char)_line[end-1])) end--;
+        _line[end]=0;
+        _len=0;
         _cursorPos=0;
-        line.trim();
-        if (line.length()){
+        if (end>start && _importing){
+          // Records are not kept in history, and a cut one must not be applied.
+          if (_lineOverflow){
+            _importBroken=true;
+            _serial->print("\r\n[IMPORT] Registro demasiado largo, cortado.");
+          } else {
+            importLine(_line+start);
+          }
+          markCommandProcessed();
+        } else if (end>start && _lineOverflow){
+          _serial->printf("\r\nLínea demasiado larga (máx %u caracteres), ignorada.", (unsigned)LINE_MAX);
+        } else if (end>start){
           _serial->print("\r\n");
-          handleLine(line);
-          storeHistory(line);
+          storeHistory(_line+start, end-start);
+          handleLine(_line+start);
           markCommandProcessed();
         }
-        printPrompt();
+        _lineOverflow=false;
+        _line[0]=0;
+        if (!_importing) printPrompt();
       } else {
         if (millis()-_lastPromptMs > PROMPT_MIN_INTERVAL_MS) printPrompt();
       }
@@ -108,7 +128,7 @@ void Terminal::process(){
     }
 
     if (c==0x08 || c==0x7F){
-      if (c==0x7F && _cursorPos < _line.length()){
+      if (c==0x7F && _cursorPos < _len){
         deleteCharAtCursor();
       } else {
         backspaceChar();
@@ -125,7 +145,7 @@ void Terminal::process(){
 
 bool Terminal::isUserTyping() const{
   if (_quietMode) return true;
-  if (_line.length()==0) return false;
+  if (_len==0) return false;
   return (millis()-_lastKeypressMs) < 2500;
 }
 
@@ -142,22 +162,34 @@ void Terminal::setQuietMode(bool q){
 
 bool Terminal::isQuietMode() const{ return _quietMode; }
 
-void Terminal::storeHistory(const String& cmd){
-  if (cmd.isEmpty()) return;
-  if (_historyCount>0 && _history[_historyCount-1]==cmd) return;
+const char* Terminal::historyAt(int i) const{
+  return _history[(_historyHead+i)%HISTORY_SIZE];
+}
+
+void Terminal::storeHistory(const char* cmd, size_t len){
+  if (len==0) return;
+  if (len>LINE_MAX) len=LINE_MAX;
+  if (_historyCount>0){
+    const char* last=historyAt(_historyCount-1);
+    if (strlen(last)==len && memcmp(last, cmd, len)==0) return;
+  }
+  int slot;
   if (_historyCount < HISTORY_SIZE){
-    _history[_historyCount++]=cmd;
+    slot=(_historyHead+_historyCount++)%HISTORY_SIZE;
   } else {
-    for(int i=1;i<HISTORY_SIZE;i++) _history[i-1]=_history[i];
-    _history[HISTORY_SIZE-1]=cmd;
+    // Full: overwrite the oldest entry instead of shifting the others
+    slot=_historyHead;
+    _historyHead=(_historyHead+1)%HISTORY_SIZE;
   }
+  memcpy(_history[slot], cmd, len);
+  _history[slot][len]=0;
 }
 
 void Terminal::historyPrev(){
   if (_historyCount==0) return;
   if (_historyIndex<0) _historyIndex=_historyCount-1;
   else if (_historyIndex>0) _historyIndex--;
-  replaceCurrentLine(_history[_historyIndex]);
+  replaceCurrentLine(historyAt(_historyIndex));
 }
 
 void Terminal::historyNext(){
@@ -165,57 +197,55 @@ void Terminal::historyNext(){
   if (_historyIndex<0) return;
   if (_historyIndex < _historyCount-1){
     _historyIndex++;
-    replaceCurrentLine(_history[_historyIndex]);
+    replaceCurrentLine(historyAt(_historyIndex));
   } else {
     _historyIndex=-1;
     replaceCurrentLine("");
   }
 }
 
-void Terminal::replaceCurrentLine(const String& txt){
-  _line=txt;
-  _cursorPos=_line.length();
+void Terminal::replaceCurrentLine(const char* txt){
+  size_t n=strlen(txt);
+  if (n>LINE_MAX) n=LINE_MAX;
+  memcpy(_line, txt, n);
+  _line[n]=0;
+  _len=n;
+  _cursorPos=_len;
   fullRefresh();
 }
 
+void Terminal::echoTail(uint8_t erase){
+  int tail=_len-_cursorPos;
+  _serial->write((const uint8_t*)_line+_cursorPos, tail);
+  for (uint8_t i=0;i<erase;i++) _serial->write(' ');
+  if (tail+erase>0) _serial->printf("\033[%dD", tail+erase);
+}
+
 void Terminal::insertChar(char c){
-  if (_line.length()>=512) return;
-  if (_cursorPos==_line.length()){
-    _line += c;
-    _serial->write(c);
-  } else {
-    String tail=_line.substring(_cursorPos);
-    _line=_line.substring(0,_cursorPos)+c+tail;
-    _serial->write(c);
-    _serial->print(tail);
-    if (tail.length()>0)
-      _serial->printf("\033[%dD", tail.length());
-  }
-  _cursorPos++;
+  if (_len>=LINE_MAX){ _lineOverflow=true; return; }
+  memmove(_line+_cursorPos+1, _line+_cursorPos, _len-_cursorPos+1);
+  _line[_cursorPos++]=c;
+  _len++;
+  _serial->write(c);
+  if (_cursorPos<_len) echoTail(0);
   _lastKeypressMs=millis();
 }
 
 void Terminal::backspaceChar(){
-  if (_cursorPos==0 || _line.length()==0) return;
-  String tail=_line.substring(_cursorPos);
-  _line=_line.substring(0,_cursorPos-1)+tail;
+  if (_cursorPos==0 || _len==0) return;
+  memmove(_line+_cursorPos-1, _line+_cursorPos, _len-_cursorPos+1);
   _cursorPos--;
+  _len--;
   _serial->print("\033[1D");
-  _serial->print(tail);
-  _serial->print(" ");
-  int back=tail.length()+1;
-  if (back>0) _serial->printf("\033[%dD", back);
+  echoTail(1);
   _lastKeypressMs=millis();
 }
 
 void Terminal::deleteCharAtCursor(){
-  if (_cursorPos >= _line.length()) return;
-  String tail=_line.substring(_cursorPos+1);
-  _line=_line.substring(0,_cursorPos)+tail;
-  _serial->print(tail);
-  _serial->print(" ");
-  int back=tail.length()+1;
-  if (back>0) _serial->printf("\033[%dD", back);
+  if (_cursorPos >= _len) return;
+  memmove(_line+_cursorPos, _line+_cursorPos+1, _len-_cursorPos);
+  _len--;
+  echoTail(1);
   _lastKeypressMs=millis();
 }
 
@@ -227,7 +257,7 @@ void Terminal::moveCursorLeft(){
 }
 
 void Terminal::moveCursorRight(){
-  if (_cursorPos < _line.length()){
+  if (_cursorPos < _len){
     _cursorPos++;
     _serial->print("\033[1C");
   }
@@ -241,65 +271,108 @@ void Terminal::moveCursorHome(){
 }
 
 void Terminal::moveCursorEnd(){
-  int diff=_line.length()-_cursorPos;
+  int diff=_len-_cursorPos;
   if (diff>0){
     _serial->printf("\033[%dC", diff);
-    _cursorPos=_line.length();
+    _cursorPos=_len;
   }
 }
 
-void Terminal::parseArgsQuoted(const String& raw, std::vector<String>& out){
-  out.clear();
+TextSlice Terminal::takeWord(TextSlice& rest){
+  // Slices always point into _line, so the word can be terminated in place
+  char* p=_line+(rest.ptr-_line);
+  char* end=p+rest.len;
+  while (p<end && isspace((unsigned char)*p)) p++;
+  char* w=p;
+  while (p<end && !isspace((unsigned char)*p)) p++;
+  TextSlice word(w, p-w);
+  if (p<end) *p++=0;
+  rest=TextSlice(p, end-p).trimmed();
+  return word;
+}
+
+size_t Terminal::splitArgs(TextSlice raw, TextSlice* out, size_t cap){
+  // Quotes are squeezed out by copying each character down to w (w never
+  // passes r), and every argument gets a NUL after it. raw runs to the end
+  // of the line, so the last NUL lands on the line terminator at the latest.
+  if (raw.empty()) return 0;
+  char* r=_line+(raw.ptr-_line);
+  char* end=r+raw.len;
+  char* w=r;
+  char* start=w;
   bool inQuote=false;
-  String cur;
-  for (size_t i=0;i<raw.length();++i){
-    char c=raw[i];
+  size_t n=0;
+  for (; r<end; ++r){
+    char c=*r;
     if (c=='\"'){ inQuote=!inQuote; continue; }
     if (isspace((unsigned char)c) && !inQuote){
-      if (cur.length()){ out.push_back(cur); cur=""; }
-    } else cur+=c;
-  }
-  if (cur.length()) out.push_back(cur);
-}
-
-void Terminal::handleLine(String line){
-  int sp=line.indexOf(' ');
-  String cmd=(sp<0)? line : line.substring(0,sp);
-  String rest=(sp<0)? "" : line.substring(sp+1);
-  cmd.toLowerCase(); rest.trim();
-
-  if (cmd=="help") cmdHelp();
-  else if (cmd=="status") cmdStatus();
-  else if (cmd=="ram") cmdRam(rest);
-  else if (cmd=="eeprom") cmdEE(rest);
-  else if (cmd=="on") cmdOn();
-  else if (cmd=="off") cmdOff();
-  else if (cmd=="power") cmdPower(rest);
-  else if (cmd=="timer") cmdTimer(rest);
-  else if (cmd=="auto" && rest=="off") cmdAutoOff();
-  else if (cmd=="sched"){
-    if (rest.startsWith("list")) cmdSchedList();
-    else if (rest.startsWith("summary")) cmdSchedSummary();
-    else if (rest.startsWith("set")){
-      String sub=rest.substring(3); sub.trim();
-      cmdSchedSet(sub);
-    } else _serial->print("\r\nUsage: sched list | sched summary | sched set <idx> <active> <day> <hour> <min> <power>");
-  }
-  else if (cmd=="clear") cmdClear();
-  else if (cmd=="temp") cmdTemp();
-  else if (cmd=="quiet") cmdQuiet(rest);
-  else if (cmd=="wifi") cmdWifi(rest);
-  else if (cmd=="reboot"){
+      if (w>start){
+        if (n<cap) out[n]=TextSlice(start, w-start);
+        n++;
+        *w++=0;
+      }
+      start=w;
+    } else *w++=c;
+  }
+  if (w>start){
+    if (n<cap) out[n]=TextSlice(start, w-start);
+    n++;
+  }
+  *w=0;
+  return n>cap ? cap+1 : n;
+}
+
+void Terminal::handleLine(char* line){
+  TextSlice rest(line);
+  TextSlice cmd=takeWord(rest);
+  for (size_t i=0;i<cmd.len;i++) line[i]=(char)tolower((unsigned char)line[i]);
+
+  if (cmd.equals("help")) cmdHelp();
+  else if (cmd.equals("status")) cmdStatus();
+  else if (cmd.equals("ram")) cmdRam(rest);
+  else if (cmd.equals("eeprom")) cmdEE(rest);
+  else if (cmd.equals("on")) cmdOn();
+  else if (cmd.equals("off")) cmdOff();
+  else if (cmd.equals("power")) cmdPower(rest);
+  else if (cmd.equals("timer")) cmdTimer(rest);
+  else if (cmd.equals("auto") && rest.equals("off")) cmdAutoOff();
+  else if (cmd.equals("sched")){
+    TextSlice sub=takeWord(rest);
+    if (sub.equals("list")) cmdSchedList();
+    else if (sub.equals("summary")) cmdSchedSummary();
+    else if (sub.equals("save")){ _scheduler->flush(); _serial->print("\r\nSchedule saved."); }
+    else if (sub.equals("set")) cmdSchedSet(rest);
+    else if (sub.equals("window")) cmdSchedWindow(rest);
+    else if (sub.equals("cron")) cmdSchedCron(rest);
+    else if (sub.equals("preheat")) cmdSchedPreheat(rest);
+    else if (sub.equals("next")) cmdSchedNext(rest);
+    else if (sub.equals("sim")) cmdSchedSim(rest);
+    else if (sub.equals("export")) cmdSchedExport();
+    else if (sub.equals("import")) cmdSchedImport(rest);
+    else _serial->print("\r\nUsage: sched list | sched summary | sched save | sched set ... | sched window ... | sched cron ... | sched preheat ... | sched next [n] | sched sim [days] | sched export | sched import ...");
+  }
+  else if (cmd.equals("thermal")) cmdThermal(rest);
+  else if (cmd.equals("clear")) cmdClear();
+  else if (cmd.equals("temp")) cmdTemp();
+  else if (cmd.equals("quiet")) cmdQuiet(rest);
+  else if (cmd.equals("wifi")) cmdWifi(rest);
+  else if (cmd.equals("mqtt")) cmdMqtt(rest);
+  else if (cmd.equals("api")) cmdApi(rest);
+  else if (cmd.equals("sinks")) cmdSinks();
+  else if (cmd.equals("queue")) cmdQueue();
+  else if (cmd.equals("tasks")) cmdTasks();
+  else if (cmd.equals("reboot")){
+    _scheduler->flush();
     _serial->print("\r\nReinicio...");
     delay(150);
     ESP.restart();
   }
 #ifdef SIMULATION_MODE
-  else if (cmd=="simstate") cmdSimState(rest);
-  else if (cmd=="simpower") cmdSimPower(rest);
-  else if (cmd=="simtemp")  cmdSimTemp(rest);
-  else if (cmd=="simfail")  cmdSimFail();
-  else if (cmd=="simrecover") cmdSimRecover();
+  else if (cmd.equals("simstate")) cmdSimState(rest);
+  else if (cmd.equals("simpower")) cmdSimPower(rest);
+  else if (cmd.equals("simtemp"))  cmdSimTemp(rest);
+  else if (cmd.equals("simfail"))  cmdSimFail();
+  else if (cmd.equals("simrecover")) cmdSimRecover();
 #endif
   else _serial->print("\r\nUnknown. Type 'help'.");
 }
@@ -315,8 +388,20 @@ void Terminal::cmdHelp(){
   _serial->print("\r\n  timer <min> | timer status | timer cancel");
   _serial->print("\r\n  auto off");
   _serial->print("\r\n  temp");
-  _serial->print("\r\n  sched list | sched summary | sched set i act day hour min power");
+  _serial->print("\r\n  sched list | sched summary | sched save | sched set i act days hour min power [start|power|off] [grace]");
+  _serial->print("\r\n  sched window i days HH:MM HH:MM power | sched window i clear");
+  _serial->print("\r\n  sched cron i <min> <hour> <dom> <mon> <dow> <start|power|off> [power] | sched cron i clear");
+  _serial->print("\r\n  sched preheat i days HH:MM temp power | sched preheat i clear");
+  _serial->print("\r\n  sched next [n] | sched sim [days]");
+  _serial->print("\r\n  sched export | sched import <rec>;<rec>;...  (whole table, applied all-or-nothing)");
+  _serial->print("\r\n  sched import begin  (then paste the export, one record per line; end | abort)");
+  _serial->print("\r\n  thermal | thermal reset");
   _serial->print("\r\n  wifi show | set \"SSID con espacios\" \"PASS opcional\" | reconnect | save | erase");
+  _serial->print("\r\n  mqtt show | set <host> [port] [user] [pass] | off");
+  _serial->print("\r\n  api show | token <secreto> | token clear");
+  _serial->print("\r\n  sinks");
+  _serial->print("\r\n  queue");
+  _serial->print("\r\n  tasks");
   _serial->print("\r\n  reboot");
   _serial->print("\r\n  quiet <on|off>");
 #ifdef SIMULATION_MODE
@@ -336,17 +421,17 @@ void Terminal::cmdStatus(){
   timerShowStatus();
 }
 
-void Terminal::cmdRam(const String& arg){
-  if (arg.isEmpty()){ _serial->print("\r\nUsage: ram <addr>"); return; }
-  uint8_t addr=(uint8_t)strtol(arg.c_str(), nullptr, 0);
+void Terminal::cmdRam(TextSlice arg){
+  if (arg.empty()){ _serial->print("\r\nUsage: ram <addr>"); return; }
+  uint8_t addr=(uint8_t)arg.toInt(0, 0);
   uint8_t buf[64]; int len=_comm->readRAM(addr, buf);
   _serial->printf("\r\nRAM 0x%02X len=%d", addr, len);
   for(int i=0;i<len;i++) _serial->printf("\r\n [%d]=0x%02X", i, buf[i]);
 }
 
-void Terminal::cmdEE(const String& arg){
-  if (arg.isEmpty()){ _serial->print("\r\nUsage: eeprom <addr>"); return; }
-  uint8_t addr=(uint8_t)strtol(arg.c_str(), nullptr, 0);
+void Terminal::cmdEE(TextSlice arg){
+  if (arg.empty()){ _serial->print("\r\nUsage: eeprom <addr>"); return; }
+  uint8_t addr=(uint8_t)arg.toInt(0, 0);
   uint8_t buf[16]; int len=_comm->readEEPROM(addr, buf);
   _serial->printf("\r\nEEPROM 0x%02X len=%d", addr, len);
   for(int i=0;i<len;i++) _serial->printf("\r\n [%d]=0x%02X", i, buf[i]);
@@ -358,15 +443,16 @@ void Terminal::cmdOff(){
   else _serial->print("\r\nShutdown sequence initiated.");
 }
 
-void Terminal::cmdPower(const String& arg){
-  if (arg.isEmpty()){ _serial->print("\r\nUsage: power <1..5>"); return; }
+void Terminal::cmdPower(TextSlice arg){
+  if (arg.empty()){ _serial->print("\r\nUsage: power <1..5>"); return; }
   uint8_t p=(uint8_t)arg.toInt();
+  if (_controller->retargetPower(p)){ _serial->printf("\r\nPower target=%u (ajuste en curso redirigido)", p); return; }
   _controller->setPowerLevel(p);
   _serial->printf("\r\nPower target=%u", p);
 }
 
-void Terminal::cmdTimer(const String& rest){
-  if (rest.isEmpty()){
+void Terminal::cmdTimer(TextSlice rest){
+  if (rest.empty()){
     _serial->print("\r\nUsage: timer <min> | timer status | timer cancel");
     return;
   }
@@ -416,44 +502,255 @@ void Terminal::cmdAutoOff(){ _controller->disableAutoShutdown(); _serial->print(
 
 void Terminal::cmdSchedList(){
   _serial->print("\r\n---- Scheduler ----\r\n");
-  String sum=_scheduler->buildSummary();
-  _serial->print(sum);
+  _scheduler->writeSummary(*_serial);
 }
 
 void Terminal::cmdSchedSummary(){
   _serial->print("\r\n---- Summary ----\r\n");
-  String sum=_scheduler->buildSummary();
-  _serial->print(sum);
+  _scheduler->writeSummary(*_serial);
 }
 
-bool Terminal::parseSixInts(const String& rest,int out[6]){
-  int filled=0; String tmp=rest;
-  while(tmp.length() && filled<6){
-    int sp=tmp.indexOf(' ');
-    String tok=(sp<0)?tmp:tmp.substring(0,sp);
-    tok.trim();
-    if (tok.length()) out[filled++]=tok.toInt();
-    if (sp<0) break;
-    tmp=tmp.substring(sp+1); tmp.trim();
+void Terminal::cmdSchedSet(TextSlice rest){
+  TextSlice tok[MAX_ARGS];
+  size_t n=splitArgs(rest, tok, MAX_ARGS);
+  if (n<6 || n>8){
+    _serial->print("\r\nUsage: sched set <idx> <active> <days> <hour> <minute> <power> [start|power|off] [grace_min]");
+    _serial->print("\r\n  days: 1..7 | 1-5 | 1,3,5 | mon-fri | sat,sun | weekdays | weekend | all | 0x1F");
+    return;
+  }
+  uint8_t mask=0;
+  if (!Scheduler::parseDayMask(tok[2].ptr, mask)){
+    _serial->print("\r\nDías inválidos.");
+    return;
   }
-  return filled==6;
+  ScheduleAction action=SCHED_ACTION_START;
+  if (n>=7 && !Scheduler::parseAction(tok[6].ptr, action)){
+    _serial->print("\r\nAcción inválida (start|power|off).");
+    return;
+  }
+  long grace=(n==8) ? tok[7].toInt() : SCHED_DEFAULT_GRACE_MIN;
+  if (grace<0 || grace>SCHED_MAX_GRACE_MIN){
+    _serial->printf("\r\nMargen inválido (0..%d min).", SCHED_MAX_GRACE_MIN);
+    return;
+  }
+  if(!_scheduler->updateEntry(tok[0].toInt(), tok[1].toInt()!=0, mask,(uint8_t)tok[3].toInt(),
+                              (uint8_t)tok[4].toInt(),(uint8_t)tok[5].toInt(), action, (uint8_t)grace)){
+    _serial->print("\r\nUpdate failed (rangos inválidos).");
+    return;
+  }
+  _serial->print("\r\nSchedule updated.");
 }
 
-void Terminal::cmdSchedSet(const String& rest){
-  int vals[6];
-  if(!parseSixInts(rest, vals)){
-    _serial->print("\r\nUsage: sched set <idx> <active> <day> <hour> <minute> <power>");
+void Terminal::cmdSchedWindow(TextSlice rest){
+  TextSlice tok[MAX_ARGS];
+  size_t n=splitArgs(rest, tok, MAX_ARGS);
+  if (n==2 && tok[1].equals("clear")){
+    if (!_scheduler->clearWindow(tok[0].toInt())){
+      _serial->printf("\r\nÍndice inválido (0..%d).", MAX_SCHEDULE_WINDOWS-1);
+      return;
+    }
+    _serial->print("\r\nWindow cleared.");
+    return;
+  }
+  if (n!=5){
+    _serial->print("\r\nUsage: sched window <idx> <days> <HH:MM> <HH:MM> <power> | sched window <idx> clear");
+    _serial->print("\r\n  end <= start runs past midnight, e.g. 22:00 06:00");
+    return;
+  }
+  uint8_t mask=0;
+  if (!Scheduler::parseDayMask(tok[1].ptr, mask)){
+    _serial->print("\r\nDías inválidos.");
     return;
   }
-  if (vals[2]==0){
-    _serial->print("\r\n[Info] day=0 interpretado como Domingo (7).");
-    vals[2]=7;
+  uint16_t start=0, end=0;
+  if (!Scheduler::parseClock(tok[2].ptr, start) || !Scheduler::parseClock(tok[3].ptr, end)){
+    _serial->print("\r\nHora inválida (HH:MM).");
+    return;
   }
-  if(!_scheduler->updateEntry(vals[0], vals[1]!=0,(uint8_t)vals[2],(uint8_t)vals[3],(uint8_t)vals[4],(uint8_t)vals[5])){
+  if (!_scheduler->updateWindow(tok[0].toInt(), mask, start, end, (uint8_t)tok[4].toInt())){
     _serial->print("\r\nUpdate failed (rangos inválidos).");
     return;
   }
-  _serial->print("\r\nSchedule updated.");
+  _serial->print("\r\nWindow updated.");
+}
+
+void Terminal::cmdSchedCron(TextSlice rest){
+  TextSlice idx=takeWord(rest);
+  if (idx.empty() || rest.empty()){
+    _serial->print("\r\nUsage: sched cron <idx> <min> <hour> <dom> <mon> <dow> <start|power|off> [power] | sched cron <idx> clear");
+    _serial->print("\r\n  e.g. sched cron 0 */30 17-21 * * sat,sun power 2");
+    return;
+  }
+  if (!_scheduler->setCronRule(idx.toInt(), rest.ptr)){
+    _serial->print("\r\nRegla inválida.");
+    return;
+  }
+  CronRule r=_scheduler->getCronRule(idx.toInt());
+  if (r.isEmpty()){
+    _serial->print("\r\nCron rule cleared.");
+    return;
+  }
+  char text[SCHED_CRON_TEXT_MAX];
+  Scheduler::formatCron(r, text, sizeof(text));
+  _serial->printf("\r\nCron rule set: %s", text);
+}
+
+void Terminal::cmdSchedPreheat(TextSlice rest){
+  TextSlice tok[MAX_ARGS];
+  size_t n=splitArgs(rest, tok, MAX_ARGS);
+  if (n==2 && tok[1].equals("clear")){
+    if (!_scheduler->clearPreheat(tok[0].toInt())){
+      _serial->printf("\r\nÍndice inválido (0..%d).", MAX_PREHEAT_RULES-1);
+      return;
+    }
+    _serial->print("\r\nPre-heat rule cleared.");
+    return;
+  }
+  if (n!=5){
+    _serial->print("\r\nUsage: sched preheat <idx> <days> <HH:MM> <temp_C> <power> | sched preheat <idx> clear");
+    _serial->print("\r\n  e.g. sched preheat 0 weekdays 07:00 21 4  (warm to 21 C by 07:00)");
+    return;
+  }
+  uint8_t mask=0;
+  if (!Scheduler::parseDayMask(tok[1].ptr, mask)){
+    _serial->print("\r\nDías inválidos.");
+    return;
+  }
+  uint16_t at=0;
+  if (!Scheduler::parseClock(tok[2].ptr, at)){
+    _serial->print("\r\nHora inválida (HH:MM).");
+    return;
+  }
+  if (!_scheduler->updatePreheat(tok[0].toInt(), mask, at, tok[3].toFloat(), (uint8_t)tok[4].toInt())){
+    _serial->print("\r\nUpdate failed (rangos inválidos, temp 5..35).");
+    return;
+  }
+  _serial->print("\r\nPre-heat rule updated.");
+}
+
+void Terminal::cmdSchedNext(TextSlice rest){
+  time_t now=time(nullptr);
+  if (now<SCHED_TIME_VALID_EPOCH){ _serial->print("\r\nReloj no sincronizado."); return; }
+  int n=rest.empty() ? 10 : rest.toInt();
+  if (n<1 || n>SCHED_NEXT_MAX_EVENTS){
+    _serial->printf("\r\nUsage: sched next [1..%d]", SCHED_NEXT_MAX_EVENTS);
+    return;
+  }
+  if (!_scheduler->isGlobalEnabled()){ _serial->print("\r\nScheduler DISABLED."); return; }
+  ScheduleEvent ev[SCHED_NEXT_MAX_EVENTS];
+  ScheduleProjector proj(*_scheduler);
+  size_t got=proj.nextEvents(now, ev, (size_t)n);
+  _serial->print("\r\n---- Next events ----");
+  char line[64];
+  for(size_t i=0;i<got;i++){
+    ScheduleProjector::formatEvent(ev[i], line, sizeof(line));
+    _serial->print("\r\n");
+    _serial->print(line);
+  }
+  if (!got) _serial->print("\r\n(nothing in the next 7 days)");
+}
+
+void Terminal::cmdSchedSim(TextSlice rest){
+  time_t now=time(nullptr);
+  if (now<SCHED_TIME_VALID_EPOCH){ _serial->print("\r\nReloj no sincronizado."); return; }
+  int days=rest.empty() ? 7 : rest.toInt();
+  if (days<1 || days>SCHED_SIM_MAX_DAYS){
+    _serial->printf("\r\nUsage: sched sim [1..%d]", SCHED_SIM_MAX_DAYS);
+    return;
+  }
+  StoveStatus st=_controller->getStatusSnapshot();
+  bool on=_controller->isOn();
+  _serial->printf("\r\n---- Dry run: %d days ----", days);
+  ScheduleProjector proj(*_scheduler);
+  ScheduleSimReport rep=proj.dryRun(now, (uint16_t)days, on, st.powerLevel, on ? st.msSinceOn : 0, _serial);
+  _serial->printf("\r\nevents=%lu starts=%lu shutdowns=%lu power=%lu no-effect=%lu",
+                  (unsigned long)rep.events, (unsigned long)rep.starts, (unsigned long)rep.shutdowns,
+                  (unsigned long)rep.powerChanges, (unsigned long)rep.noEffect);
+  _serial->printf("\r\nconflicts=%lu overlaps=%lu on=%luh%02lum (%lu ms)",
+                  (unsigned long)rep.conflicts, (unsigned long)rep.overlaps,
+                  (unsigned long)(rep.onMinutes/60), (unsigned long)(rep.onMinutes%60),
+                  (unsigned long)rep.elapsedMs);
+}
+
+void Terminal::cmdSchedExport(){
+  _serial->print("\r\n");
+  if (!_scheduler->exportTable(*_serial)) _serial->print("ERR: regla cron no exportable.");
+}
+
+/** @brief Records of an open multi-line import, ';'-joined (one table's worth) */
+static char sImportBuf[SCHED_SUMMARY_MAX_LEN];
+
+void Terminal::importLine(const char* line){
+  if (!strcasecmp(line,"abort")){
+    _importing=false;
+    _serial->print("\r\n[IMPORT] Cancelado; programa sin cambios.");
+    printPrompt();
+    return;
+  }
+  if (!strcasecmp(line,"end")){
+    _importing=false;
+    if (_importBroken){
+      _serial->print("\r\n[IMPORT] Registros cortados o tabla demasiado larga; programa sin cambios.");
+    } else if (_importLines==0){
+      _serial->print("\r\n[IMPORT] Sin registros; programa sin cambios.");
+    } else {
+      ScheduleImportResult res;
+      if (!_scheduler->importTable(sImportBuf, res)){
+        _serial->printf("\r\nRegistro %u inválido (%s); programa sin cambios.", (unsigned)res.record, res.error);
+      } else {
+        _serial->printf("\r\nSchedule imported (%u records).", (unsigned)res.applied);
+      }
+    }
+    printPrompt();
+    return;
+  }
+  size_t len=strlen(line);
+  if (_importBroken) return;
+  if (_importLen+(_importLen?1:0)+len>=sizeof(sImportBuf)){
+    _importBroken=true;
+    _serial->print("\r\n[IMPORT] Tabla demasiado larga; 'end' no aplicará nada.");
+    return;
+  }
+  if (_importLen) sImportBuf[_importLen++]=';';
+  memcpy(sImportBuf+_importLen,line,len+1);
+  _importLen+=len;
+  _importLines++;
+}
+
+void Terminal::cmdSchedImport(TextSlice rest){
+  if (rest.equals("begin")){
+    // One record per line, as 'sched export' prints them; pasted or typed.
+    _importing=true;
+    _importBroken=false;
+    _importLen=0;
+    _importLines=0;
+    sImportBuf[0]=0;
+    _serial->print("\r\n[IMPORT] Pega o escribe un registro por línea; 'end' aplica, 'abort' cancela.");
+    return;
+  }
+  if (rest.empty()){
+    _serial->print("\r\nUsage: sched import <rec>;<rec>;...  |  sched import begin (one record per line, then end)");
+    _serial->print("\r\n  e.g. sched import clear;G 1;E 0 1 weekdays 06:30 start 3 10;W 0 weekend 09:00 23:00 2");
+    _serial->print("\r\n  records: clear | G 0|1 | E i act days HH:MM action power grace | W i days HH:MM HH:MM power");
+    _serial->print("\r\n           C i <cron> action [power] | P i days HH:MM temp power | E|W|C|P i clear");
+    return;
+  }
+  ScheduleImportResult res;
+  if (!_scheduler->importTable(rest.ptr, res)){
+    _serial->printf("\r\nRegistro %u inválido (%s); programa sin cambios.", (unsigned)res.record, res.error);
+    return;
+  }
+  _serial->printf("\r\nSchedule imported (%u records).", (unsigned)res.applied);
+}
+
+void Terminal::cmdThermal(TextSlice rest){
+  if (rest.equals("reset")){
+    gThermal.reset();
+    _serial->print("\r\nModelo térmico reiniciado.");
+    return;
+  }
+  _serial->print("\r\n---- Thermal model ----\r\n");
+  gThermal.writeSummary(*_serial);
 }
 
 void Terminal::cmdTemp(){
@@ -466,58 +763,72 @@ void Terminal::cmdTemp(){
 
 void Terminal::cmdClear(){
   _serial->print("\033[2J\033[H");
-  _line="";
+  _len=0;
   _cursorPos=0;
+  _line[0]=0;
   printPrompt();
 }
 
-void Terminal::cmdQuiet(const String& arg){
+void Terminal::cmdQuiet(TextSlice arg){
   if (arg.equalsIgnoreCase("on")) setQuietMode(true);
   else if (arg.equalsIgnoreCase("off")) setQuietMode(false);
   else _serial->print("\r\nUsage: quiet <on|off>");
 }
 
-void Terminal::cmdWifi(const String& rest){
-  if (rest=="show"){
-    _serial->printf("\r\n[WiFi] SSID: %s", gWiFiMgr.getSsid().c_str());
-    _serial->printf("\r\n[WiFi] PASS: %s", gWiFiMgr.getPassword().c_str());
+void Terminal::cmdWifi(TextSlice rest){
+  if (rest.equals("show")){
+    char ssid[WiFiManager::SSID_MAX+1], pass[WiFiManager::PASS_MAX+1];
+    gWiFiMgr.copyCredentials(ssid, sizeof(ssid), pass, sizeof(pass));
+    _serial->printf("\r\n[WiFi] SSID: %s", ssid);
+    _serial->printf("\r\n[WiFi] PASS: %s", pass);
     _serial->printf("\r\n[WiFi] Estado: %s", WiFi.status()==WL_CONNECTED?"CONECTADO":"NO CONECTADO");
+    _serial->printf("\r\n[NET] Enlace: %s", NetworkLink::stateName(gNetLink.state()));
     _serial->print("\r\nUso: wifi set \"SSID con espacios\" \"PASS opcional\" | wifi reconnect | wifi save | wifi erase");
     return;
   }
   if (rest.startsWith("set ")){
-    String args=rest.substring(4);
-    std::vector<String> tokens;
-    parseArgsQuoted(args, tokens);
-    if (tokens.size()<1){
+    TextSlice args=rest;
+    takeWord(args);
+    TextSlice tokens[MAX_ARGS];
+    size_t n=splitArgs(args, tokens, MAX_ARGS);
+    if (n<1 || n>MAX_ARGS){
       _serial->print("\r\nUso: wifi set \"SSID\" \"PASS opcional\"");
       return;
     }
-    gWiFiMgr.setSsid(tokens[0]);
-    if (tokens.size()>1){
-      String pass;
-      for(size_t i=1;i<tokens.size();++i){
-        if (i>1) pass+=" ";
-        pass+=tokens[i];
+    // Without a new passphrase the current one stays.
+    char current[WiFiManager::PASS_MAX+1], ssid[WiFiManager::SSID_MAX+1];
+    gWiFiMgr.copyCredentials(ssid, sizeof(ssid), current, sizeof(current));
+    const char* pass=current;
+    if (n>1){
+      // Join the password words back with single spaces, in place: each
+      // word only ever moves left, over the gap before it
+      char* dst=_line+(tokens[1].ptr-_line)+tokens[1].len;
+      for(size_t i=2;i<n;++i){
+        *dst++=' ';
+        memmove(dst, tokens[i].ptr, tokens[i].len);
+        dst+=tokens[i].len;
       }
-      gWiFiMgr.setPassword(pass);
+      *dst=0;
+      pass=tokens[1].ptr;
+    }
+    if (!gWiFiMgr.setCredentials(tokens[0].ptr, pass)){
+      _serial->print("\r\n[WiFi] SSID (máx 32) o clave (máx 64) demasiado largos.");
+      return;
     }
     _serial->print("\r\n[WiFi] Credenciales en RAM. Usa 'wifi reconnect' o 'wifi save'.");
     return;
   }
-  if (rest=="reconnect"){
-    _serial->print("\r\n[WiFi] Reconectando...");
-    WiFi.disconnect(true);
-    if (gWiFiMgr.connect()) _serial->print("\r\n[WiFi] Reconexión OK.");
-    else _serial->print("\r\n[WiFi] Reconexión FAIL.");
+  if (rest.equals("reconnect")){
+    gNetLink.requestReconnect();
+    _serial->print("\r\n[WiFi] Reconexión solicitada (ver 'wifi show').");
     return;
   }
-  if (rest=="save"){
-    gWiFiMgr.saveCredentials(gWiFiMgr.getSsid(), gWiFiMgr.getPassword());
+  if (rest.equals("save")){
+    gWiFiMgr.saveCredentials();
     _serial->print("\r\n[WiFi] Guardado en NVS. (Reboot para ciclo completo).");
     return;
   }
-  if (rest=="erase"){
+  if (rest.equals("erase")){
     gWiFiMgr.eraseCredentials();
     _serial->print("\r\n[WiFi] Borrado. Tras reboot volverá a defaults.");
     return;
@@ -525,19 +836,95 @@ void Terminal::cmdWifi(const String& rest){
   _serial->print("\r\nUso: wifi show | set \"SSID\" \"PASS\" | reconnect | save | erase");
 }
 
+void Terminal::cmdMqtt(TextSlice rest){
+  if (rest.equals("show") || rest.empty()){
+    gMqtt.printStatus(*_serial);
+    return;
+  }
+  if (rest.startsWith("set ")){
+    TextSlice args=rest;
+    takeWord(args);
+    TextSlice tokens[MAX_ARGS];
+    size_t n=splitArgs(args, tokens, MAX_ARGS);
+    if (n<1){
+      _serial->print("\r\nUso: mqtt set <host> [port] [user] [pass]");
+      return;
+    }
+    long port=n>1 ? tokens[1].toInt() : MQTT_PORT_DEFAULT;
+    if (port<1 || port>65535){
+      _serial->print("\r\n[MQTT] Puerto inválido.");
+      return;
+    }
+    gMqtt.saveConfig(tokens[0].ptr, (uint16_t)port,
+                     n>2 ? tokens[2].ptr : "",
+                     n>3 ? tokens[3].ptr : "");
+    _serial->print("\r\n[MQTT] Guardado; reconectando (ver 'mqtt show').");
+    return;
+  }
+  if (rest.equals("off")){
+    gMqtt.saveConfig("", MQTT_PORT_DEFAULT, "", "");
+    _serial->print("\r\n[MQTT] Desactivado.");
+    return;
+  }
+  _serial->print("\r\nUso: mqtt show | set <host> [port] [user] [pass] | off");
+}
+
+void Terminal::cmdApi(TextSlice rest){
+  if (rest.equals("show") || rest.empty()){
+    gLocalApi.printStatus(*_serial);
+    return;
+  }
+  if (rest.equals("token clear")){
+    gLocalApi.saveToken("");
+    _serial->print("\r\n[API] Token borrado; la API solo admite lecturas.");
+    return;
+  }
+  if (rest.startsWith("token ")){
+    TextSlice args=rest;
+    takeWord(args);
+    TextSlice tokens[MAX_ARGS];
+    size_t n=splitArgs(args, tokens, MAX_ARGS);
+    if (n!=1 || tokens[0].len<8 || tokens[0].len>LOCAL_API_TOKEN_MAX){
+      _serial->print("\r\n[API] El token debe ser una palabra de 8 a ");
+      _serial->print(LOCAL_API_TOKEN_MAX);
+      _serial->print(" caracteres.");
+      return;
+    }
+    gLocalApi.saveToken(tokens[0].ptr);
+    _serial->print("\r\n[API] Token guardado.");
+    return;
+  }
+  _serial->print("\r\nUso: api show | token <secreto> | token clear");
+}
+
+void Terminal::cmdSinks(){
+  _serial->print("\r\n[STATUS] Sinks:");
+  gStatusPublisher.printSinks(*_serial);
+  gUdpStatus.printStatus(*_serial);
+}
+
+void Terminal::cmdQueue(){
+  gCommandBus.printStatus(*_serial);
+}
+
+void Terminal::cmdTasks(){
+  _serial->print("\r\n[TASKS] Pilas (mínimo libre desde el arranque):");
+  printTaskStacks(*_serial);
+}
+
 #ifdef SIMULATION_MODE
-void Terminal::cmdSimState(const String& arg){
-  if(arg.isEmpty()){ _serial->print("\r\nUsage: simstate <code>"); return; }
+void Terminal::cmdSimState(TextSlice arg){
+  if(arg.empty()){ _serial->print("\r\nUsage: simstate <code>"); return; }
   SimStoveComm* sim=(SimStoveComm*)_comm;
   sim->forceState((uint8_t)arg.toInt());
 }
-void Terminal::cmdSimPower(const String& arg){
-  if(arg.isEmpty()){ _serial->print("\r\nUsage: simpower <1..5>"); return; }
+void Terminal::cmdSimPower(TextSlice arg){
+  if(arg.empty()){ _serial->print("\r\nUsage: simpower <1..5>"); return; }
   SimStoveComm* sim=(SimStoveComm*)_comm;
   sim->forcePower((uint8_t)arg.toInt());
 }
-void Terminal::cmdSimTemp(const String& arg){
-  if(arg.isEmpty()){ _serial->print("\r\nUsage: simtemp <C>"); return; }
+void Terminal::cmdSimTemp(TextSlice arg){
+  if(arg.empty()){ _serial->print("\r\nUsage: simtemp <C>"); return; }
   SimStoveComm* sim=(SimStoveComm*)_comm;
   sim->forceTempBase(arg.toInt());
 }
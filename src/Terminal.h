@@ -10,11 +10,16 @@
 #pragma once
 
 #include <Arduino.h>
-#include <vector>
 #include "IStoveComm.h"
 #include "StoveController.h"
 #include "Scheduler.h"
 #include "WiFiManager.h"
+#include "NetworkLink.h"
+#include "MqttLink.h"
+#include "LocalApi.h"
+#include "ThermalModel.h"
+#include "ScheduleProjector.h"
+#include "TextSlice.h"
 #include "Config.h"
 
 /**
@@ -27,12 +32,21 @@
  * - Backspace and delete support
  * - Quiet mode for reduced output
  * - Comprehensive command set for stove control and diagnostics
+ *
+ * No heap is used after begin(): the line being edited is a fixed char
+ * buffer changed in place with memmove, history is a ring of fixed slots,
+ * and commands are tokenized into TextSlice views of the line. Argument
+ * slices handed to cmd*() always end at a NUL (the tokenizers terminate
+ * words in place), so their ptr can go straight to C parsers.
  * 
  * Commands include:
  * - Status monitoring (status, temp, ram, eeprom)
  * - Control operations (on, off, power, timer)
- * - Scheduler management (sched_list, sched_set)
+ * - Scheduler management (sched_list, sched_set, sched_window, sched_cron, sched_preheat,
+ *   sched_next, sched_sim)
+ * - Thermal model inspection (thermal)
  * - WiFi configuration (wifi_set)
+ * - Local API token (api)
  * - Simulation controls (when SIMULATION_MODE enabled)
  */
 class Terminal {
@@ -112,16 +126,26 @@ private:
   Scheduler*       _scheduler = nullptr;   ///< Scheduler instance
   
   // Line Editing State
-  String   _line;                          ///< Current input line buffer
-  int      _cursorPos = 0;                 ///< Current cursor position
+  static const uint16_t LINE_MAX = 255;    ///< Longest input line (characters)
+  char     _line[LINE_MAX + 1];            ///< Current input line (NUL-terminated)
+  uint16_t _len = 0;                       ///< Characters in _line
+  uint16_t _cursorPos = 0;                 ///< Current cursor position
   uint32_t _lastKeypressMs = 0;            ///< Time of last keypress
   uint32_t _lastPromptMs = 0;              ///< Time of last prompt display
   bool     _quietMode = false;             ///< Quiet mode flag
   bool     _justProcessed = false;         ///< Command just processed flag
+  bool     _lineOverflow = false;          ///< Characters were dropped at LINE_MAX
+
+  // Multi-line 'sched import begin' ... 'end' (records collect in a static buffer)
+  bool     _importing = false;             ///< Lines are schedule records, not commands
+  bool     _importBroken = false;          ///< A record was cut or did not fit; 'end' discards
+  size_t   _importLen = 0;                 ///< Characters collected
+  uint16_t _importLines = 0;               ///< Records collected
   
   // Command History
   static const int HISTORY_SIZE = 16;      ///< Maximum history entries
-  String _history[HISTORY_SIZE];           ///< History buffer
+  char   _history[HISTORY_SIZE][LINE_MAX + 1]; ///< Ring of stored lines
+  int    _historyHead = 0;                 ///< Slot of the oldest entry
   int    _historyCount = 0;                ///< Number of entries in history
   int    _historyIndex = -1;               ///< Current history navigation index
   
@@ -152,15 +176,22 @@ private:
   
   /**
    * @brief Process a complete command line
-   * @param line Command string to execute
+   * @param line Trimmed command text; tokenized in place
    */
-  void handleLine(String line);
+  void handleLine(char* line);
   
   /**
    * @brief Store command in history
-   * @param cmd Command string to store
+   * @param cmd Command text to store
+   * @param len Length of cmd
+   */
+  void storeHistory(const char* cmd, size_t len);
+
+  /**
+   * @brief History entry by age
+   * @param i 0 = oldest stored entry
    */
-  void storeHistory(const String& cmd);
+  const char* historyAt(int i) const;
   
   // ========================================================================
   // History Navigation
@@ -178,9 +209,9 @@ private:
   
   /**
    * @brief Replace current line with text
-   * @param txt New line content
+   * @param txt New line content (cut at LINE_MAX)
    */
-  void replaceCurrentLine(const String& txt);
+  void replaceCurrentLine(const char* txt);
   
   // ========================================================================
   // Line Editing Operations
@@ -221,19 +252,38 @@ private:
    * @brief Move cursor to end of line
    */
   void moveCursorEnd();
+
+  /**
+   * @brief Redraw the line from the cursor to its end and put the cursor back
+   * @param erase Blank cells left over after a deletion
+   */
+  void echoTail(uint8_t erase);
   
   // ========================================================================
   // Argument Parsing
   // ========================================================================
   
+  /** @brief Most arguments splitArgs() returns */
+  static const size_t MAX_ARGS = 8;
+
   /**
-   * @brief Parse arguments with quoted string support
-   * @param raw Raw argument string
-   * @param out Vector to receive parsed arguments
-   * 
-   * Handles quoted strings with spaces correctly.
+   * @brief Split arguments, with quoted string support
+   * @param raw Argument text (a slice of _line)
+   * @param out Receives up to cap argument slices
+   * @param cap Capacity of out
+   * @return Number of arguments, or cap + 1 if there were more
+   *
+   * Handles quoted strings with spaces correctly. Works in place on _line:
+   * quotes are squeezed out and each argument is NUL-terminated.
    */
-  void parseArgsQuoted(const String& raw, std::vector<String>& out);
+  size_t splitArgs(TextSlice raw, TextSlice* out, size_t cap);
+
+  /**
+   * @brief Take the first word off rest
+   * @param rest Slice of _line; left trimmed, without the word
+   * @return The word, NUL-terminated in place
+   */
+  TextSlice takeWord(TextSlice& rest);
   
   // ========================================================================
   // Command Implementations
@@ -241,41 +291,48 @@ private:
   
   void cmdHelp();                      ///< Display help text
   void cmdStatus();                    ///< Show stove status
-  void cmdRam(const String& arg);      ///< Read RAM address
-  void cmdEE(const String& arg);       ///< Read EEPROM address
+  void cmdRam(TextSlice arg);      ///< Read RAM address
+  void cmdEE(TextSlice arg);       ///< Read EEPROM address
   void cmdOn();                        ///< Turn stove on
   void cmdOff();                       ///< Turn stove off
-  void cmdPower(const String& arg);    ///< Set power level
-  void cmdTimer(const String& rest);   ///< Timer commands
+  void cmdPower(TextSlice arg);    ///< Set power level
+  void cmdTimer(TextSlice rest);   ///< Timer commands
   void timerShowStatus();              ///< Show timer status
   void timerCancel();                  ///< Cancel timer
   void cmdAutoOff();                   ///< Auto-shutdown command
   void cmdSchedList();                 ///< List schedule entries
-  void cmdSchedSet(const String& rest);///< Set schedule entry
+  void cmdSchedSet(TextSlice rest);///< Set schedule entry
   void cmdSchedSummary();              ///< Show schedule summary
+  void cmdSchedWindow(TextSlice rest); ///< Set or clear an on/off window
+  void cmdSchedCron(TextSlice rest);   ///< Set or clear a cron rule
+  void cmdSchedPreheat(TextSlice rest);///< Set or clear a pre-heat rule
+  void cmdSchedNext(TextSlice rest);   ///< List the next scheduled events
+  void cmdSchedSim(TextSlice rest);    ///< Dry-run the schedule in virtual time
+  void cmdSchedExport();                   ///< Print the whole table as import records
+  void cmdSchedImport(TextSlice rest); ///< Apply a batch of records in one transaction
+
+  /**
+   * @brief Take one line while a multi-line import is open
+   * @param line Trimmed line: a record, "end" (apply) or "abort"
+   */
+  void importLine(const char* line);
+  void cmdThermal(TextSlice rest);     ///< Show or reset the thermal model
   void cmdClear();                     ///< Clear screen
   void cmdTemp();                      ///< Show temperature
-  void cmdQuiet(const String& arg);    ///< Toggle quiet mode
-  void cmdWifi(const String& rest);    ///< WiFi configuration
+  void cmdQuiet(TextSlice arg);    ///< Toggle quiet mode
+  void cmdWifi(TextSlice rest);    ///< WiFi configuration
+  void cmdMqtt(TextSlice rest);    ///< MQTT broker configuration
+  void cmdApi(TextSlice rest);     ///< Local API token
+  void cmdSinks();                     ///< Status sink policies and counters
+  void cmdQueue();                     ///< Command bus depth and counters
+  void cmdTasks();                     ///< Stack high-water mark of every task
   
 #ifdef SIMULATION_MODE
   // Simulation-specific commands
-  void cmdSimState(const String& arg); ///< Force simulation state
-  void cmdSimPower(const String& arg); ///< Force simulation power
-  void cmdSimTemp(const String& arg);  ///< Force simulation temperature
+  void cmdSimState(TextSlice arg); ///< Force simulation state
+  void cmdSimPower(TextSlice arg); ///< Force simulation power
+  void cmdSimTemp(TextSlice arg);  ///< Force simulation temperature
   void cmdSimFail();                   ///< Enable failure mode
   void cmdSimRecover();                ///< Disable failure mode
 #endif
-  
-  // ========================================================================
-  // Parsing Utilities
-  // ========================================================================
-  
-  /**
-   * @brief Parse six integer values from string
-   * @param rest Input string
-   * @param out Array to receive parsed integers
-   * @return true if successfully parsed 6 integers
-   */
-  bool parseSixInts(const String& rest, int out[6]);
 };
\ No newline at end of file
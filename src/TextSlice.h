@@ -0,0 +1,77 @@
+/**
+ * @file TextSlice.h
+ * @brief Non-owning view of a run of characters (string_view-style)
+ *
+ * Lets parsers hand out pieces of a fixed buffer without copying them into
+ * String objects: a slice is a pointer and a length, never owns or
+ * allocates, and is valid as long as the buffer it points into.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @struct TextSlice
+ * @brief Pointer + length into someone else's buffer
+ */
+struct TextSlice {
+    const char* ptr = "";  ///< First character (never null)
+    size_t len = 0;        ///< Number of characters
+
+    TextSlice() {}
+    TextSlice(const char* p, size_t n) : ptr(p ? p : ""), len(p ? n : 0) {}
+    explicit TextSlice(const char* s) : ptr(s ? s : ""), len(s ? strlen(s) : 0) {}
+
+    bool empty() const { return len == 0; }
+
+    bool equals(const char* s) const {
+        size_t n = strlen(s);
+        return n == len && memcmp(ptr, s, n) == 0;
+    }
+
+    bool equalsIgnoreCase(const char* s) const {
+        size_t n = strlen(s);
+        return n == len && strncasecmp(ptr, s, n) == 0;
+    }
+
+    bool startsWith(const char* s) const {
+        size_t n = strlen(s);
+        return n <= len && memcmp(ptr, s, n) == 0;
+    }
+
+    /** @brief The slice without leading and trailing whitespace */
+    TextSlice trimmed() const {
+        const char* p = ptr;
+        size_t n = len;
+        while (n && isspace((unsigned char)*p)) { p++; n--; }
+        while (n && isspace((unsigned char)p[n - 1])) n--;
+        return TextSlice(p, n);
+    }
+
+    /**
+     * @brief Leading integer of the slice (strtol rules)
+     * @param def Returned when the slice does not start with a number
+     * @param base Number base (0 = C prefixes: 0x.., 0..)
+     */
+    long toInt(long def = 0, int base = 10) const {
+        char tmp[24];
+        if (!len || len >= sizeof(tmp)) return def;
+        memcpy(tmp, ptr, len);
+        tmp[len] = '\0';
+        char* end = nullptr;
+        long v = strtol(tmp, &end, base);
+        return end == tmp ? def : v;
+    }
+
+    /** @brief Leading decimal number of the slice; def if there is none */
+    float toFloat(float def = 0.0f) const {
+        char tmp[24];
+        if (!len || len >= sizeof(tmp)) return def;
+        memcpy(tmp, ptr, len);
+        tmp[len] = '\0';
+        char* end = nullptr;
+        float v = strtof(tmp, &end);
+        return end == tmp ? def : v;
+    }
+};
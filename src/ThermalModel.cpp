@@ -0,0 +1,231 @@
+/**
+ * @file ThermalModel.cpp
+ * @brief Learned room heat-up and cooling model implementation
+ */
+
+#include "ThermalModel.h"
+#include "Logging.h"
+#include <math.h>
+
+ThermalModel gThermal;
+
+static const uint32_t THERMAL_MAGIC = 0x31544E4DUL;  // "MNT1"
+static const char* const THERMAL_KEY = "m";
+
+void ThermalModel::begin() {
+    mMutex = xSemaphoreCreateMutex();
+    setDefaults();
+    if (!mPrefs.begin(THERMAL_STORE_NAMESPACE, false)) {
+        logInfo("[THERMAL] NVS no disponible, el modelo no se guardará.");
+        return;
+    }
+    Params stored;
+    if (mPrefs.getBytesLength(THERMAL_KEY) == sizeof(stored) &&
+        mPrefs.getBytes(THERMAL_KEY, &stored, sizeof(stored)) == sizeof(stored) &&
+        stored.magic == THERMAL_MAGIC) {
+        mParams = stored;
+        logInfo("[THERMAL] Modelo térmico restaurado desde NVS.");
+    }
+}
+
+void ThermalModel::setDefaults() {
+    mParams.magic = THERMAL_MAGIC;
+    for (int p = 0; p < 5; p++) {
+        mParams.heatRate[p] = THERMAL_DEFAULT_HEAT_RATE + THERMAL_DEFAULT_HEAT_STEP * p;
+        mParams.heatVar[p] = 10.0f;
+        mParams.heatSamples[p] = 0;
+    }
+    // Newton cooling towards 10 °C with a 20 h time constant.
+    mParams.coolTheta[0] = -0.05f;
+    mParams.coolTheta[1] = 0.5f;
+    mParams.coolP[0] = 1.0f; mParams.coolP[1] = 0.0f;
+    mParams.coolP[2] = 0.0f; mParams.coolP[3] = 100.0f;
+    mParams.coolSamples = 0;
+    mParams.ignitionSamples = 0;
+    mParams.ignitionMin = THERMAL_DEFAULT_IGNITION_MIN;
+}
+
+void ThermalModel::reset() {
+    if (!mMutex) return;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    setDefaults();
+    mWinKind = WIN_NONE;
+    mDirty = false;
+    xSemaphoreGive(mMutex);
+    mPrefs.remove(THERMAL_KEY);
+    logInfo("[THERMAL] Modelo térmico reiniciado.");
+}
+
+void ThermalModel::addSample(uint32_t nowMs, float temp, StoveRunState state, uint8_t power) {
+    if (!mMutex || isnan(temp)) return;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    mLastTemp = temp;
+    mHasTemp = true;
+
+    // Ignition time: first non-off state until WORKING.
+    if (mLastState == STOVE_OFF && state != STOVE_OFF && state != STOVE_UNDEFINED) {
+        mIgnitionStartMs = nowMs;
+    }
+    if (state == STOVE_WORKING && mIgnitionStartMs) {
+        float minutes = (nowMs - mIgnitionStartMs) / 60000.0f;
+        if (minutes > 1.0f && minutes < 90.0f) {
+            uint16_t n = mParams.ignitionSamples;
+            float w = n < 4 ? 1.0f / (n + 1) : 0.25f;
+            mParams.ignitionMin += w * (minutes - mParams.ignitionMin);
+            if (n < 0xFFFF) mParams.ignitionSamples = n + 1;
+            mDirty = true;
+        }
+        mIgnitionStartMs = 0;
+    }
+    if (state == STOVE_OFF) mIgnitionStartMs = 0;
+    if (state != STOVE_UNDEFINED) mLastState = state;
+
+    uint8_t kind = WIN_NONE;
+    if (state == STOVE_WORKING && power >= 1 && power <= 5) kind = power;
+    else if (state == STOVE_OFF) kind = WIN_COOLING;
+
+    if (kind != mWinKind || (nowMs - mWinStartMs) >= THERMAL_SAMPLE_WINDOW_MS) {
+        closeWindow(nowMs);
+        mWinKind = kind;
+        mWinStartMs = nowMs;
+        mWinCount = 0;
+        mSumT = mSumTT = mSumY = mSumTY = 0;
+    }
+    if (mWinKind != WIN_NONE) {
+        float t = (nowMs - mWinStartMs) / 3600000.0f;
+        mSumT += t;
+        mSumTT += t * t;
+        mSumY += temp;
+        mSumTY += t * temp;
+        mWinCount++;
+    }
+    xSemaphoreGive(mMutex);
+}
+
+void ThermalModel::closeWindow(uint32_t nowMs) {
+    if (mWinKind == WIN_NONE || mWinCount < 3) return;
+    if ((nowMs - mWinStartMs) < THERMAL_SAMPLE_WINDOW_MS / 2) return;
+    float n = mWinCount;
+    float den = n * mSumTT - mSumT * mSumT;
+    if (den <= 1e-9f) return;
+    float slope = (n * mSumTY - mSumT * mSumY) / den;
+    if (fabsf(slope) > THERMAL_MAX_RATE) return;
+    if (mWinKind == WIN_COOLING) learnCooling(mSumY / n, slope);
+    else learnHeat(mWinKind, slope);
+}
+
+void ThermalModel::learnHeat(uint8_t power, float rate) {
+    // Scalar RLS with forgetting: tracks the mean net heat-up rate.
+    int i = power - 1;
+    float P = mParams.heatVar[i];
+    float k = P / (THERMAL_RLS_LAMBDA + P);
+    mParams.heatRate[i] += k * (rate - mParams.heatRate[i]);
+    mParams.heatVar[i] = (1.0f - k) * P / THERMAL_RLS_LAMBDA;
+    if (mParams.heatSamples[i] < 0xFFFF) mParams.heatSamples[i]++;
+    mDirty = true;
+}
+
+void ThermalModel::learnCooling(float meanTemp, float rate) {
+    // Two-parameter RLS on dT/dt = a*T + b.
+    float* th = mParams.coolTheta;
+    float* P = mParams.coolP;
+    float x0 = meanTemp, x1 = 1.0f;
+    float px0 = P[0] * x0 + P[1] * x1;
+    float px1 = P[2] * x0 + P[3] * x1;
+    float denom = THERMAL_RLS_LAMBDA + x0 * px0 + x1 * px1;
+    if (denom <= 1e-9f) return;
+    float k0 = px0 / denom, k1 = px1 / denom;
+    float err = rate - (th[0] * x0 + th[1] * x1);
+    th[0] += k0 * err;
+    th[1] += k1 * err;
+    float n0 = (P[0] - k0 * px0) / THERMAL_RLS_LAMBDA;
+    float n1 = (P[1] - k0 * px1) / THERMAL_RLS_LAMBDA;
+    float n2 = (P[2] - k1 * px0) / THERMAL_RLS_LAMBDA;
+    float n3 = (P[3] - k1 * px1) / THERMAL_RLS_LAMBDA;
+    P[0] = n0; P[1] = n1; P[2] = n2; P[3] = n3;
+    if (mParams.coolSamples < 0xFFFF) mParams.coolSamples++;
+    mDirty = true;
+}
+
+void ThermalModel::persistIfDue(uint32_t nowMs) {
+    if (!mMutex || !mDirty) return;
+    if (mLastSaveMs && (nowMs - mLastSaveMs) < THERMAL_SAVE_INTERVAL_MS) return;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    Params copy = mParams;
+    mDirty = false;
+    xSemaphoreGive(mMutex);
+    mLastSaveMs = nowMs ? nowMs : 1;
+    if (mPrefs.putBytes(THERMAL_KEY, &copy, sizeof(copy)) != sizeof(copy)) {
+        logInfo("[THERMAL] Error guardando modelo térmico.");
+        mDirty = true;
+    }
+}
+
+float ThermalModel::heatRate(uint8_t power) {
+    if (power < 1) power = 1;
+    if (power > 5) power = 5;
+    if (!mMutex) return THERMAL_DEFAULT_HEAT_RATE;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    float r = mParams.heatRate[power - 1];
+    xSemaphoreGive(mMutex);
+    return r;
+}
+
+float ThermalModel::coolingRate(float temp) {
+    if (!mMutex) return 0.0f;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    float c = -(mParams.coolTheta[0] * temp + mParams.coolTheta[1]);
+    xSemaphoreGive(mMutex);
+    return c > 0.0f ? c : 0.0f;
+}
+
+float ThermalModel::ignitionMinutes() {
+    if (!mMutex) return THERMAL_DEFAULT_IGNITION_MIN;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    float m = mParams.ignitionMin;
+    xSemaphoreGive(mMutex);
+    return m;
+}
+
+float ThermalModel::latestStartMinutes(float targetTemp, uint8_t power, float minutesUntilTarget) {
+    float r = heatRate(power);
+    if (r < 0.1f) r = 0.1f;  // A stove that cannot heat would never start in time.
+    float c = coolingRate(mLastTemp);
+    float heatMin = 60.0f * (targetTemp - mLastTemp) / r;
+    return (minutesUntilTarget - ignitionMinutes() - heatMin) / (1.0f + c / r);
+}
+
+float ThermalModel::predictOff(float minutes) {
+    if (!mMutex) return mLastTemp;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    float a = mParams.coolTheta[0], b = mParams.coolTheta[1];
+    xSemaphoreGive(mMutex);
+    float h = minutes / 60.0f;
+    if (a < -1e-4f) {
+        float tInf = -b / a;
+        return tInf + (mLastTemp - tInf) * expf(a * h);
+    }
+    return mLastTemp + (a * mLastTemp + b) * h;
+}
+
+size_t ThermalModel::writeSummary(Print& out) {
+    if (!mMutex) return 0;
+    xSemaphoreTake(mMutex, portMAX_DELAY);
+    Params p = mParams;
+    xSemaphoreGive(mMutex);
+    char line[80];
+    size_t n = 0;
+    snprintf(line, sizeof(line), "Temp: %.1f C\n", mHasTemp ? mLastTemp : NAN);
+    n += out.print(line);
+    for (int i = 0; i < 5; i++) {
+        snprintf(line, sizeof(line), "P%d heat=%.2f C/h (n=%u)\n", i + 1, p.heatRate[i], (unsigned)p.heatSamples[i]);
+        n += out.print(line);
+    }
+    float tInf = (p.coolTheta[0] < -1e-4f) ? -p.coolTheta[1] / p.coolTheta[0] : NAN;
+    snprintf(line, sizeof(line), "Cooling a=%.4f/h b=%.3f C/h (T_inf=%.1f C, n=%u)\n",
+             p.coolTheta[0], p.coolTheta[1], tInf, (unsigned)p.coolSamples);
+    n += out.print(line);
+    snprintf(line, sizeof(line), "Ignition %.1f min (n=%u)\n", p.ignitionMin, (unsigned)p.ignitionSamples);
+    n += out.print(line);
+    return n;
+}
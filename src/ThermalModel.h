@@ -0,0 +1,133 @@
+/**
+ * @file ThermalModel.h
+ * @brief Learned room heat-up and cooling model for pre-heat scheduling
+ *
+ * Ambient temperature samples from the poll task are grouped into fixed
+ * windows; the slope of each window (least-squares fit, °C/h) feeds a
+ * recursive least squares (RLS) estimator:
+ * - while the stove is WORKING at power p: the net heat-up rate r[p]
+ * - while the stove is OFF: a Newton cooling law dT/dt = a*T + b
+ * Ignition time (start request to WORKING) is tracked as well. The model is
+ * stored in NVS and refined continuously.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "StoveController.h"
+#include "Config.h"
+
+class ThermalModel {
+public:
+    /**
+     * @brief Create the mutex and load the learned model from NVS
+     */
+    void begin();
+
+    /**
+     * @brief Feed one poll sample
+     * @param nowMs Current millis()
+     * @param temp Ambient temperature (°C)
+     * @param state Stove run state at the time of the sample
+     * @param power Current power level (1-5)
+     */
+    void addSample(uint32_t nowMs, float temp, StoveRunState state, uint8_t power);
+
+    /**
+     * @brief Save the model if it changed and the save interval has elapsed
+     */
+    void persistIfDue(uint32_t nowMs);
+
+    /**
+     * @brief Forget everything learned and return to the defaults
+     */
+    void reset();
+
+    /** @brief Whether a temperature reading has been received */
+    bool hasTemp() const { return mHasTemp; }
+
+    /** @brief Latest ambient temperature (°C) */
+    float currentTemp() const { return mLastTemp; }
+
+    /**
+     * @brief Net heat-up rate while working at a power level (°C/h)
+     */
+    float heatRate(uint8_t power);
+
+    /**
+     * @brief Cooling rate with the stove off at a given temperature (°C/h, >= 0)
+     */
+    float coolingRate(float temp);
+
+    /** @brief Learned ignition time (minutes) */
+    float ignitionMinutes();
+
+    /**
+     * @brief Latest start that still reaches a target temperature in time
+     * @param targetTemp Temperature wanted at the target time (°C)
+     * @param power Power level the stove will run at
+     * @param minutesUntilTarget Minutes from now to the target time
+     * @return Minutes from now until the latest start (negative = late)
+     *
+     * With current temperature T0, cooling rate c (at T0), heat-up rate r and
+     * ignition time i, starting after s minutes reaches the target when
+     * s + i + 60 * (Tt - T0 + c*s/60) / r <= D, so the latest start is
+     * s = (D - i - 60 * (Tt - T0) / r) / (1 + c / r).
+     */
+    float latestStartMinutes(float targetTemp, uint8_t power, float minutesUntilTarget);
+
+    /**
+     * @brief Predict the temperature after a period with the stove off (°C)
+     */
+    float predictOff(float minutes);
+
+    /**
+     * @brief Stream a human-readable summary of the learned parameters
+     * @param out Destination sink
+     * @return Number of characters written
+     */
+    size_t writeSummary(Print& out);
+
+private:
+    /** @brief Persisted model parameters */
+    struct Params {
+        uint32_t magic;
+        float heatRate[5];        ///< Net heat-up rate per power level (°C/h)
+        float heatVar[5];         ///< RLS covariance of heatRate
+        uint16_t heatSamples[5];  ///< Windows learned per power level
+        float coolTheta[2];       ///< dT/dt = coolTheta[0] * T + coolTheta[1]
+        float coolP[4];           ///< RLS covariance (row-major 2x2)
+        uint16_t coolSamples;     ///< Cooling windows learned
+        uint16_t ignitionSamples; ///< Ignitions observed
+        float ignitionMin;        ///< Ignition time (minutes)
+    };
+
+    /** @brief Kind of window being accumulated */
+    enum WindowKind : uint8_t { WIN_NONE = 0, WIN_COOLING = 6 };  // 1..5 = heating at that power
+
+    void setDefaults();
+    void closeWindow(uint32_t nowMs);
+    void learnHeat(uint8_t power, float rate);
+    void learnCooling(float meanTemp, float rate);
+
+    Preferences mPrefs;
+    SemaphoreHandle_t mMutex = nullptr;
+    Params mParams;
+    bool mDirty = false;
+    uint32_t mLastSaveMs = 0;
+
+    bool mHasTemp = false;
+    float mLastTemp = NAN;
+    StoveRunState mLastState = STOVE_UNDEFINED;
+    uint32_t mIgnitionStartMs = 0;
+
+    uint8_t mWinKind = WIN_NONE;
+    uint32_t mWinStartMs = 0;
+    uint16_t mWinCount = 0;
+    float mSumT = 0, mSumTT = 0, mSumY = 0, mSumTY = 0;
+};
+
+extern ThermalModel gThermal;
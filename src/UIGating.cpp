@@ -4,11 +4,163 @@
  */
 
 #include "UIGating.h"
+#include "AppGlobals.h"
+#include "BlynkGlobal.h"
+#include "Config.h"
 
 UIGating uiGate;
-bool uiForceSwitchOn = false;
 
 void initUIGating() {
-    uiGate = UIGating();
-    uiForceSwitchOn = false;
+    uiGate.reset();
+}
+
+namespace {
+
+/** @brief One gated widget */
+struct GateRule {
+    uint32_t (*timeoutMs)(const UIGating::Lock& l);
+    bool (*confirmed)(const UIGating::Lock& l, const StoveStatus& s);
+    void (*disable)();
+    void (*enable)(const StoveStatus& s);
+};
+
+/** @brief Rule table, indexed by GateWidget */
+const GateRule RULES[GATE_COUNT] = {
+    // GATE_ONOFF: the stove reports on / off, or it refused the shutdown.
+    {
+        [](const UIGating::Lock& l) -> uint32_t {
+            return l.intent ? STOVE_START_CONFIRM_TIMEOUT_MS : STOVE_SHUTDOWN_CONFIRM_TIMEOUT_MS;
+        },
+        [](const UIGating::Lock& l, const StoveStatus& s) {
+            if (gCommandBus.isActive(l.intent ? Command::START : Command::SHUTDOWN)) return false;
+            return l.intent ? s.isOn : (s.state == STOVE_OFF || s.shutdownRefusals != l.refusals);
+        },
+        []() { gBlynk.disableOnOff(); },
+        [](const StoveStatus& s) { gBlynk.enableOnOff(s.isOn); },
+    },
+    // GATE_POWER: the adjustment (including any retarget) has finished.
+    {
+        [](const UIGating::Lock&) -> uint32_t { return POWER_ADJUST_TIMEOUT_MS; },
+        [](const UIGating::Lock&, const StoveStatus& s) {
+            return !s.powerAdjustInProgress && !gCommandBus.isActive(Command::SET_POWER);
+        },
+        []() { gBlynk.disablePowerSlider(); },
+        [](const StoveStatus& s) { gBlynk.enablePowerSlider(s.powerLevel); },
+    },
+    // GATE_TIMER: the timer command has been executed.
+    {
+        [](const UIGating::Lock&) -> uint32_t { return TIMER_LOCK_RELEASE_MS; },
+        [](const UIGating::Lock&, const StoveStatus&) { return !gCommandBus.isActive(Command::SET_TIMER); },
+        []() { gBlynk.disableTimerInput(); },
+        [](const StoveStatus&) { BlynkWrapper::setProperty(VPIN_SET_TIMER_MIN, "isDisabled", "false"); },
+    },
+    // GATE_SCHED: the schedule edit has been applied.
+    {
+        [](const UIGating::Lock&) -> uint32_t { return SCHED_LOCK_RELEASE_MS; },
+        [](const UIGating::Lock&, const StoveStatus&) { return !gCommandBus.isActive(Command::SCHED_APPLY); },
+        []() { gBlynk.disableSchedulerApply(); },
+        [](const StoveStatus&) { gBlynk.enableSchedulerApply(); },
+    },
+};
+
+/** @brief a is earlier than b (wrap-safe) */
+inline bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+}  // namespace
+
+void UIGating::reset() {
+    for (uint8_t w = 0; w < GATE_COUNT; w++) {
+        uint8_t gen = mLocks[w].generation;
+        mLocks[w] = Lock();
+        mLocks[w].generation = gen;
+    }
+    mHeapLen = 0;
+}
+
+void UIGating::lock(GateWidget w, uint32_t now, uint8_t intent) {
+    Lock& l = mLocks[w];
+    StoveStatus s;
+    l.generation++;
+    l.locked = true;
+    l.disablePending = true;
+    l.startMs = now;
+    l.intent = intent;
+    l.refusals = latestStatus(s) ? s.shutdownRefusals : 0;
+    l.armedTimeoutMs = RULES[w].timeoutMs(l);
+    // "now - start > timeout" first holds one millisecond after start + timeout.
+    pushDeadline(w, now + l.armedTimeoutMs + 1);
+    pushDeadline(w, now + UI_REENABLE_FAILSAFE_MS + 1);
+}
+
+bool UIGating::isStale(const Deadline& d) const {
+    const Lock& l = mLocks[d.widget];
+    return !l.locked || l.generation != d.generation;
+}
+
+void UIGating::pushDeadline(GateWidget w, uint32_t atMs) {
+    if (mHeapLen == HEAP_MAX) {
+        // Full of superseded entries: rebuild from the live ones.
+        Deadline live[HEAP_MAX];
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < mHeapLen; i++) {
+            if (!isStale(mHeap[i])) live[n++] = mHeap[i];
+        }
+        mHeapLen = 0;
+        for (uint8_t i = 0; i < n; i++) pushDeadline((GateWidget)live[i].widget, live[i].atMs);
+        if (mHeapLen == HEAP_MAX) return;  // Cannot happen: at most 2 live deadlines per widget.
+    }
+    uint8_t i = mHeapLen++;
+    Deadline d{atMs, (uint8_t)w, mLocks[w].generation};
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!before(d.atMs, mHeap[parent].atMs)) break;
+        mHeap[i] = mHeap[parent];
+        i = parent;
+    }
+    mHeap[i] = d;
+}
+
+void UIGating::popDeadline() {
+    if (!mHeapLen) return;
+    Deadline last = mHeap[--mHeapLen];
+    uint8_t i = 0;
+    while (true) {
+        uint8_t child = 2 * i + 1;
+        if (child >= mHeapLen) break;
+        if (child + 1 < mHeapLen && before(mHeap[child + 1].atMs, mHeap[child].atMs)) child++;
+        if (!before(mHeap[child].atMs, last.atMs)) break;
+        mHeap[i] = mHeap[child];
+        i = child;
+    }
+    if (mHeapLen) mHeap[i] = last;
+}
+
+void UIGating::evaluate(GateWidget w, const StoveStatus& s, uint32_t now) {
+    Lock& l = mLocks[w];
+    const GateRule& r = RULES[w];
+    uint32_t elapsed = now - l.startMs;
+    if (r.confirmed(l, s) || elapsed > l.armedTimeoutMs || elapsed > UI_REENABLE_FAILSAFE_MS) {
+        l.locked = false;
+        l.disablePending = false;
+        r.enable(s);
+    }
+}
+
+void UIGating::service(const StoveStatus& s, uint32_t now) {
+    for (uint8_t w = 0; w < GATE_COUNT; w++) {
+        if (!mLocks[w].disablePending) continue;
+        RULES[w].disable();
+        mLocks[w].disablePending = false;
+    }
+    // Expired and superseded deadlines have done their job: the evaluation below covers them.
+    while (mHeapLen && (isStale(mHeap[0]) || !before(now, mHeap[0].atMs))) popDeadline();
+    for (uint8_t w = 0; w < GATE_COUNT; w++) {
+        if (mLocks[w].locked) evaluate((GateWidget)w, s, now);
+    }
+}
+
+uint32_t UIGating::nextDueMs(uint32_t now) {
+    while (mHeapLen && isStale(mHeap[0])) popDeadline();
+    if (!mHeapLen) return UINT32_MAX;
+    return before(now, mHeap[0].atMs) ? mHeap[0].atMs - now : 0;
 }
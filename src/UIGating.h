@@ -1,31 +1,109 @@
 /**
  * @file UIGating.h
  * @brief UI state gating and lock management for Blynk interface
+ *
+ * A widget the user just operated is disabled until the stove confirms the
+ * action, so a second tap cannot race the first. Each gated widget is one
+ * row of a rule table (UIGating.cpp):
+ * - confirmed(): the controller event that releases the lock (command
+ *   executed and the stove reports the requested state, adjustment
+ *   finished, shutdown refused, ...);
+ * - timeoutMs(): release anyway after this long;
+ * - disable()/enable(): the widget writes.
+ * UI_REENABLE_FAILSAFE_MS applies to every row.
+ *
+ * Timeouts are kept as deadlines in a small min-heap whose earliest entry
+ * feeds StatusPublisher's single deadline timer. Conditions are checked on
+ * the status push that follows each controller event (the control task
+ * notifies after every executed command), so a widget unlocks as soon as
+ * its condition holds or its deadline passes. Only locked widgets are
+ * evaluated; adding a widget adds a table row, not a per-tick check.
+ *
+ * Everything runs in the network task (Blynk callbacks and StatusPublisher).
  */
 
 #pragma once
 
 #include <Arduino.h>
+#include "StoveController.h"
 
-struct UIGating {
-    bool onOffLocked = false;
-    uint32_t onOffLockStart = 0;
-    bool reqOnOffDisable = false;
-    
-    bool powerLocked = false;
-    uint32_t powerLockStart = 0;
-    bool reqPowerDisable = false;
-    
-    bool timerLocked = false;
-    uint32_t timerLockStart = 0;
-    bool reqTimerDisable = false;
-    
-    bool schedLocked = false;
-    uint32_t schedLockStart = 0;
-    bool reqSchedDisable = false;
+/** @brief Gated widgets (rows of the rule table) */
+enum GateWidget : uint8_t {
+    GATE_ONOFF,  ///< On/off switch
+    GATE_POWER,  ///< Power slider
+    GATE_TIMER,  ///< Auto-shutdown timer input
+    GATE_SCHED,  ///< Scheduler apply button
+    GATE_COUNT
+};
+
+class UIGating {
+public:
+    /**
+     * @brief Lock a widget after a user action; it is disabled on the next service()
+     * @param w Widget
+     * @param now Current millis()
+     * @param intent What was asked for, if the rule needs it (GATE_ONOFF: 1 = on, 0 = off)
+     */
+    void lock(GateWidget w, uint32_t now, uint8_t intent = 0);
+
+    /** @brief Whether a widget is locked */
+    bool isLocked(GateWidget w) const { return mLocks[w].locked; }
+
+    /**
+     * @brief Apply pending disables and release every lock whose condition or deadline is met
+     * @param s Latest status
+     * @param now Current millis()
+     *
+     * Call inside the Blynk batch of a status push.
+     */
+    void service(const StoveStatus& s, uint32_t now);
+
+    /**
+     * @brief Milliseconds until the earliest lock deadline (UINT32_MAX if none)
+     * @param now Current millis()
+     */
+    uint32_t nextDueMs(uint32_t now);
+
+    /** @brief Drop every lock and deadline (widgets are re-enabled by the caller) */
+    void reset();
+
+    /** @brief One lock per widget (rules read it) */
+    struct Lock {
+        uint8_t intent = 0;           ///< lock() intent
+        uint32_t refusals = 0;        ///< StoveStatus::shutdownRefusals at lock()
+        bool locked = false;          ///< Widget disabled, waiting for release
+        bool disablePending = false;  ///< disable() not written yet
+        uint32_t startMs = 0;         ///< millis() of lock()
+        uint32_t armedTimeoutMs = 0;  ///< Rule timeout for this lock
+        uint8_t generation = 0;       ///< Bumped per lock(); older deadlines are stale
+    };
+
+private:
+    /** @brief Heap entry: wake up at atMs to re-evaluate a widget */
+    struct Deadline {
+        uint32_t atMs;
+        uint8_t widget;
+        uint8_t generation;
+    };
+
+    static const uint8_t HEAP_MAX = GATE_COUNT * 4;
+
+    void pushDeadline(GateWidget w, uint32_t atMs);
+    void popDeadline();
+    bool isStale(const Deadline& d) const;
+
+    /**
+     * @brief Release the lock if the rule confirms it or its timeout (or the failsafe) has passed
+     *
+     * Arms nothing: the deadline that brings service() back here was pushed by lock().
+     */
+    void evaluate(GateWidget w, const StoveStatus& s, uint32_t now);
+
+    Lock mLocks[GATE_COUNT];
+    Deadline mHeap[HEAP_MAX];   ///< Binary min-heap on atMs (wrap-safe compare)
+    uint8_t mHeapLen = 0;
 };
 
 extern UIGating uiGate;
-extern bool uiForceSwitchOn;
 
 void initUIGating();
@@ -0,0 +1,85 @@
+/**
+ * @file UdpStatus.cpp
+ * @brief LAN status beacon implementation
+ */
+
+#include "UdpStatus.h"
+#include "MnvFrame.h"
+#include "AppGlobals.h"
+#include "Config.h"
+#include "Logging.h"
+
+UdpStatusSink gUdpStatus;
+
+/** @brief Flags that trigger a frame on their own (not StatusPublisher fields) */
+static const uint8_t CHANGE_FLAGS = MNV_FLAG_ON | MNV_FLAG_CAN_SHUTDOWN | MNV_FLAG_POWER_ADJUST | MNV_FLAG_AUTO_OFF;
+
+static uint8_t flagsOf(const StoveStatus& s) {
+    uint8_t flags = 0;
+    if (s.isOn) flags |= MNV_FLAG_ON;
+    if (s.canShutdown) flags |= MNV_FLAG_CAN_SHUTDOWN;
+    if (s.powerAdjustInProgress) flags |= MNV_FLAG_POWER_ADJUST;
+    if (s.autoShutdownRemainingMs) flags |= MNV_FLAG_AUTO_OFF;
+    return flags;
+}
+
+static IPAddress destination() {
+    IPAddress group;
+    if (UDP_STATUS_GROUP[0] && group.fromString(UDP_STATUS_GROUP)) return group;
+    return WiFi.broadcastIP();
+}
+
+bool UdpStatusSink::ready() const {
+    return WiFi.status() == WL_CONNECTED;
+}
+
+void UdpStatusSink::deliver(const StatusFrame&, uint8_t) {
+    // Frames are always complete: the mask only says that something changed.
+    send(false);
+}
+
+void UdpStatusSink::loop(uint32_t nowMs) {
+    if (!ready()) return;
+    StoveStatus s;
+    if (!latestStatus(s)) return;
+    if (flagsOf(s) != mLastFlags) send(false);
+    else if (nowMs - mLastSendMs >= UDP_STATUS_HEARTBEAT_MS) send(true);
+}
+
+void UdpStatusSink::send(bool heartbeat) {
+    StoveStatus s;
+    if (!latestStatus(s)) return;
+
+    mnv_status_t m = {};
+    m.seq = mSeq++;
+    m.uptimeMs = millis();
+    m.state = (uint8_t)s.state;
+    m.power = s.powerLevel;
+    float t = s.ambientTemp * 10.0f;
+    m.tempX10 = (int16_t)constrain(t + (t < 0 ? -0.5f : 0.5f), -32768.0f, 32767.0f);
+    m.flags = flagsOf(s) | (heartbeat ? MNV_FLAG_HEARTBEAT : 0);
+    m.shutdownInMs = s.canShutdown ? 0 : s.msRemainingToAllowShutdown;
+    m.autoOffMs = s.autoShutdownRemainingMs;
+    m.refusals = s.shutdownRefusals > 0xFFFF ? 0xFFFF : (uint16_t)s.shutdownRefusals;
+
+    uint8_t buf[MNV_FRAME_MAX];
+    size_t len = mnv_frame_encode(&m, buf);
+    mLastSendMs = millis();
+    mLastFlags = m.flags & CHANGE_FLAGS;
+    if (!mUdp.beginPacket(destination(), UDP_STATUS_PORT)) {
+        mErrors++;
+        return;
+    }
+    mUdp.write(buf, len);
+    if (mUdp.endPacket()) mSent++;
+    else mErrors++;
+}
+
+void UdpStatusSink::printStatus(Print& out) {
+    char line[112];
+    snprintf(line, sizeof(line), "\r\n[UDP] Destino: %s:%u (%s)  tramas=%lu errores=%lu seq=%lu",
+             destination().toString().c_str(), (unsigned)UDP_STATUS_PORT,
+             UDP_STATUS_GROUP[0] ? "multicast" : "broadcast",
+             (unsigned long)mSent, (unsigned long)mErrors, (unsigned long)mSeq);
+    out.print(line);
+}
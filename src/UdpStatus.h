@@ -0,0 +1,58 @@
+/**
+ * @file UdpStatus.h
+ * @brief LAN status beacon: binary frames over UDP broadcast or multicast
+ *
+ * Listeners on the local network (dashboards, loggers, tools/mnv_listen)
+ * get the stove status without polling and without a broker. Every status
+ * change delivered by StatusPublisher, and every change of the flags that
+ * are not publisher fields (shutdown allowed, adjustment running), sends
+ * one MnvFrame.h frame; a heartbeat frame every UDP_STATUS_HEARTBEAT_MS
+ * lets a listener tell "nothing changed" from "device gone".
+ *
+ * The frame is always complete (state, power, temperature, shutdown window,
+ * auto-shutdown remaining) so a listener that joins late or loses a
+ * datagram is correct after the next one; the sequence number reveals
+ * losses. Destination is the subnet broadcast address, or UDP_STATUS_GROUP
+ * when set. Runs in the network task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "StatusSink.h"
+
+/**
+ * @class UdpStatusSink
+ * @brief StatusSink that sends MnvFrame frames to the LAN
+ */
+class UdpStatusSink : public StatusSink {
+public:
+    UdpStatusSink() : StatusSink("udp", {0, true, 1}) {}
+
+    void deliver(const StatusFrame& f, uint8_t mask) override;
+    bool ready() const override;
+
+    /**
+     * @brief Heartbeat and flag changes; call from the network loop
+     * @param nowMs Current millis()
+     */
+    void loop(uint32_t nowMs);
+
+    /** @brief Destination, sequence and counters */
+    void printStatus(Print& out);
+
+private:
+    /** @brief Build a frame from the latest snapshot and send it */
+    void send(bool heartbeat);
+
+    WiFiUDP mUdp;
+    uint32_t mSeq = 0;          ///< Sequence number of the next frame
+    uint32_t mLastSendMs = 0;   ///< millis() of the last frame
+    uint8_t mLastFlags = 0;     ///< Change flags of the last frame
+    uint32_t mSent = 0;         ///< Frames sent
+    uint32_t mErrors = 0;       ///< beginPacket/endPacket failures
+};
+
+extern UdpStatusSink gUdpStatus;
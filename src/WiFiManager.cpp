@@ -10,34 +10,45 @@
 WiFiManager gWiFiMgr;
 
 void WiFiManager::begin() {
+    mLock = xSemaphoreCreateMutex();
     loadCredentials();
 }
 
 void WiFiManager::loadCredentials() {
-    if (!mPrefs.begin("wificfg", false)) {
-        mSsid = WIFI_SSID;
-        mPassword = WIFI_PASS;
-        return;
+    String s, p;
+    if (mPrefs.begin("wificfg", false)) {
+        s = mPrefs.getString("ssid", "");
+        p = mPrefs.getString("pass", "");
     }
-    
-    String s = mPrefs.getString("ssid", "");
-    String p = mPrefs.getString("pass", "");
-    
-    if (s.length() == 0) {
-        mSsid = WIFI_SSID;
-        mPassword = WIFI_PASS;
-    } else {
-        mSsid = s;
-        mPassword = p;
+    if (s.length() == 0 || !setCredentials(s.c_str(), p.c_str())) {
+        setCredentials(WIFI_SSID, WIFI_PASS);
     }
 }
 
-void WiFiManager::saveCredentials(const String& ssid, const String& pass) {
-    mSsid = ssid;
-    mPassword = pass;
+bool WiFiManager::setCredentials(const char* ssid, const char* pass) {
+    if (!ssid || !pass || strlen(ssid) > SSID_MAX || strlen(pass) > PASS_MAX || !mLock) return false;
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    strlcpy(mSsid, ssid, sizeof(mSsid));
+    strlcpy(mPassword, pass, sizeof(mPassword));
+    mChanged = true;
+    xSemaphoreGive(mLock);
+    return true;
+}
+
+void WiFiManager::copyCredentials(char* ssid, size_t ssidCap, char* pass, size_t passCap) {
+    if (!mLock) return;
+    xSemaphoreTake(mLock, portMAX_DELAY);
+    strlcpy(ssid, mSsid, ssidCap);
+    strlcpy(pass, mPassword, passCap);
+    xSemaphoreGive(mLock);
+}
+
+void WiFiManager::saveCredentials() {
+    char ssid[SSID_MAX + 1], pass[PASS_MAX + 1];
+    copyCredentials(ssid, sizeof(ssid), pass, sizeof(pass));
     mPrefs.begin("wificfg", false);
-    mPrefs.putString("ssid", mSsid);
-    mPrefs.putString("pass", mPassword);
+    mPrefs.putString("ssid", ssid);
+    mPrefs.putString("pass", pass);
     logInfo("[WiFi] Credenciales guardadas en NVS.");
 }
 
@@ -47,23 +58,15 @@ void WiFiManager::eraseCredentials() {
     logInfo("[WiFi] Credenciales borradas de NVS.");
 }
 
-bool WiFiManager::connect() {
-    logf("Conectando WiFi SSID='%s' ...", mSsid.c_str());
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(mSsid.c_str(), mPassword.c_str());
-    
-    uint32_t start = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - start < 20000) {
-        delay(500);
-        Serial.print(".");
-    }
-    Serial.println();
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        logInfo("WiFi OK");
-        return true;
+void WiFiManager::startConnect() {
+    if (mChanged && mLock) {
+        xSemaphoreTake(mLock, portMAX_DELAY);
+        strlcpy(mConnSsid, mSsid, sizeof(mConnSsid));
+        strlcpy(mConnPassword, mPassword, sizeof(mConnPassword));
+        mChanged = false;
+        xSemaphoreGive(mLock);
     }
-    
-    logInfo("WiFi FAIL");
-    return false;
+    logf("Conectando WiFi SSID='%s' ...", mConnSsid);
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(mConnSsid, mConnPassword);
 }
@@ -1,6 +1,11 @@
 /**
  * @file WiFiManager.h
  * @brief WiFi connection and credential management
+ *
+ * The terminal edits the credentials while the network task connects with
+ * them, so they cross tasks the way MqttLink's configuration does: the
+ * terminal stores the requested values and raises a flag, and the network
+ * task copies them into its own buffers before the next association.
  */
 
 #pragma once
@@ -8,26 +13,49 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 class WiFiManager {
 public:
+    static const size_t SSID_MAX = 32;  ///< Longest SSID (802.11)
+    static const size_t PASS_MAX = 64;  ///< Longest WPA passphrase
+
     void begin();
-    bool connect();
-    void saveCredentials(const String& ssid, const String& pass);
+
+    /**
+     * @brief Start associating with the requested network and return at once
+     *
+     * Network task only. Progress is observed through WiFi.status();
+     * NetworkLink drives the timeout and retries.
+     */
+    void startConnect();
+
+    /**
+     * @brief Request new credentials (RAM only; see saveCredentials())
+     * @return false if a value is too long (nothing changes)
+     *
+     * Safe to call from any task; used by the next startConnect().
+     */
+    bool setCredentials(const char* ssid, const char* pass);
+
+    /** @brief Store the requested credentials in NVS */
+    void saveCredentials();
     void eraseCredentials();
-    
-    String getSsid() const { return mSsid; }
-    String getPassword() const { return mPassword; }
-    
-    void setSsid(const String& ssid) { mSsid = ssid; }
-    void setPassword(const String& pass) { mPassword = pass; }
+
+    /** @brief Copy the requested credentials out (any task) */
+    void copyCredentials(char* ssid, size_t ssidCap, char* pass, size_t passCap);
 
 private:
     void loadCredentials();
-    
+
     Preferences mPrefs;
-    String mSsid;
-    String mPassword;
+    SemaphoreHandle_t mLock = nullptr;          ///< Guards mSsid/mPassword
+    char mSsid[SSID_MAX + 1] = "";              ///< Requested SSID
+    char mPassword[PASS_MAX + 1] = "";          ///< Requested passphrase
+    volatile bool mChanged = true;              ///< Requested values not yet copied below
+    char mConnSsid[SSID_MAX + 1] = "";          ///< SSID the network task connects with
+    char mConnPassword[PASS_MAX + 1] = "";      ///< Passphrase the network task connects with
 };
 
 extern WiFiManager gWiFiMgr;
@@ -0,0 +1,143 @@
+/**
+ * @file mnv_listen.c
+ * @brief Linux listener for the stove's UDP status frames (src/MnvFrame.h)
+ *
+ * Build:  cc -O2 -Wall -Isrc -o mnv_listen tools/mnv_listen.c
+ * Usage:  mnv_listen [-p port] [-g group] [-q]
+ *   -p  UDP port (default 47800, UDP_STATUS_PORT)
+ *   -g  join a multicast group (when UDP_STATUS_GROUP is set on the device)
+ *   -q  print only changes, not heartbeats
+ *
+ * One line per frame; lost frames (sequence gaps), restarts and bad frames
+ * are reported on stderr.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MnvFrame.h"
+
+/* StoveRunState values (src/StoveController.h) */
+static const char* state_name(uint8_t s) {
+    switch (s) {
+    case 0: return "OFF";
+    case 1: return "STARTING";
+    case 2: return "LOADING_PELLET";
+    case 3: return "FIRE_PRESENT";
+    case 4: return "WORKING";
+    case 6: return "FINAL_CLEAN";
+    default: return "UNDEFINED";
+    }
+}
+
+static const char* decode_error(int rc) {
+    switch (rc) {
+    case MNV_ERR_LEN: return "length";
+    case MNV_ERR_MAGIC: return "magic";
+    case MNV_ERR_VERSION: return "version";
+    case MNV_ERR_CRC: return "crc";
+    default: return "?";
+    }
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [-p port] [-g group] [-q]\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    int port = 47800;
+    const char* group = NULL;
+    int quiet = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:g:q")) != -1) {
+        switch (opt) {
+        case 'p': port = atoi(optarg); break;
+        case 'g': group = optarg; break;
+        case 'q': quiet = 1; break;
+        default: usage(argv[0]);
+        }
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) { perror("socket"); return 1; }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) { perror("bind"); return 1; }
+
+    if (group) {
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        if (inet_pton(AF_INET, group, &mreq.imr_multiaddr) != 1) {
+            fprintf(stderr, "bad group: %s\n", group);
+            return 2;
+        }
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            perror("IP_ADD_MEMBERSHIP");
+            return 1;
+        }
+    }
+    fprintf(stderr, "listening on udp/%d%s%s\n", port, group ? " group " : "", group ? group : "");
+
+    int have_seq = 0;
+    uint32_t last_seq = 0;
+    unsigned long lost = 0, bad = 0;
+    for (;;) {
+        uint8_t buf[MNV_FRAME_MAX * 4];
+        struct sockaddr_in from;
+        socklen_t fromlen = sizeof(from);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr*)&from, &fromlen);
+        if (n < 0) { perror("recvfrom"); return 1; }
+
+        char src[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &from.sin_addr, src, sizeof(src));
+
+        mnv_status_t s;
+        int rc = mnv_frame_decode(buf, (size_t)n, &s);
+        if (rc != MNV_OK) {
+            bad++;
+            fprintf(stderr, "%s: bad frame (%s, %zd bytes, %lu so far)\n", src, decode_error(rc), n, bad);
+            continue;
+        }
+
+        if (have_seq) {
+            int32_t diff = (int32_t)(s.seq - last_seq);
+            if (diff <= 0) {
+                fprintf(stderr, "%s: sequence restarted (%u -> %u), device rebooted?\n",
+                        src, (unsigned)last_seq, (unsigned)s.seq);
+            } else if (diff > 1) {
+                lost += (unsigned long)(diff - 1);
+                fprintf(stderr, "%s: %d frame(s) lost (%lu total)\n", src, (int)(diff - 1), lost);
+            }
+        }
+        have_seq = 1;
+        last_seq = s.seq;
+
+        if (quiet && (s.flags & MNV_FLAG_HEARTBEAT)) continue;
+
+        char when[16];
+        time_t now = time(NULL);
+        strftime(when, sizeof(when), "%H:%M:%S", localtime(&now));
+        printf("%s %s v%u #%u %-16s %s P%u %5.1fC off-in %us auto-off %um refusals %u%s%s\n",
+               when, src, (unsigned)s.version, (unsigned)s.seq, state_name(s.state),
+               (s.flags & MNV_FLAG_ON) ? "ON " : "OFF", (unsigned)s.power, s.tempX10 / 10.0,
+               (unsigned)((s.shutdownInMs + 999) / 1000), (unsigned)((s.autoOffMs + 59999) / 60000),
+               (unsigned)s.refusals,
+               (s.flags & MNV_FLAG_POWER_ADJUST) ? " adjusting" : "",
+               (s.flags & MNV_FLAG_HEARTBEAT) ? " (hb)" : "");
+        fflush(stdout);
+    }
+}